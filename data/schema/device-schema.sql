@@ -70,9 +70,9 @@ CREATE INDEX idx_device_%deviceid_songs_album ON device_%deviceid_songs (album);
 
 CREATE INDEX idx_device_%deviceid_songs_comp_artist ON device_%deviceid_songs (compilation_effective, artist);
 
-CREATE VIRTUAL TABLE device_%deviceid_fts USING fts3(
+CREATE VIRTUAL TABLE device_%deviceid_fts USING fts5(
   ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold', prefix='1 2 3'
 );
 
 UPDATE devices SET schema_version=0 WHERE ROWID=%deviceid;
@@ -0,0 +1,40 @@
+DROP TABLE IF EXISTS %allsongstables_fts;
+
+DROP TABLE IF EXISTS playlist_items_fts_;
+
+CREATE VIRTUAL TABLE IF NOT EXISTS %allsongstables_fts USING fts5(
+
+  ftstitle,
+  ftsalbum,
+  ftsartist,
+  ftsalbumartist,
+  ftscomposer,
+  ftsperformer,
+  ftsgrouping,
+  ftsgenre,
+  ftscomment,
+  tokenize='unicodefold',
+  prefix='1 2 3'
+
+);
+
+CREATE VIRTUAL TABLE IF NOT EXISTS playlist_items_fts_ USING fts5(
+
+  ftstitle,
+  ftsalbum,
+  ftsartist,
+  ftsalbumartist,
+  ftscomposer,
+  ftsperformer,
+  ftsgrouping,
+  ftsgenre,
+  ftscomment,
+  tokenize='unicodefold',
+  prefix='1 2 3'
+
+);
+
+INSERT INTO %allsongstables_fts (ROWID, ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment)
+SELECT ROWID, title, album, artist, albumartist, composer, performer, grouping, genre, comment FROM %allsongstables;
+
+UPDATE schema_version SET version=6;
@@ -0,0 +1,7 @@
+CREATE TABLE IF NOT EXISTS fingerprints (
+  filename TEXT PRIMARY KEY NOT NULL,
+  mtime INTEGER NOT NULL,
+  fingerprint TEXT NOT NULL
+);
+
+UPDATE schema_version SET version=7;
@@ -0,0 +1,12 @@
+DROP VIEW IF EXISTS duplicated_songs;
+
+CREATE TABLE IF NOT EXISTS duplicated_songs (
+  dup_artist TEXT NOT NULL,
+  dup_album TEXT NOT NULL,
+  dup_title TEXT NOT NULL,
+  PRIMARY KEY (dup_artist, dup_album, dup_title)
+);
+
+INSERT INTO duplicated_songs (dup_artist, dup_album, dup_title) SELECT artist, album, title FROM songs WHERE artist != '' AND album != '' AND title != '' AND unavailable = 0 GROUP BY artist, album, title HAVING COUNT(*) > 1;
+
+UPDATE schema_version SET version=8;
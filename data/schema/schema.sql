@@ -4,7 +4,7 @@ CREATE TABLE IF NOT EXISTS schema_version (
 
 DELETE FROM schema_version;
 
-INSERT INTO schema_version (version) VALUES (5);
+INSERT INTO schema_version (version) VALUES (8);
 
 CREATE TABLE IF NOT EXISTS directories (
   path TEXT NOT NULL,
@@ -328,6 +328,12 @@ CREATE TABLE IF NOT EXISTS devices (
   transcode_format NOT NULL DEFAULT 5
 );
 
+CREATE TABLE IF NOT EXISTS fingerprints (
+  filename TEXT PRIMARY KEY NOT NULL,
+  mtime INTEGER NOT NULL,
+  fingerprint TEXT NOT NULL
+);
+
 CREATE INDEX IF NOT EXISTS idx_filename ON songs (filename);
 
 CREATE INDEX IF NOT EXISTS idx_comp_artist ON songs (compilation_effective, artist);
@@ -336,9 +342,14 @@ CREATE INDEX IF NOT EXISTS idx_album ON songs (album);
 
 CREATE INDEX IF NOT EXISTS idx_title ON songs (title);
 
-CREATE VIEW IF NOT EXISTS duplicated_songs as select artist dup_artist, album dup_album, title dup_title from songs as inner_songs where artist != '' and album != '' and title != '' and unavailable = 0 group by artist, album , title having count(*) > 1;
+CREATE TABLE IF NOT EXISTS duplicated_songs (
+  dup_artist TEXT NOT NULL,
+  dup_album TEXT NOT NULL,
+  dup_title TEXT NOT NULL,
+  PRIMARY KEY (dup_artist, dup_album, dup_title)
+);
 
-CREATE VIRTUAL TABLE IF NOT EXISTS songs_fts USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS songs_fts USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -349,11 +360,12 @@ CREATE VIRTUAL TABLE IF NOT EXISTS songs_fts USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
-CREATE VIRTUAL TABLE IF NOT EXISTS tidal_artists_songs_fts USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS tidal_artists_songs_fts USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -364,11 +376,12 @@ CREATE VIRTUAL TABLE IF NOT EXISTS tidal_artists_songs_fts USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
-CREATE VIRTUAL TABLE IF NOT EXISTS tidal_albums_songs_fts USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS tidal_albums_songs_fts USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -379,11 +392,12 @@ CREATE VIRTUAL TABLE IF NOT EXISTS tidal_albums_songs_fts USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
-CREATE VIRTUAL TABLE IF NOT EXISTS tidal_songs_fts USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS tidal_songs_fts USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -394,11 +408,12 @@ CREATE VIRTUAL TABLE IF NOT EXISTS tidal_songs_fts USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
-CREATE VIRTUAL TABLE IF NOT EXISTS playlist_items_fts_ USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS playlist_items_fts_ USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -409,11 +424,12 @@ CREATE VIRTUAL TABLE IF NOT EXISTS playlist_items_fts_ USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
-CREATE VIRTUAL TABLE IF NOT EXISTS %allsongstables_fts USING fts3(
+CREATE VIRTUAL TABLE IF NOT EXISTS %allsongstables_fts USING fts5(
 
   ftstitle,
   ftsalbum,
@@ -424,7 +440,8 @@ CREATE VIRTUAL TABLE IF NOT EXISTS %allsongstables_fts USING fts3(
   ftsgrouping,
   ftsgenre,
   ftscomment,
-  tokenize=unicode
+  tokenize='unicodefold',
+  prefix='1 2 3'
 
 );
 
@@ -21,17 +21,22 @@
 #include <functional>
 #include <memory>
 
+#include "core/tracing.h"
+
 // Helper for lazy initialisation of objects.
 // Usage:
 //    Lazy<Foo> my_lazy_object([]() { return new Foo; });
+// Give it a name to have the initialisation show up in startup traces:
+//    Lazy<Foo> my_lazy_object("Foo", []() { return new Foo; });
 
 template <typename T>
 class Lazy {
  public:
-  explicit Lazy(std::function<T*()> init) : init_(init) {}
+  explicit Lazy(std::function<T*()> init) : name_(nullptr), init_(init) {}
+  Lazy(const char *name, std::function<T*()> init) : name_(name), init_(init) {}
 
   // Convenience constructor that will lazily default construct the object.
-  Lazy() : init_([]() { return new T; }) {}
+  Lazy() : name_(nullptr), init_([]() { return new T; }) {}
 
   T* get() const {
     CheckInitialised();
@@ -55,10 +60,17 @@ class Lazy {
  private:
   void CheckInitialised() const {
     if (!ptr_) {
-      ptr_.reset(init_());
+      if (name_) {
+        tracing::ScopedSpan span(name_);
+        ptr_.reset(init_());
+      }
+      else {
+        ptr_.reset(init_());
+      }
     }
   }
 
+  const char *name_;
   const std::function<T*()> init_;
   mutable std::unique_ptr<T> ptr_;
 };
@@ -0,0 +1,177 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QThread>
+
+#include "tracing.h"
+
+#include "core/logging.h"
+
+namespace tracing {
+
+namespace {
+
+struct Event {
+  const char *name;
+  QString detail;
+  char phase;
+  qint64 start;
+  qint64 duration;
+  Qt::HANDLE thread;
+};
+
+// Stop recording if tracing is left running for a long time.
+const int kMaxEvents = 100000;
+
+QAtomicInt sEnabled(0);
+QMutex sMutex;
+QString sFilename;
+QElapsedTimer sTimer;
+QList<Event> sEvents;
+
+qint64 Now() { return sTimer.nsecsElapsed() / 1000; }
+
+void AddEvent(const char *name, const QString &detail, const char phase, const qint64 start, const qint64 duration) {
+
+  QMutexLocker l(&sMutex);
+  if (sEvents.count() >= kMaxEvents) return;
+
+  Event event;
+  event.name = name;
+  event.detail = detail;
+  event.phase = phase;
+  event.start = start;
+  event.duration = duration;
+  event.thread = QThread::currentThreadId();
+  sEvents << event;
+
+}
+
+}  // namespace
+
+void SetOutputFile(const QString &filename) {
+
+  QMutexLocker l(&sMutex);
+  sFilename = filename;
+  sEvents.clear();
+  sTimer.start();
+  sEnabled.store(filename.isEmpty() ? 0 : 1);
+
+}
+
+bool IsEnabled() { return sEnabled.load() != 0; }
+
+void Instant(const char *name, const QString &detail) {
+
+  if (!IsEnabled()) return;
+  AddEvent(name, detail, 'i', Now(), 0);
+
+}
+
+qint64 Timestamp() {
+
+  if (!IsEnabled()) return -1;
+  return Now();
+
+}
+
+void Span(const char *name, const QString &detail, const qint64 start) {
+
+  if (start == -1 || !IsEnabled()) return;
+  AddEvent(name, detail, 'X', start, Now() - start);
+
+}
+
+void Span(const char *name, const QString &detail, const qint64 start, const qint64 end) {
+
+  if (start == -1 || end == -1 || !IsEnabled()) return;
+  AddEvent(name, detail, 'X', start, end - start);
+
+}
+
+void Write() {
+
+  if (!IsEnabled()) return;
+
+  QMutexLocker l(&sMutex);
+
+  // Chrome wants small thread IDs, number the threads in the order they first show up.
+  QHash<Qt::HANDLE, int> thread_ids;
+  const qint64 pid = QCoreApplication::applicationPid();
+
+  QJsonArray events;
+  for (const Event &event : sEvents) {
+    if (!thread_ids.contains(event.thread)) thread_ids.insert(event.thread, thread_ids.count());
+
+    QJsonObject json;
+    json["name"] = QString::fromLatin1(event.name);
+    // Use the class name as category, so the events of one part can be filtered.
+    json["cat"] = QString::fromLatin1(event.name).section("::", 0, 0);
+    json["ph"] = QString(QChar::fromLatin1(event.phase));
+    json["ts"] = event.start;
+    if (event.phase == 'X') json["dur"] = event.duration;
+    if (event.phase == 'i') json["s"] = "g";
+    json["pid"] = pid;
+    json["tid"] = thread_ids[event.thread];
+    if (!event.detail.isEmpty()) {
+      QJsonObject args;
+      args["detail"] = event.detail;
+      json["args"] = args;
+    }
+    events << json;
+  }
+
+  QJsonObject root;
+  root["traceEvents"] = events;
+  root["displayTimeUnit"] = "ms";
+
+  QFile file(sFilename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qLog(Error) << "Failed to open trace file" << sFilename << file.errorString();
+    return;
+  }
+  file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  file.close();
+
+  qLog(Info) << "Wrote" << sEvents.count() << "trace events to" << sFilename;
+
+}
+
+ScopedSpan::ScopedSpan(const char *name, const QString &detail) : name_(name), detail_(detail), start_(IsEnabled() ? Now() : -1) {}
+
+ScopedSpan::~ScopedSpan() {
+
+  if (start_ == -1 || !IsEnabled()) return;
+  AddEvent(name_, detail_, 'X', start_, Now() - start_);
+
+}
+
+}  // namespace tracing
@@ -0,0 +1,64 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QtGlobal>
+#include <QString>
+
+// Records where the time goes during startup and playback, written out in the Chrome trace event format so it can be opened in chrome://tracing or Perfetto.
+// Nothing is recorded unless an output file was set with --trace.
+namespace tracing {
+
+  void SetOutputFile(const QString &filename);
+  bool IsEnabled();
+
+  // Records a single point in time, like the first paint of the main window.
+  void Instant(const char *name, const QString &detail = QString());
+
+  // Returns the current time to pass to Span() later, or -1 if tracing is disabled.
+  qint64 Timestamp();
+
+  // Records the time from start until now, for things that start and finish in different functions, like a track starting to play.
+  // Nothing is recorded if start is -1.
+  void Span(const char *name, const QString &detail, const qint64 start);
+  // Records the time from start until end, both from Timestamp(), for spans that are only known after they ended.
+  void Span(const char *name, const QString &detail, const qint64 start, const qint64 end);
+
+  // Writes the events recorded so far to the output file.
+  void Write();
+
+// Records the time from construction until it goes out of scope.
+// The name must be a string literal, it is not copied.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char *name, const QString &detail = QString());
+  ~ScopedSpan();
+
+ private:
+  Q_DISABLE_COPY(ScopedSpan)
+
+  const char *name_;
+  QString detail_;
+  qint64 start_;
+};
+
+}  // namespace tracing
+
+#endif  // TRACING_H
@@ -49,6 +49,11 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
   else if (message.has_save_file_request()) {
     reply.mutable_save_file_response()->set_success(tag_reader_.SaveFile(QStringFromStdString(message.save_file_request().filename()), message.save_file_request().metadata()));
   }
+  else if (message.has_save_files_request()) {
+    for (const pb::tagreader::SaveFileRequest &request : message.save_files_request().files()) {
+      reply.mutable_save_files_response()->add_success(tag_reader_.SaveFile(QStringFromStdString(request.filename()), request.metadata()));
+    }
+  }
 
   else if (message.has_is_media_file_request()) {
     reply.mutable_is_media_file_response()->set_success(tag_reader_.IsMediaFile(QStringFromStdString(message.is_media_file_request().filename())));
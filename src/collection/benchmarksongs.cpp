@@ -0,0 +1,147 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <random>
+
+#include <QtGlobal>
+#include <QMutexLocker>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "core/database.h"
+#include "core/scopedtransaction.h"
+#include "core/song.h"
+#include "core/timeconstants.h"
+#include "benchmarksongs.h"
+
+namespace BenchmarkSongs {
+
+namespace {
+
+const int kWords = 2000;
+const int kTracksPerAlbum = 10;
+const int kAlbumsPerArtist = 5;
+
+const char *kSyllables[] = { "ka", "lo", "mi", "ne", "ra", "su", "to", "vi", "an", "el", "or", "ul", "da", "be", "go", "sha", "tre", "mon", "lin", "park", "dé", "rö", "ñu", "lü", "få" };
+const char *kGenres[] = { "Rock", "Pop", "Jazz", "Electronic", "Hip-Hop", "Classical", "Metal", "Folk", "Blues", "Soul" };
+
+// A few words joined with spaces, picked with the given seed.
+QString Phrase(const uint seed, const int min_words, const int max_words) {
+
+  static const QStringList words = Words();
+
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> word_count(min_words, max_words);
+  std::uniform_int_distribution<int> word(0, words.count() - 1);
+
+  QStringList phrase;
+  for (int i = word_count(generator) ; i > 0 ; --i) {
+    QString w = words[word(generator)];
+    w[0] = w[0].toUpper();
+    phrase << w;
+  }
+  return phrase.join(" ");
+
+}
+
+}  // namespace
+
+QStringList Words() {
+
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> syllable_count(2, 3);
+  std::uniform_int_distribution<int> syllable(0, sizeof(kSyllables) / sizeof(kSyllables[0]) - 1);
+
+  QStringList words;
+  while (words.count() < kWords) {
+    QString word;
+    for (int i = syllable_count(generator) ; i > 0 ; --i) word += QString::fromUtf8(kSyllables[syllable(generator)]);
+    if (!words.contains(word)) words << word;
+  }
+  return words;
+
+}
+
+Song Generate(const int index) {
+
+  const int album = index / kTracksPerAlbum;
+  const int artist = album / kAlbumsPerArtist;
+
+  // Different seeds for the different tags, so an artist isn't named after its first album.
+  const QString artist_name = Phrase(3 * artist, 1, 2);
+  const QString album_name = Phrase(3 * album + 1, 1, 3);
+  const QString title = Phrase(3 * index + 2, 1, 4);
+
+  Song song;
+  song.set_valid(true);
+  song.set_source(Song::Source_Collection);
+  song.set_directory_id(1);
+  song.set_title(title);
+  song.set_album(album_name);
+  song.set_artist(artist_name);
+  song.set_track(index % kTracksPerAlbum + 1);
+  song.set_year(1960 + artist % 60);
+  song.set_genre(kGenres[artist % (sizeof(kGenres) / sizeof(kGenres[0]))]);
+  song.set_length_nanosec((120 + index % 300) * kNsecPerSec);
+  song.set_bitrate(900);
+  song.set_samplerate(44100);
+  song.set_bitdepth(16);
+  song.set_filetype(Song::FileType_FLAC);
+  song.set_filesize(30000000);
+  song.set_mtime(1500000000);
+  song.set_ctime(1500000000);
+  song.set_url(QUrl::fromLocalFile(QString("/music/%1/%2/%3 - %4.flac").arg(artist_name, album_name).arg(song.track(), 2, 10, QChar('0')).arg(title)));
+  song.set_basefilename(song.url().fileName());
+
+  return song;
+
+}
+
+void AddToDatabase(Database *db, const SongList &songs) {
+
+  QMutexLocker l(db->Mutex());
+  QSqlDatabase database(db->Connect());
+
+  QSqlQuery add_song(database);
+  add_song.prepare("INSERT INTO songs (" + Song::kColumnSpec + ") VALUES (" + Song::kBindSpec + ")");
+  QSqlQuery add_song_fts(database);
+  add_song_fts.prepare("INSERT INTO songs_fts (ROWID, " + Song::kFtsColumnSpec + ") VALUES (:id, " + Song::kFtsBindSpec + ")");
+
+  ScopedTransaction transaction(&database);
+
+  for (const Song &song : songs) {
+    song.BindToQuery(&add_song);
+    add_song.exec();
+    if (db->CheckErrors(add_song)) return;
+
+    add_song_fts.bindValue(":id", add_song.lastInsertId().toInt());
+    song.BindToFtsQuery(&add_song_fts);
+    add_song_fts.exec();
+    if (db->CheckErrors(add_song_fts)) return;
+  }
+
+  transaction.Commit();
+
+}
+
+}  // namespace BenchmarkSongs
@@ -0,0 +1,46 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCHMARKSONGS_H
+#define BENCHMARKSONGS_H
+
+#include "config.h"
+
+#include <QString>
+#include <QStringList>
+
+#include "core/song.h"
+
+class Database;
+
+// Made up songs for the collection benchmarks.
+// The tags look like real ones: ten tracks to an album, five albums to an artist, and some of the words have accents.
+namespace BenchmarkSongs {
+
+// The same index always gives the same song.
+Song Generate(const int index);
+
+// Words the tags are made of, for building search queries.
+QStringList Words();
+
+// Adds the songs to the songs table and its search table in one transaction.
+void AddToDatabase(Database *db, const SongList &songs);
+
+}  // namespace BenchmarkSongs
+
+#endif  // BENCHMARKSONGS_H
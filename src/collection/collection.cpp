@@ -37,27 +37,34 @@
 #include "collectionwatcher.h"
 #include "collectionbackend.h"
 #include "collectionmodel.h"
+#include "collectionindex.h"
 #include "playlist/playlistmanager.h"
 
 const char *SCollection::kSongsTable = "songs";
 const char *SCollection::kDirsTable = "directories";
 const char *SCollection::kSubdirsTable = "subdirectories";
 const char *SCollection::kFtsTable = "songs_fts";
+const char *SCollection::kDuplicatesTable = "duplicated_songs";
 
 SCollection::SCollection(Application *app, QObject *parent)
     : QObject(parent),
       app_(app),
       backend_(nullptr),
       model_(nullptr),
+      index_(nullptr),
       watcher_(nullptr),
       watcher_thread_(nullptr) {
 
   backend_ = new CollectionBackend();
   backend()->moveToThread(app->database()->thread());
 
-  backend_->Init(app->database(), kSongsTable, kDirsTable, kSubdirsTable, kFtsTable);
+  backend_->Init(app->database(), kSongsTable, kDirsTable, kSubdirsTable, kFtsTable, kDuplicatesTable);
 
+  // Create the index first so it sees changes from the backend before the model does.
+  index_ = new CollectionIndex(backend_, this);
   model_ = new CollectionModel(backend_, app_, this);
+  model_->set_collection_index(index_);
+  index_->LoadAsync();
 
   ReloadSettings();
 
@@ -34,6 +34,7 @@ class Application;
 class Thread;
 class CollectionBackend;
 class CollectionModel;
+class CollectionIndex;
 class CollectionWatcher;
 
 class SCollection : public QObject {
@@ -47,11 +48,13 @@ class SCollection : public QObject {
   static const char *kDirsTable;
   static const char *kSubdirsTable;
   static const char *kFtsTable;
+  static const char *kDuplicatesTable;
 
   void Init();
 
   CollectionBackend *backend() const { return backend_; }
   CollectionModel *model() const { return model_; }
+  CollectionIndex *index() const { return index_; }
 
   QString full_rescan_reason(int schema_version) const { return full_rescan_revisions_.value(schema_version, QString()); }
 
@@ -78,6 +81,7 @@ class SCollection : public QObject {
   Application *app_;
   CollectionBackend *backend_;
   CollectionModel *model_;
+  CollectionIndex *index_;
 
   CollectionWatcher *watcher_;
   Thread *watcher_thread_;
@@ -40,6 +40,7 @@
 #include "core/database.h"
 #include "core/logging.h"
 #include "core/scopedtransaction.h"
+#include "core/sqlitequery.h"
 #include "core/utilities.h"
 
 #include "directory.h"
@@ -48,17 +49,20 @@
 #include "sqlrow.h"
 
 const char *CollectionBackend::kSettingsGroup = "Collection";
+const int CollectionBackend::kMaxIncrementalCompilationAlbums = 1000;
 
 CollectionBackend::CollectionBackend(QObject *parent) :
     CollectionBackendInterface(parent),
-    db_(nullptr) {}
+    db_(nullptr),
+    all_compilations_dirty_(true) {}
 
-void CollectionBackend::Init(Database *db, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table) {
+void CollectionBackend::Init(Database *db, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table, const QString &duplicates_table) {
   db_ = db;
   songs_table_ = songs_table;
   dirs_table_ = dirs_table;
   subdirs_table_ = subdirs_table;
   fts_table_ = fts_table;
+  duplicates_table_ = duplicates_table;
 }
 
 void CollectionBackend::LoadDirectoriesAsync() {
@@ -121,13 +125,14 @@ void CollectionBackend::ChangeDirPath(int id, const QString &old_path, const QSt
   const QByteArray old_url = QUrl::fromLocalFile(old_path).toEncoded();
   const QByteArray new_url = QUrl::fromLocalFile(new_path).toEncoded();
 
+  // Subdirectories are stored as paths and songs as URLs, substr() counts from 1.
   const int path_len = old_url.length();
 
   // Do the subdirs table
   {
     QSqlQuery q(db);
-    q.prepare(QString("UPDATE %1 SET path=:path || substr(path, %2) WHERE directory=:id").arg(subdirs_table_).arg(path_len));
-    q.bindValue(":path", new_url);
+    q.prepare(QString("UPDATE %1 SET path=:path || substr(path, %2) WHERE directory_id=:id").arg(subdirs_table_).arg(old_path.length() + 1));
+    q.bindValue(":path", new_path);
     q.bindValue(":id", id);
     q.exec();
     if (db_->CheckErrors(q)) return;
@@ -136,7 +141,7 @@ void CollectionBackend::ChangeDirPath(int id, const QString &old_path, const QSt
   // Do the songs table
   {
     QSqlQuery q(db);
-    q.prepare(QString("UPDATE %1 SET filename=:path || substr(filename, %2) WHERE directory=:id").arg(songs_table_).arg(path_len));
+    q.prepare(QString("UPDATE %1 SET filename=:path || substr(filename, %2) WHERE directory_id=:id").arg(songs_table_).arg(path_len + 1));
     q.bindValue(":path", new_url);
     q.bindValue(":id", id);
     q.exec();
@@ -388,16 +393,11 @@ void CollectionBackend::AddOrUpdateSongs(const SongList &songs) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery check_dir(db);
-  check_dir.prepare(QString("SELECT ROWID FROM %1 WHERE ROWID = :id").arg(dirs_table_));
-  QSqlQuery add_song(db);
-  add_song.prepare(QString("INSERT INTO %1 (" + Song::kColumnSpec + ") VALUES (" + Song::kBindSpec + ")").arg(songs_table_));
-  QSqlQuery update_song(db);
-  update_song.prepare(QString("UPDATE %1 SET " + Song::kUpdateSpec + " WHERE ROWID = :id").arg(songs_table_));
-  QSqlQuery add_song_fts(db);
-  add_song_fts.prepare(QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec + ") VALUES (:id, " + Song::kFtsBindSpec + ")").arg(fts_table_));
-  QSqlQuery update_song_fts(db);
-  update_song_fts.prepare(QString("UPDATE %1 SET " + Song::kFtsUpdateSpec + " WHERE ROWID = :id").arg(fts_table_));
+  QSqlQuery check_dir = db_->CachedQuery(db, QString("SELECT ROWID FROM %1 WHERE ROWID = :id").arg(dirs_table_));
+  QSqlQuery add_song = db_->CachedQuery(db, QString("INSERT INTO %1 (" + Song::kColumnSpec + ") VALUES (" + Song::kBindSpec + ")").arg(songs_table_));
+  QSqlQuery update_song = db_->CachedQuery(db, QString("UPDATE %1 SET " + Song::kUpdateSpec + " WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery add_song_fts = db_->CachedQuery(db, QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec + ") VALUES (:id, " + Song::kFtsBindSpec + ")").arg(fts_table_));
+  QSqlQuery update_song_fts = db_->CachedQuery(db, QString("UPDATE %1 SET " + Song::kFtsUpdateSpec + " WHERE ROWID = :id").arg(fts_table_));
 
   ScopedTransaction transaction(&db);
 
@@ -413,7 +413,9 @@ void CollectionBackend::AddOrUpdateSongs(const SongList &songs) {
       check_dir.exec();
       if (db_->CheckErrors(check_dir)) continue;
 
-      if (!check_dir.next()) continue;  // Directory didn't exist
+      const bool dir_exists = check_dir.next();
+      check_dir.finish();
+      if (!dir_exists) continue;  // Directory didn't exist
     }
 
     if (song.id() != -1) {  // This song exists in the DB.
@@ -490,8 +492,13 @@ void CollectionBackend::AddOrUpdateSongs(const SongList &songs) {
 
   }
 
+  UpdateDuplicates(deleted_songs + added_songs, db);
+
   transaction.Commit();
 
+  MarkCompilationsDirty(deleted_songs);
+  MarkCompilationsDirty(added_songs);
+
   if (!deleted_songs.isEmpty()) emit SongsDeleted(deleted_songs);
 
   if (!added_songs.isEmpty()) emit SongsDiscovered(added_songs);
@@ -507,8 +514,7 @@ void CollectionBackend::UpdateMTimesOnly(const SongList &songs) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(db);
-  q.prepare(QString("UPDATE %1 SET mtime = :mtime WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery q = db_->CachedQuery(db, QString("UPDATE %1 SET mtime = :mtime WHERE ROWID = :id").arg(songs_table_));
 
   ScopedTransaction transaction(&db);
   for (const Song &song : songs) {
@@ -526,10 +532,8 @@ void CollectionBackend::DeleteSongs(const SongList &songs) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery remove(db);
-  remove.prepare(QString("DELETE FROM %1 WHERE ROWID = :id").arg(songs_table_));
-  QSqlQuery remove_fts(db);
-  remove_fts.prepare(QString("DELETE FROM %1 WHERE ROWID = :id").arg(fts_table_));
+  QSqlQuery remove = db_->CachedQuery(db, QString("DELETE FROM %1 WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery remove_fts = db_->CachedQuery(db, QString("DELETE FROM %1 WHERE ROWID = :id").arg(fts_table_));
 
   ScopedTransaction transaction(&db);
   for (const Song &song : songs) {
@@ -541,8 +545,11 @@ void CollectionBackend::DeleteSongs(const SongList &songs) {
     remove_fts.exec();
     db_->CheckErrors(remove_fts);
   }
+  UpdateDuplicates(songs, db);
   transaction.Commit();
 
+  MarkCompilationsDirty(songs);
+
   emit SongsDeleted(songs);
 
   UpdateTotalSongCountAsync();
@@ -565,8 +572,11 @@ void CollectionBackend::MarkSongsUnavailable(const SongList &songs, bool unavail
     remove.exec();
     db_->CheckErrors(remove);
   }
+  UpdateDuplicates(songs, db);
   transaction.Commit();
 
+  MarkCompilationsDirty(songs);
+
   emit SongsDeleted(songs);
   UpdateTotalSongCountAsync();
   UpdateTotalArtistCountAsync();
@@ -658,14 +668,17 @@ SongList CollectionBackend::ExecCollectionQuery(CollectionQuery *query) {
 
   query->SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
   QMutexLocker l(db_->Mutex());
-  if (!ExecQuery(query)) return SongList();
+  SqliteQuery q(db_->Connect());
+  if (!ExecQuery(query, &q)) return SongList();
 
   SongList ret;
-  while (query->Next()) {
+  while (q.Next()) {
     Song song;
-    song.InitFromQuery(*query, true);
+    song.InitFromQuery(q, true);
     ret << song;
   }
+  if (db_->CheckErrors(q)) return SongList();
+
   return ret;
 
 }
@@ -720,22 +733,33 @@ SongList CollectionBackend::GetSongsByForeignId(const QStringList &ids, const QS
 }
 
 Song CollectionBackend::GetSongById(int id, QSqlDatabase &db) {
-  SongList list = GetSongsById(QStringList() << QString::number(id), db);
-  if (list.isEmpty()) return Song();
-  return list.first();
+
+  QSqlQuery q = db_->CachedQuery(db, QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE ROWID = :id").arg(songs_table_));
+  q.bindValue(":id", id);
+  q.exec();
+  if (db_->CheckErrors(q)) return Song();
+
+  Song song;
+  if (q.next()) {
+    song.InitFromQuery(q, true);
+  }
+  q.finish();
+
+  return song;
+
 }
 
 SongList CollectionBackend::GetSongsById(const QStringList &ids, QSqlDatabase &db) {
 
   QString in = ids.join(",");
 
-  QSqlQuery q(db);
-  q.prepare(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE ROWID IN (%2)").arg(songs_table_, in));
-  q.exec();
+  SqliteQuery q(db);
+  q.Prepare(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE ROWID IN (%2)").arg(songs_table_, in));
+  q.Exec();
   if (db_->CheckErrors(q)) return SongList();
 
   SongList ret;
-  while (q.next()) {
+  while (q.Next()) {
     Song song;
     song.InitFromQuery(q, true);
     ret << song;
@@ -746,33 +770,42 @@ SongList CollectionBackend::GetSongsById(const QStringList &ids, QSqlDatabase &d
 
 Song CollectionBackend::GetSongByUrl(const QUrl &url, qint64 beginning) {
 
-  CollectionQuery query;
-  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toString());
-  query.AddWhere("beginning", beginning);
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q = db_->CachedQuery(db, QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE filename = :filename AND beginning = :beginning AND unavailable = 0").arg(songs_table_));
+  q.bindValue(":filename", url.toString());
+  q.bindValue(":beginning", beginning);
+  q.exec();
+  if (db_->CheckErrors(q)) return Song();
 
   Song song;
-  if (ExecQuery(&query) && query.Next()) {
-    song.InitFromQuery(query, true);
+  if (q.next()) {
+    song.InitFromQuery(q, true);
   }
+  q.finish();
+
   return song;
 
 }
 
 SongList CollectionBackend::GetSongsByUrl(const QUrl &url) {
 
-  CollectionQuery query;
-  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toString());
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q = db_->CachedQuery(db, QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE filename = :filename AND unavailable = 0").arg(songs_table_));
+  q.bindValue(":filename", url.toString());
+  q.exec();
+  if (db_->CheckErrors(q)) return SongList();
 
   SongList songlist;
-  if (ExecQuery(&query)) {
-    while (query.Next()) {
-      Song song;
-      song.InitFromQuery(query, true);
-      songlist << song;
-    }
+  while (q.next()) {
+    Song song;
+    song.InitFromQuery(q, true);
+    songlist << song;
   }
+
   return songlist;
 
 }
@@ -859,32 +892,52 @@ void CollectionBackend::UpdateCompilations() {
 
   // Look for albums that have songs by more than one 'effective album artist' in the same directory
 
-  QSqlQuery q(db);
-  q.prepare(QString("SELECT effective_albumartist, album, filename, compilation_detected FROM %1 WHERE unavailable = 0 ORDER BY album").arg(songs_table_));
-  q.exec();
-  if (db_->CheckErrors(q)) return;
-
   QMap<QString, CompilationInfo> compilation_info;
-  while (q.next()) {
-    QString artist = q.value(0).toString();
-    QString album = q.value(1).toString();
-    QString filename = q.value(2).toString();
-    bool compilation_detected = q.value(3).toBool();
-
-    // Ignore songs that don't have an album field set
-    if (album.isEmpty()) continue;
-
-    // Find the directory the song is in
-    int last_separator = filename.lastIndexOf('/');
-    if (last_separator == -1) continue;
-
-    CompilationInfo &info = compilation_info[album];
-    info.artists.insert(artist);
-    info.directories.insert(filename.left(last_separator));
-    if (compilation_detected) info.has_compilation_detected = true;
-    else info.has_not_compilation_detected = true;
+  auto add_songs = [&compilation_info](QSqlQuery &q) {
+    while (q.next()) {
+      QString artist = q.value(0).toString();
+      QString album = q.value(1).toString();
+      QString filename = q.value(2).toString();
+      bool compilation_detected = q.value(3).toBool();
+
+      // Ignore songs that don't have an album field set
+      if (album.isEmpty()) continue;
+
+      // Find the directory the song is in
+      int last_separator = filename.lastIndexOf('/');
+      if (last_separator == -1) continue;
+
+      CompilationInfo &info = compilation_info[album];
+      info.artists.insert(artist);
+      info.directories.insert(filename.left(last_separator));
+      if (compilation_detected) info.has_compilation_detected = true;
+      else info.has_not_compilation_detected = true;
+    }
+  };
+
+  if (all_compilations_dirty_) {
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT effective_albumartist, album, filename, compilation_detected FROM %1 WHERE unavailable = 0 ORDER BY album").arg(songs_table_));
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+    add_songs(q);
+  }
+  else {
+    // Only the albums that changed since the last time need to be looked at, this uses the index on album.
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT effective_albumartist, album, filename, compilation_detected FROM %1 WHERE album = :album AND unavailable = 0").arg(songs_table_));
+    for (const QString &album : dirty_compilation_albums_) {
+      if (album.isEmpty()) continue;
+      q.bindValue(":album", album);
+      q.exec();
+      if (db_->CheckErrors(q)) return;
+      add_songs(q);
+    }
   }
 
+  dirty_compilation_albums_.clear();
+  all_compilations_dirty_ = false;
+
   // Now mark the songs that we think are in compilations
   QSqlQuery update(db);
   update.prepare(QString("UPDATE %1 SET compilation_detected = :compilation_detected, compilation_effective = ((compilation OR :compilation_detected OR compilation_on) AND NOT compilation_off) + 0 WHERE album = :album AND unavailable = 0").arg(songs_table_));
@@ -921,6 +974,58 @@ void CollectionBackend::UpdateCompilations() {
   }
 }
 
+void CollectionBackend::MarkCompilationsDirty(const SongList &songs) {
+
+  if (all_compilations_dirty_) return;
+
+  for (const Song &song : songs) {
+    dirty_compilation_albums_.insert(song.album());
+  }
+
+  // Too many to look at one by one, the next update reads the whole table.
+  if (dirty_compilation_albums_.count() > kMaxIncrementalCompilationAlbums) {
+    dirty_compilation_albums_.clear();
+    all_compilations_dirty_ = true;
+  }
+
+}
+
+void CollectionBackend::UpdateDuplicates(const SongList &songs, QSqlDatabase &db) {
+
+  if (duplicates_table_.isEmpty()) return;
+
+  QSqlQuery count(db);
+  count.prepare(QString("SELECT COUNT(*) FROM %1 WHERE artist = :artist AND album = :album AND title = :title AND unavailable = 0").arg(songs_table_));
+  QSqlQuery add(db);
+  add.prepare(QString("INSERT OR IGNORE INTO %1 (dup_artist, dup_album, dup_title) VALUES (:artist, :album, :title)").arg(duplicates_table_));
+  QSqlQuery remove(db);
+  remove.prepare(QString("DELETE FROM %1 WHERE dup_artist = :artist AND dup_album = :album AND dup_title = :title").arg(duplicates_table_));
+
+  QSet<QString> updated;
+  for (const Song &song : songs) {
+    // Songs with a missing tag are never duplicates.
+    if (song.artist().isEmpty() || song.album().isEmpty() || song.title().isEmpty()) continue;
+
+    const QString key = song.artist() + QChar(0) + song.album() + QChar(0) + song.title();
+    if (updated.contains(key)) continue;
+    updated.insert(key);
+
+    count.bindValue(":artist", song.artist());
+    count.bindValue(":album", song.album());
+    count.bindValue(":title", song.title());
+    count.exec();
+    if (db_->CheckErrors(count) || !count.next()) continue;
+
+    QSqlQuery &q = count.value(0).toInt() > 1 ? add : remove;
+    q.bindValue(":artist", song.artist());
+    q.bindValue(":album", song.album());
+    q.bindValue(":title", song.title());
+    q.exec();
+    db_->CheckErrors(q);
+  }
+
+}
+
 void CollectionBackend::UpdateCompilations(QSqlQuery &find_songs, QSqlQuery &update, SongList &deleted_songs, SongList &added_songs, const QString &album, int compilation_detected) {
 
   // Get songs that were already in that album, so we can tell the model they've been updated
@@ -1151,6 +1256,11 @@ bool CollectionBackend::ExecQuery(CollectionQuery *q) {
   return !db_->CheckErrors(q->Exec(db_->Connect(), songs_table_, fts_table_));
 }
 
+bool CollectionBackend::ExecQuery(CollectionQuery *q, SqliteQuery *query) {
+  q->Exec(query, songs_table_, fts_table_);
+  return !db_->CheckErrors(*query);
+}
+
 void CollectionBackend::IncrementPlayCount(int id) {
 
   if (id == -1) return;
@@ -1158,8 +1268,7 @@ void CollectionBackend::IncrementPlayCount(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(db);
-  q.prepare(QString("UPDATE %1 SET playcount = playcount + 1, lastplayed = :now WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery q = db_->CachedQuery(db, QString("UPDATE %1 SET playcount = playcount + 1, lastplayed = :now WHERE ROWID = :id").arg(songs_table_));
   q.bindValue(":now", QDateTime::currentDateTime().toTime_t());
   q.bindValue(":id", id);
   q.exec();
@@ -1177,8 +1286,7 @@ void CollectionBackend::IncrementSkipCount(int id, float progress) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(db);
-  q.prepare(QString("UPDATE %1 SET skipcount = skipcount + 1 WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery q = db_->CachedQuery(db, QString("UPDATE %1 SET skipcount = skipcount + 1 WHERE ROWID = :id").arg(songs_table_));
   q.bindValue(":id", id);
   q.exec();
   if (db_->CheckErrors(q)) return;
@@ -1195,8 +1303,7 @@ void CollectionBackend::ResetStatistics(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(db);
-  q.prepare(QString("UPDATE %1 SET playcount = 0, skipcount = 0, lastplayed = -1 WHERE ROWID = :id").arg(songs_table_));
+  QSqlQuery q = db_->CachedQuery(db, QString("UPDATE %1 SET playcount = 0, skipcount = 0, lastplayed = -1 WHERE ROWID = :id").arg(songs_table_));
   q.bindValue(":id", id);
   q.exec();
   if (db_->CheckErrors(q)) return;
@@ -1221,7 +1328,16 @@ void CollectionBackend::DeleteAll() {
     q.exec();
     if (db_->CheckErrors(q)) return;
 
+    if (!duplicates_table_.isEmpty()) {
+      q = QSqlQuery("DELETE FROM " + duplicates_table_, db);
+      q.exec();
+      if (db_->CheckErrors(q)) return;
+    }
+
     t.Commit();
+
+    dirty_compilation_albums_.clear();
+    all_compilations_dirty_ = true;
   }
 
   emit DatabaseReset();
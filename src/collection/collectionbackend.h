@@ -42,6 +42,7 @@
 #include "directory.h"
 
 class Database;
+class SqliteQuery;
 
 class CollectionBackendInterface : public QObject {
   Q_OBJECT
@@ -114,6 +115,7 @@ class CollectionBackendInterface : public QObject {
   virtual void RemoveDirectory(const Directory &dir) = 0;
 
   virtual bool ExecQuery(CollectionQuery *q) = 0;
+  virtual bool ExecQuery(CollectionQuery *q, SqliteQuery *query) = 0;
 };
 
 class CollectionBackend : public CollectionBackendInterface {
@@ -121,9 +123,12 @@ class CollectionBackend : public CollectionBackendInterface {
 
  public:
   static const char *kSettingsGroup;
+  // Above this many changed albums UpdateCompilations reads the whole table once instead of querying each album.
+  static const int kMaxIncrementalCompilationAlbums;
 
   Q_INVOKABLE CollectionBackend(QObject *parent = nullptr);
-  void Init(Database *db, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table);
+  // The duplicates table keeps the artist, album and title of songs that are in the collection more than once, it is optional.
+  void Init(Database *db, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table, const QString &duplicates_table = QString());
 
   Database *db() const { return db_; }
 
@@ -170,6 +175,8 @@ class CollectionBackend : public CollectionBackendInterface {
   void RemoveDirectory(const Directory &dir);
 
   bool ExecQuery(CollectionQuery *q);
+  // Runs the query on query instead of inside q, for reading many rows.
+  bool ExecQuery(CollectionQuery *q, SqliteQuery *query);
   SongList ExecCollectionQuery(CollectionQuery *query);
 
   void IncrementPlayCountAsync(int id);
@@ -226,6 +233,10 @@ signals:
   };
 
   void UpdateCompilations(QSqlQuery &find_songs, QSqlQuery &update, SongList &deleted_songs, SongList &added_songs, const QString &album, int compilation_detected);
+  // Remembers that compilation detection has to run again for the albums of these songs, call with the database mutex locked.
+  void MarkCompilationsDirty(const SongList &songs);
+  // Counts the songs with the same artist, album and title as the given songs again and updates the duplicates table.
+  void UpdateDuplicates(const SongList &songs, QSqlDatabase &db);
   AlbumList GetAlbums(const QString &artist, const QString &album_artist, bool compilation = false, const QueryOptions &opt = QueryOptions());
   AlbumList GetAlbums(const QString &artist, bool compilation, const QueryOptions &opt = QueryOptions());
   SubdirectoryList SubdirsInDirectory(int id, QSqlDatabase &db);
@@ -242,6 +253,11 @@ signals:
   QString dirs_table_;
   QString subdirs_table_;
   QString fts_table_;
+  QString duplicates_table_;
+
+  // Albums changed since the last UpdateCompilations, protected by the database mutex.
+  QSet<QString> dirty_compilation_albums_;
+  bool all_compilations_dirty_;
 
 };
 
@@ -315,9 +315,6 @@ void CollectionFilterWidget::SetFilterHint(const QString &hint) {
 
 void CollectionFilterWidget::SetQueryMode(QueryOptions::QueryMode query_mode) {
 
-  ui_->filter->clear();
-  ui_->filter->setEnabled(query_mode == QueryOptions::QueryMode_All);
-
   model_->SetFilterQueryMode(query_mode);
 
 }
@@ -369,7 +366,11 @@ void CollectionFilterWidget::FilterTextChanged(const QString &text) {
   const bool delay = (delay_behaviour_ == AlwaysDelayed) || (delay_behaviour_ == DelayedOnLargeLibraries && !text.isEmpty() && text.length() < 3 && model_->total_song_count() >= 100000);
 
   if (delay) {
-    filter_delay_->start();
+    filter_delay_->start(kFilterDelay);
+  }
+  else if (!text.isEmpty()) {
+    // Wait for a short pause in typing, so not every key press starts a new query.
+    filter_delay_->start(kFilterTypingDelay);
   }
   else {
     filter_delay_->stop();
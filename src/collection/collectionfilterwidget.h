@@ -55,6 +55,7 @@ class CollectionFilterWidget : public QWidget {
   ~CollectionFilterWidget();
 
   static const int kFilterDelay = 500;  // msec
+  static const int kFilterTypingDelay = 150;  // msec
 
   enum DelayBehaviour {
     AlwaysInstant,
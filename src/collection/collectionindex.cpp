@@ -0,0 +1,617 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QMutex>
+#include <QDateTime>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QVariant>
+#include <QString>
+#include <QStringList>
+#include <QRegExp>
+
+#include "core/closure.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/sqlitequery.h"
+#include "collectionbackend.h"
+#include "collectionquery.h"
+#include "collectionmodel.h"
+#include "collectionindex.h"
+
+namespace {
+
+// Key of a group of songs, made from up to four column values.
+struct GroupKey {
+  GroupKey() { v[0] = v[1] = v[2] = v[3] = 0; }
+  int v[4];
+  bool operator==(const GroupKey &other) const {
+    return v[0] == other.v[0] && v[1] == other.v[1] && v[2] == other.v[2] && v[3] == other.v[3];
+  }
+};
+
+uint qHash(const GroupKey &key) {
+  return ::qHash(key.v[0]) ^ (::qHash(key.v[1]) << 1) ^ (::qHash(key.v[2]) << 2) ^ (::qHash(key.v[3]) << 3);
+}
+
+// A column that has to be equal to a value for a song to be part of the node.
+struct Predicate {
+  Predicate(const QVector<int> *_column = nullptr, const int _value = 0, const bool _clamp = false) : column(_column), value(_clamp ? qMax(0, _value) : _value), clamp(_clamp) {}
+  bool Matches(const int slot) const { return (clamp ? qMax(0, column->at(slot)) : column->at(slot)) == value; }
+  const QVector<int> *column;
+  int value;
+  // Unknown numbers are stored as -1 or 0 but shown as 0 in the model.
+  bool clamp;
+};
+
+// Matches FTS prefix queries: the token has to be at the start of a word.  Both have to be folded with Database::FoldString().
+bool WordStartsWith(const QString &str, const QString &token) {
+
+  int pos = 0;
+  while ((pos = str.indexOf(token, pos)) != -1) {
+    if (pos == 0 || !str.at(pos - 1).isLetterOrNumber()) return true;
+    ++pos;
+  }
+  return false;
+
+}
+
+}  // namespace
+
+int CollectionIndex::StringPool::Intern(const QString &str) {
+
+  QHash<QString, int>::const_iterator it = ids_.constFind(str);
+  if (it != ids_.constEnd()) return it.value();
+
+  const int id = strings_.count();
+  strings_ << str;
+  folded_ << Database::FoldString(str);
+  ids_.insert(str, id);
+  return id;
+
+}
+
+int CollectionIndex::Columns::NewSlot() {
+
+  if (!free_slots.isEmpty()) return free_slots.takeLast();
+
+  const int slot = count++;
+  id.append(-1);
+  title.append(0);
+  album.append(0);
+  artist.append(0);
+  albumartist.append(0);
+  effective_albumartist.append(0);
+  composer.append(0);
+  performer.append(0);
+  grouping.append(0);
+  genre.append(0);
+  comment.append(0);
+  year.append(-1);
+  originalyear.append(-1);
+  effective_originalyear.append(-1);
+  disc.append(-1);
+  filetype.append(0);
+  samplerate.append(-1);
+  bitdepth.append(-1);
+  bitrate.append(-1);
+  album_id.append(-1);
+  compilation.append(false);
+  ctime.append(0);
+  return slot;
+
+}
+
+void CollectionIndex::Columns::Set(const int slot, const Song &song) {
+
+  id[slot] = song.id();
+  title[slot] = strings.Intern(song.title());
+  album[slot] = strings.Intern(song.album());
+  artist[slot] = strings.Intern(song.artist());
+  albumartist[slot] = strings.Intern(song.albumartist());
+  effective_albumartist[slot] = strings.Intern(song.effective_albumartist());
+  composer[slot] = strings.Intern(song.composer());
+  performer[slot] = strings.Intern(song.performer());
+  grouping[slot] = strings.Intern(song.grouping());
+  genre[slot] = strings.Intern(song.genre());
+  comment[slot] = strings.Intern(song.comment());
+  year[slot] = song.year();
+  originalyear[slot] = song.originalyear();
+  effective_originalyear[slot] = song.effective_originalyear();
+  disc[slot] = song.disc();
+  filetype[slot] = song.filetype();
+  samplerate[slot] = song.samplerate();
+  bitdepth[slot] = song.bitdepth();
+  bitrate[slot] = song.bitrate();
+  album_id[slot] = song.album_id();
+  compilation[slot] = song.is_compilation();
+  ctime[slot] = song.ctime();
+
+  slot_by_id.insert(song.id(), slot);
+
+}
+
+void CollectionIndex::Columns::Remove(const int song_id) {
+
+  if (!slot_by_id.contains(song_id)) return;
+
+  const int slot = slot_by_id.take(song_id);
+  id[slot] = -1;
+  free_slots << slot;
+
+}
+
+CollectionIndex::CollectionIndex(CollectionBackend *backend, QObject *parent)
+    : QObject(parent),
+      backend_(backend),
+      loaded_(false),
+      loading_(false) {
+
+  connect(backend_, SIGNAL(SongsDiscovered(SongList)), SLOT(SongsDiscovered(SongList)));
+  connect(backend_, SIGNAL(SongsDeleted(SongList)), SLOT(SongsDeleted(SongList)));
+  connect(backend_, SIGNAL(DatabaseReset()), SLOT(LoadAsync()));
+
+}
+
+void CollectionIndex::LoadAsync() {
+
+  if (loading_) return;
+  loading_ = true;
+  loaded_ = false;
+  pending_changes_.clear();
+
+  QFuture<CollectionIndex::Columns> future = QtConcurrent::run(this, &CollectionIndex::Load);
+  NewClosure(future, this, SLOT(LoadFinished(QFuture<CollectionIndex::Columns>)), future);
+
+}
+
+CollectionIndex::Columns CollectionIndex::Load() {
+
+  Columns columns;
+
+  CollectionQuery q;
+  q.SetColumnSpec("%songs_table.ROWID, title, album, artist, albumartist, effective_albumartist, composer, performer, grouping, genre, comment, year, originalyear, effective_originalyear, disc, filetype, samplerate, bitdepth, bitrate, album_id, compilation_effective, ctime");
+
+  QMutexLocker l(backend_->db()->Mutex());
+  SqliteQuery query(backend_->db()->Connect());
+  if (!backend_->ExecQuery(&q, &query)) return columns;
+
+  while (query.Next()) {
+    const int slot = columns.NewSlot();
+    const int id = query.Int(0);
+    columns.id[slot] = id;
+    columns.title[slot] = columns.strings.Intern(query.String(1));
+    columns.album[slot] = columns.strings.Intern(query.String(2));
+    columns.artist[slot] = columns.strings.Intern(query.String(3));
+    columns.albumartist[slot] = columns.strings.Intern(query.String(4));
+    columns.effective_albumartist[slot] = columns.strings.Intern(query.String(5));
+    columns.composer[slot] = columns.strings.Intern(query.String(6));
+    columns.performer[slot] = columns.strings.Intern(query.String(7));
+    columns.grouping[slot] = columns.strings.Intern(query.String(8));
+    columns.genre[slot] = columns.strings.Intern(query.String(9));
+    columns.comment[slot] = columns.strings.Intern(query.String(10));
+    columns.year[slot] = query.Int(11);
+    columns.originalyear[slot] = query.Int(12);
+    columns.effective_originalyear[slot] = query.Int(13);
+    columns.disc[slot] = query.Int(14);
+    columns.filetype[slot] = query.Int(15);
+    columns.samplerate[slot] = query.Int(16);
+    columns.bitdepth[slot] = query.Int(17);
+    columns.bitrate[slot] = query.Int(18);
+    columns.album_id[slot] = query.Int(19);
+    columns.compilation[slot] = query.Int(20) != 0;
+    columns.ctime[slot] = static_cast<uint>(query.LongLong(21));
+    columns.slot_by_id.insert(id, slot);
+  }
+
+  return columns;
+
+}
+
+void CollectionIndex::LoadFinished(QFuture<CollectionIndex::Columns> future) {
+
+  columns_ = future.result();
+  token_cache_.clear();
+  loading_ = false;
+  loaded_ = true;
+
+  for (const QPair<SongList, bool> &change : pending_changes_) {
+    ApplyChanges(change.first, change.second);
+  }
+  pending_changes_.clear();
+
+  qLog(Debug) << "Collection index loaded with" << columns_.slot_by_id.count() << "songs and" << columns_.strings.count() << "unique strings";
+
+  emit Loaded();
+
+}
+
+void CollectionIndex::SongsDiscovered(const SongList &songs) {
+
+  if (loading_) pending_changes_ << qMakePair(songs, false);
+  else if (loaded_) ApplyChanges(songs, false);
+
+}
+
+void CollectionIndex::SongsDeleted(const SongList &songs) {
+
+  if (loading_) pending_changes_ << qMakePair(songs, true);
+  else if (loaded_) ApplyChanges(songs, true);
+
+}
+
+void CollectionIndex::ApplyChanges(const SongList &songs, const bool deleted) {
+
+  token_cache_.clear();
+
+  for (const Song &song : songs) {
+    if (deleted) {
+      columns_.Remove(song.id());
+    }
+    else if (song.unavailable()) {
+      columns_.Remove(song.id());
+    }
+    else {
+      const int slot = columns_.slot_by_id.contains(song.id()) ? columns_.slot_by_id[song.id()] : columns_.NewSlot();
+      columns_.Set(slot, song);
+    }
+  }
+
+}
+
+CollectionIndex::Result CollectionIndex::Query(const QueryOptions &options, const CollectionModel::GroupBy type, const FilterList &filters, const bool artist_level) const {
+
+  Result result;
+  if (!loaded_) return result;
+
+  const Columns &c = columns_;
+
+  // Turn the parent nodes into column comparisons once, strings are looked up in the pool so songs are only compared by ID.
+  QList<Predicate> predicates;
+  int compilation_requirement = -1;
+  bool no_match = false;
+
+  auto add_string = [&](const QVector<int> &column, const QString &value) {
+    const int id = c.strings.Find(value);
+    if (id == -1) no_match = true;
+    predicates << Predicate(&column, id);
+  };
+  auto add_int = [&](const QVector<int> &column, const int value) {
+    predicates << Predicate(&column, value);
+  };
+  auto add_number = [&](const QVector<int> &column, const int value) {
+    predicates << Predicate(&column, value, true);
+  };
+
+  for (const Filter &filter : filters) {
+    switch (filter.type) {
+      case CollectionModel::GroupBy_AlbumArtist:
+        if (filter.compilation) {
+          compilation_requirement = 1;
+        }
+        else {
+          compilation_requirement = 0;
+          add_string(c.effective_albumartist, filter.key);
+        }
+        break;
+      case CollectionModel::GroupBy_Artist:
+        if (filter.compilation) {
+          compilation_requirement = 1;
+        }
+        else {
+          compilation_requirement = 0;
+          add_string(c.artist, filter.key);
+        }
+        break;
+      case CollectionModel::GroupBy_Album:
+        add_string(c.album, filter.key);
+        add_int(c.album_id, filter.metadata.album_id());
+        break;
+      case CollectionModel::GroupBy_YearAlbum:
+        add_number(c.year, filter.metadata.year());
+        add_string(c.album, filter.metadata.album());
+        add_string(c.grouping, filter.metadata.grouping());
+        break;
+      case CollectionModel::GroupBy_OriginalYearAlbum:
+        add_number(c.year, filter.metadata.year());
+        add_number(c.originalyear, filter.metadata.originalyear());
+        add_string(c.album, filter.metadata.album());
+        add_string(c.grouping, filter.metadata.grouping());
+        break;
+      case CollectionModel::GroupBy_Year:
+        add_number(c.year, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_OriginalYear:
+        add_number(c.effective_originalyear, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_Composer:
+        add_string(c.composer, filter.key);
+        break;
+      case CollectionModel::GroupBy_Performer:
+        add_string(c.performer, filter.key);
+        break;
+      case CollectionModel::GroupBy_Disc:
+        add_int(c.disc, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_Grouping:
+        add_string(c.grouping, filter.key);
+        break;
+      case CollectionModel::GroupBy_Genre:
+        add_string(c.genre, filter.key);
+        break;
+      case CollectionModel::GroupBy_FileType:
+        add_int(c.filetype, filter.metadata.filetype());
+        break;
+      case CollectionModel::GroupBy_Samplerate:
+        add_number(c.samplerate, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_Bitdepth:
+        add_number(c.bitdepth, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_Bitrate:
+        add_number(c.bitrate, filter.key.toInt());
+        break;
+      case CollectionModel::GroupBy_Format:
+        add_int(c.filetype, filter.metadata.filetype());
+        add_number(c.samplerate, filter.metadata.samplerate());
+        add_number(c.bitdepth, filter.metadata.bitdepth());
+        break;
+      case CollectionModel::GroupBy_None:
+        break;
+    }
+  }
+
+  if (no_match) return result;
+
+  // Match every token of the filter text against the unique strings once, songs then only need a lookup per column.
+  QList<QVector<bool>> token_matches;
+  QList<const QVector<int>*> token_columns;
+  QList<TokenMatches> token_cache;
+  if (!options.filter().isEmpty()) {
+    QString filter = options.filter();
+    filter.remove('(');
+    filter.remove(')');
+    filter.remove('"');
+    filter.replace('-', ' ');
+    for (QString token : filter.split(QRegExp("\\s+"), QString::SkipEmptyParts)) {
+      const QVector<int> *column = nullptr;
+      QString column_name;
+      if (token.contains(':')) {
+        column_name = token.section(':', 0, 0).toLower();
+        if (column_name == "title") column = &c.title;
+        else if (column_name == "album") column = &c.album;
+        else if (column_name == "artist") column = &c.artist;
+        else if (column_name == "albumartist") column = &c.albumartist;
+        else if (column_name == "composer") column = &c.composer;
+        else if (column_name == "performer") column = &c.performer;
+        else if (column_name == "grouping") column = &c.grouping;
+        else if (column_name == "genre") column = &c.genre;
+        else if (column_name == "comment") column = &c.comment;
+        if (column) token = token.section(':', 1, -1);
+        else column_name.clear();
+        token.replace(':', ' ');
+        token = token.trimmed();
+      }
+      if (token.isEmpty()) continue;
+      token = Database::FoldString(token);
+
+      // Typing usually only adds to the filter, so strings that didn't match a shorter version of the token don't need to be checked again.
+      const TokenMatches *previous = nullptr;
+      for (const TokenMatches &cached : token_cache_) {
+        if (cached.column == column_name && token.startsWith(cached.token) && (!previous || cached.token.length() > previous->token.length())) {
+          previous = &cached;
+        }
+      }
+
+      TokenMatches token_match;
+      token_match.column = column_name;
+      token_match.token = token;
+      if (previous && previous->token.length() == token.length()) {
+        token_match.matches = previous->matches;
+      }
+      else {
+        token_match.matches.fill(false, c.strings.count());
+        for (int i = 0 ; i < c.strings.count() ; ++i) {
+          if (!previous || previous->matches[i]) token_match.matches[i] = WordStartsWith(c.strings.FoldedString(i), token);
+        }
+      }
+      token_matches << token_match.matches;
+      token_columns << column;
+      token_cache << token_match;
+    }
+  }
+  token_cache_ = token_cache;
+
+  const uint cutoff = options.max_age() == -1 ? 0 : QDateTime::currentDateTime().toTime_t() - options.max_age();
+  const int empty_string = c.strings.Find(QString());
+
+  // For duplicates mode count the songs with the same artist, album and title first.
+  QHash<GroupKey, int> duplicate_counts;
+  const bool duplicates_only = options.query_mode() == QueryOptions::QueryMode_Duplicates;
+  if (duplicates_only) {
+    for (int slot = 0 ; slot < c.count ; ++slot) {
+      if (c.id[slot] == -1 || c.artist[slot] == empty_string || c.album[slot] == empty_string || c.title[slot] == empty_string) continue;
+      GroupKey key;
+      key.v[0] = c.artist[slot];
+      key.v[1] = c.album[slot];
+      key.v[2] = c.title[slot];
+      ++duplicate_counts[key];
+    }
+  }
+
+  QHash<GroupKey, bool> seen;
+
+  for (int slot = 0 ; slot < c.count ; ++slot) {
+    if (c.id[slot] == -1) continue;
+
+    if (cutoff != 0 && c.ctime[slot] <= cutoff) continue;
+
+    if (options.query_mode() == QueryOptions::QueryMode_Untagged && c.artist[slot] != empty_string && c.album[slot] != empty_string && c.title[slot] != empty_string) continue;
+
+    if (duplicates_only) {
+      GroupKey key;
+      key.v[0] = c.artist[slot];
+      key.v[1] = c.album[slot];
+      key.v[2] = c.title[slot];
+      if (duplicate_counts.value(key, 0) < 2) continue;
+    }
+
+    if (compilation_requirement != -1 && c.compilation[slot] != (compilation_requirement == 1)) continue;
+
+    bool matches = true;
+    for (const Predicate &predicate : predicates) {
+      if (!predicate.Matches(slot)) {
+        matches = false;
+        break;
+      }
+    }
+    if (!matches) continue;
+
+    for (int i = 0 ; i < token_matches.count() && matches ; ++i) {
+      const QVector<bool> &token_match = token_matches[i];
+      if (token_columns[i]) {
+        matches = token_match[token_columns[i]->at(slot)];
+      }
+      else {
+        matches = token_match[c.title[slot]] || token_match[c.album[slot]] || token_match[c.artist[slot]] || token_match[c.albumartist[slot]] || token_match[c.composer[slot]] || token_match[c.performer[slot]] || token_match[c.grouping[slot]] || token_match[c.genre[slot]] || token_match[c.comment[slot]];
+      }
+    }
+    if (!matches) continue;
+
+    // Compilations go under the Various artists node instead
+    if (artist_level && c.compilation[slot]) {
+      result.has_compilations = true;
+      continue;
+    }
+
+    if (type == CollectionModel::GroupBy_None) {
+      result.song_ids << c.id[slot];
+      continue;
+    }
+
+    GroupKey key;
+    Song song;
+    switch (type) {
+      case CollectionModel::GroupBy_AlbumArtist:
+        key.v[0] = c.effective_albumartist[slot];
+        song.set_albumartist(c.strings.String(c.effective_albumartist[slot]));
+        break;
+      case CollectionModel::GroupBy_Artist:
+        key.v[0] = c.artist[slot];
+        song.set_artist(c.strings.String(c.artist[slot]));
+        break;
+      case CollectionModel::GroupBy_Album:
+        key.v[0] = c.album[slot];
+        key.v[1] = c.album_id[slot];
+        song.set_album(c.strings.String(c.album[slot]));
+        song.set_album_id(c.album_id[slot]);
+        break;
+      case CollectionModel::GroupBy_YearAlbum:
+        key.v[0] = qMax(0, c.year[slot]);
+        key.v[1] = c.album[slot];
+        key.v[2] = c.grouping[slot];
+        song.set_year(c.year[slot]);
+        song.set_album(c.strings.String(c.album[slot]));
+        song.set_grouping(c.strings.String(c.grouping[slot]));
+        break;
+      case CollectionModel::GroupBy_OriginalYearAlbum:
+        key.v[0] = qMax(0, c.year[slot]);
+        key.v[1] = qMax(0, c.originalyear[slot]);
+        key.v[2] = c.album[slot];
+        key.v[3] = c.grouping[slot];
+        song.set_year(c.year[slot]);
+        song.set_originalyear(c.originalyear[slot]);
+        song.set_album(c.strings.String(c.album[slot]));
+        song.set_grouping(c.strings.String(c.grouping[slot]));
+        break;
+      case CollectionModel::GroupBy_Year:
+        key.v[0] = qMax(0, c.year[slot]);
+        song.set_year(c.year[slot]);
+        break;
+      case CollectionModel::GroupBy_OriginalYear:
+        key.v[0] = qMax(0, c.effective_originalyear[slot]);
+        song.set_year(c.year[slot]);
+        song.set_originalyear(c.originalyear[slot]);
+        break;
+      case CollectionModel::GroupBy_Composer:
+        key.v[0] = c.composer[slot];
+        song.set_composer(c.strings.String(c.composer[slot]));
+        break;
+      case CollectionModel::GroupBy_Performer:
+        key.v[0] = c.performer[slot];
+        song.set_performer(c.strings.String(c.performer[slot]));
+        break;
+      case CollectionModel::GroupBy_Grouping:
+        key.v[0] = c.grouping[slot];
+        song.set_grouping(c.strings.String(c.grouping[slot]));
+        break;
+      case CollectionModel::GroupBy_Genre:
+        key.v[0] = c.genre[slot];
+        song.set_genre(c.strings.String(c.genre[slot]));
+        break;
+      case CollectionModel::GroupBy_Disc:
+        key.v[0] = c.disc[slot];
+        song.set_disc(c.disc[slot]);
+        break;
+      case CollectionModel::GroupBy_FileType:
+        key.v[0] = c.filetype[slot];
+        song.set_filetype(Song::FileType(c.filetype[slot]));
+        break;
+      case CollectionModel::GroupBy_Samplerate:
+        key.v[0] = qMax(0, c.samplerate[slot]);
+        song.set_samplerate(c.samplerate[slot]);
+        break;
+      case CollectionModel::GroupBy_Bitdepth:
+        key.v[0] = qMax(0, c.bitdepth[slot]);
+        song.set_bitdepth(c.bitdepth[slot]);
+        break;
+      case CollectionModel::GroupBy_Bitrate:
+        key.v[0] = qMax(0, c.bitrate[slot]);
+        song.set_bitrate(c.bitrate[slot]);
+        break;
+      case CollectionModel::GroupBy_Format:
+        key.v[0] = c.filetype[slot];
+        key.v[1] = qMax(0, c.samplerate[slot]);
+        key.v[2] = qMax(0, c.bitdepth[slot]);
+        song.set_filetype(Song::FileType(c.filetype[slot]));
+        song.set_samplerate(c.samplerate[slot]);
+        song.set_bitdepth(c.bitdepth[slot]);
+        break;
+      case CollectionModel::GroupBy_None:
+        break;
+    }
+
+    if (seen.contains(key)) continue;
+    seen.insert(key, true);
+    result.containers << song;
+  }
+
+  return result;
+
+}
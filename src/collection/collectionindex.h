@@ -0,0 +1,162 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COLLECTIONINDEX_H
+#define COLLECTIONINDEX_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QFuture>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include "core/song.h"
+#include "collectionquery.h"
+#include "collectionmodel.h"
+
+class CollectionBackend;
+
+// Keeps the columns CollectionModel groups and filters on in memory, so the tree can be built without querying the database for every level.
+// Strings are interned, each song only stores integer IDs.
+// The index is loaded once in a background thread and then kept up to date from the CollectionBackend signals.
+class CollectionIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit CollectionIndex(CollectionBackend *backend, QObject *parent = nullptr);
+
+  // One of the ancestors of the node being populated.
+  struct Filter {
+    Filter() : type(CollectionModel::GroupBy_None), compilation(false) {}
+    CollectionModel::GroupBy type;
+    // Set for the Various artists node
+    bool compilation;
+    QString key;
+    Song metadata;
+  };
+  typedef QList<Filter> FilterList;
+
+  struct Result {
+    Result() : has_compilations(false) {}
+    // One song for each child container, with only the fields used for grouping set.
+    SongList containers;
+    // Database IDs of the songs when the children are songs.
+    QList<int> song_ids;
+    bool has_compilations;
+  };
+
+  struct StringPool {
+    int Intern(const QString &str);
+    int Find(const QString &str) const { return ids_.value(str, -1); }
+    const QString &String(const int id) const { return strings_[id]; }
+    // The string folded like the full text search tokenizer folds it, for filtering.
+    const QString &FoldedString(const int id) const { return folded_[id]; }
+    int count() const { return strings_.count(); }
+
+    QHash<QString, int> ids_;
+    QStringList strings_;
+    QStringList folded_;
+  };
+
+  struct Columns {
+    Columns() : count(0) {}
+
+    int NewSlot();
+    void Set(const int slot, const Song &song);
+    void Remove(const int id);
+
+    int count;
+    StringPool strings;
+    QHash<int, int> slot_by_id;
+    QList<int> free_slots;
+
+    QVector<int> id;
+    QVector<int> title;
+    QVector<int> album;
+    QVector<int> artist;
+    QVector<int> albumartist;
+    QVector<int> effective_albumartist;
+    QVector<int> composer;
+    QVector<int> performer;
+    QVector<int> grouping;
+    QVector<int> genre;
+    QVector<int> comment;
+    QVector<int> year;
+    QVector<int> originalyear;
+    QVector<int> effective_originalyear;
+    QVector<int> disc;
+    QVector<int> filetype;
+    QVector<int> samplerate;
+    QVector<int> bitdepth;
+    QVector<int> bitrate;
+    QVector<int> album_id;
+    QVector<bool> compilation;
+    QVector<uint> ctime;
+  };
+
+  bool is_loaded() const { return loaded_; }
+  int song_count() const { return columns_.slot_by_id.count(); }
+
+  // Returns the children of the node described by filters, grouped by type.
+  // artist_level means compilations are left out and only reported with has_compilations, the same as CollectionModel does for the SQL query.
+  Result Query(const QueryOptions &options, const CollectionModel::GroupBy type, const FilterList &filters, const bool artist_level) const;
+
+ signals:
+  void Loaded();
+
+ public slots:
+  void LoadAsync();
+
+ private slots:
+  void LoadFinished(QFuture<CollectionIndex::Columns> future);
+  void SongsDiscovered(const SongList &songs);
+  void SongsDeleted(const SongList &songs);
+
+ private:
+  Columns Load();
+  void ApplyChanges(const SongList &songs, const bool deleted);
+
+ private:
+  CollectionBackend *backend_;
+
+  bool loaded_;
+  bool loading_;
+  Columns columns_;
+
+  // Matches of the tokens in the last filter, used when the next filter narrows it down.
+  struct TokenMatches {
+    QString column;
+    QString token;
+    QVector<bool> matches;
+  };
+  mutable QList<TokenMatches> token_cache_;
+
+  // Changes received while the index was loading, applied in order once it's done.
+  QList<QPair<SongList, bool>> pending_changes_;
+
+};
+
+#endif  // COLLECTIONINDEX_H
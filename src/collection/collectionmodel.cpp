@@ -44,6 +44,9 @@
 #include <QImage>
 #include <QPixmapCache>
 #include <QSettings>
+#include <QTimer>
+#include <QSharedPointer>
+#include <QAtomicInt>
 #include <QtDebug>
 
 #include "core/application.h"
@@ -51,12 +54,14 @@
 #include "core/database.h"
 #include "core/iconloader.h"
 #include "core/logging.h"
+#include "core/sqlitequery.h"
 #include "core/taskmanager.h"
 #include "collectionquery.h"
 #include "collectionbackend.h"
 #include "collectiondirectorymodel.h"
 #include "collectionitem.h"
 #include "collectionmodel.h"
+#include "collectionindex.h"
 #include "sqlrow.h"
 #include "playlist/playlistmanager.h"
 #include "playlist/songmimedata.h"
@@ -70,6 +75,9 @@ using std::placeholders::_2;
 const char *CollectionModel::kSavedGroupingsSettingsGroup = "SavedGroupings";
 const int CollectionModel::kPrettyCoverSize = 32;
 const qint64 CollectionModel::kIconCacheSize = 100000000;  //~100MB
+const int CollectionModel::kLazyPopulateChunkSize = 200;
+const int CollectionModel::kPrefetchSiblings = 2;
+const int CollectionModel::kMaxPrefetchedResults = 20;
 
 static bool IsArtistGroupBy(const CollectionModel::GroupBy by) {
   return by == CollectionModel::GroupBy_Artist || by == CollectionModel::GroupBy_AlbumArtist;
@@ -82,6 +90,7 @@ static bool IsCompilationArtistNode(const CollectionItem *node) {
 CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, QObject *parent) :
       SimpleTreeModel<CollectionItem>(new CollectionItem(this), parent),
       backend_(backend),
+      index_(nullptr),
       app_(app),
       dir_model_(new CollectionDirectoryModel(backend, this)),
       show_various_artists_(true),
@@ -94,10 +103,17 @@ CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, Q
       playlist_icon_(IconLoader::Load("albums")),
       init_task_id_(-1),
       use_pretty_covers_(false),
-      show_dividers_(true) {
+      show_dividers_(true),
+      reset_generation_(0),
+      next_query_id_(0),
+      insert_timer_(new QTimer(this)) {
 
   root_->lazy_loaded = true;
 
+  insert_timer_->setSingleShot(true);
+  insert_timer_->setInterval(0);
+  connect(insert_timer_, SIGNAL(timeout()), SLOT(InsertPendingRows()));
+
   group_by_[0] = GroupBy_AlbumArtist;
   group_by_[1] = GroupBy_Album;
   group_by_[2] = GroupBy_None;
@@ -271,9 +287,21 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
       }
 
       // If we just created the damn thing then we don't need to continue into it any further because it'll get lazy-loaded properly later.
-      if (!container->lazy_loaded) break;
+      if (!container->lazy_loaded) {
+        prefetched_.remove(container);
+        break;
+      }
+
+      // If the container is still waiting for its query, run it again so the result includes this song.
+      if (pending_populate_.contains(container)) {
+        StartLazyPopulateQuery(container);
+        break;
+      }
+
+      // Make sure the rest of a chunked insert is in the model before checking for existing children.
+      FinishPendingInsert(container);
     }
-    if (!container->lazy_loaded) continue;
+    if (!container->lazy_loaded || pending_populate_.contains(container)) continue;
 
     // We've gone all the way down to the deepest level and everything was already lazy loaded, so now we have to create the song in the container.
     song_nodes_[song.id()] = ItemFromSong(GroupBy_None, true, false, container, song, -1);
@@ -412,6 +440,9 @@ QString CollectionModel::DividerDisplayText(GroupBy type, const QString &key) co
 
 void CollectionModel::SongsDeleted(const SongList &songs) {
 
+  // Containers can get deleted below, so don't leave any of them half populated.
+  FinishPendingInserts();
+
   // Delete the actual song nodes first, keeping track of each parent so we might check to see if they're empty later.
   QSet<CollectionItem*> parents;
   for (const Song &song : songs) {
@@ -458,6 +489,7 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
         container_nodes_[node->container_level].remove(node->key);
 
       // It was empty - delete it
+      ForgetLazyPopulate(node);
       beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
       node->parent->Delete(node->row);
       endRemoveRows();
@@ -704,7 +736,19 @@ bool CollectionModel::HasCompilations(const CollectionQuery &query) {
 
 CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
 
-  QueryResult result;
+  if (UseIndex()) {
+    QList<int> song_ids;
+    QueryResult result = IndexQuery(parent, &song_ids);
+    return LoadIndexSongs(result, song_ids);
+  }
+
+  GroupBy child_type = GroupBy_None;
+  CollectionQuery q = ChildQuery(parent, &child_type);
+  return ExecQuery(q, child_type);
+
+}
+
+CollectionQuery CollectionModel::ChildQuery(CollectionItem *parent, GroupBy *child_type_out) {
 
   // Information about what we want the children to be
   int child_level = parent == root_ ? 0 : parent->container_level + 1;
@@ -721,6 +765,16 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
     p = p->parent;
   }
 
+  *child_type_out = child_type;
+
+  return q;
+
+}
+
+CollectionModel::QueryResult CollectionModel::ExecQuery(CollectionQuery q, const GroupBy child_type) {
+
+  QueryResult result;
+
   // Artists GroupBy is special - we don't want compilation albums appearing
   if (IsArtistGroupBy(child_type)) {
     // Add the special Various artists node
@@ -735,11 +789,93 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
   // Execute the query
   QMutexLocker l(backend_->db()->Mutex());
 
-  if (!backend_->ExecQuery(&q)) return result;
+  // Don't bother if the result isn't wanted anymore, this query might have been waiting for the mutex for a while.
+  if (Database::IsCancelled()) return result;
 
-  while (q.Next()) {
-    result.rows << SqlRow(q);
+  SqliteQuery query(backend_->db()->Connect());
+  if (!backend_->ExecQuery(&q, &query)) return result;
+
+  // Songs are decoded straight from the statement, only the few columns of containers go through SqlRow.
+  if (child_type == GroupBy_None) {
+    while (query.Next()) {
+      Song song;
+      song.InitFromQuery(query, true);
+      result.songs << song;
+    }
   }
+  else {
+    while (query.Next()) {
+      result.rows << SqlRow(query);
+    }
+  }
+  return result;
+
+}
+
+CollectionModel::QueryResult CollectionModel::ExecCancellableQuery(CollectionQuery q, const GroupBy child_type, QSharedPointer<QAtomicInt> cancel) {
+
+  if (cancel->load()) return QueryResult();
+
+  Database::SetCancelFlag(cancel.data());
+  QueryResult result = ExecQuery(q, child_type);
+  Database::SetCancelFlag(nullptr);
+
+  return result;
+
+}
+
+int CollectionModel::NextResetGeneration() {
+
+  if (reset_cancel_) {
+    reset_cancel_->store(1);
+    reset_cancel_.reset();
+  }
+  return ++reset_generation_;
+
+}
+
+bool CollectionModel::UseIndex() const {
+  return index_ && index_->is_loaded();
+}
+
+CollectionModel::QueryResult CollectionModel::IndexQuery(CollectionItem *parent, QList<int> *song_ids) {
+
+  // Information about what we want the children to be
+  int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+
+  // Walk up through the item's parents, the same as ChildQuery does
+  CollectionIndex::FilterList filters;
+  CollectionItem *p = parent;
+  while (p && p->type == CollectionItem::Type_Container) {
+    CollectionIndex::Filter filter;
+    filter.type = group_by_[p->container_level];
+    filter.compilation = IsCompilationArtistNode(p);
+    filter.key = p->key;
+    filter.metadata = p->metadata;
+    filters << filter;
+    p = p->parent;
+  }
+
+  CollectionIndex::Result index_result = index_->Query(query_options_, child_type, filters, IsArtistGroupBy(child_type));
+
+  QueryResult result;
+  result.create_va = show_various_artists_ && index_result.has_compilations;
+  if (child_type == GroupBy_None) {
+    // The index only has the grouped columns, songs are loaded from the database by ID.
+    *song_ids = index_result.song_ids;
+  }
+  else {
+    result.songs = index_result.containers;
+  }
+
+  return result;
+
+}
+
+CollectionModel::QueryResult CollectionModel::LoadIndexSongs(QueryResult result, const QList<int> &song_ids) {
+
+  if (!song_ids.isEmpty()) result.songs = backend_->GetSongsById(song_ids);
   return result;
 
 }
@@ -766,27 +902,281 @@ void CollectionModel::PostQuery(CollectionItem *parent, const CollectionModel::Q
       container_nodes_[child_level][item->key] = item;
   }
 
+  for (const Song &song : result.songs) {
+    CollectionItem *item = ItemFromSong(child_type, signal, child_level == 0, parent, song, child_level);
+
+    if (child_type == GroupBy_None)
+      song_nodes_[item->metadata.id()] = item;
+    else
+      container_nodes_[child_level][item->key] = item;
+  }
+
 }
 
 void CollectionModel::LazyPopulate(CollectionItem *parent, bool signal) {
 
-  if (parent->lazy_loaded) return;
+  if (pending_populate_.contains(parent)) {
+    // The background query hasn't finished yet, so drop it and populate the node now.
+    pending_populate_.remove(parent);
+    for (int id : pending_queries_.keys(parent)) pending_queries_.remove(id);
+    RemoveLoadingIndicator(parent);
+  }
+  else {
+    FinishPendingInsert(parent);
+    if (parent->lazy_loaded) return;
+  }
   parent->lazy_loaded = true;
 
-  QueryResult result = RunQuery(parent);
+  QueryResult result = prefetched_.contains(parent) ? prefetched_.take(parent) : RunQuery(parent);
   PostQuery(parent, result, signal);
 
 }
 
+void CollectionModel::LazyPopulate(CollectionItem *parent) {
+
+  if (parent->lazy_loaded) return;
+  parent->lazy_loaded = true;
+
+  // The index answers container queries quickly enough to skip the loading indicator, the rows are still inserted a chunk at a time.
+  // Songs still have to be loaded from the database, which is done in the background like a normal query.
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  const GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+  if ((UseIndex() && child_type != GroupBy_None) || prefetched_.contains(parent)) {
+    PendingInsert pending;
+    pending.parent = parent;
+    if (prefetched_.contains(parent)) {
+      pending.result = prefetched_.take(parent);
+    }
+    else {
+      QList<int> song_ids;
+      pending.result = IndexQuery(parent, &song_ids);
+    }
+    pending_inserts_ << pending;
+    insert_timer_->start();
+    return;
+  }
+
+  // Show a loading indicator under the node until the query has finished.
+  CollectionItem *loading = new CollectionItem(CollectionItem::Type_LoadingIndicator);
+  loading->display_text = tr("Loading...");
+  loading->lazy_loaded = true;
+  loading->InsertNotify(parent);
+
+  pending_populate_ << parent;
+
+  // A prefetch for this node might already be running, in which case its result is used.
+  if (pending_queries_.key(parent, -1) == -1) {
+    StartLazyPopulateQuery(parent);
+  }
+
+}
+
+void CollectionModel::LazyPopulateNow(const QModelIndex &index) {
+  LazyPopulate(IndexToItem(index), true);
+}
+
+void CollectionModel::StartLazyPopulateQuery(CollectionItem *parent) {
+
+  // Forget any query that is already running for this node, its result might be out of date.
+  for (int id : pending_queries_.keys(parent)) pending_queries_.remove(id);
+
+  const int id = next_query_id_++;
+  pending_queries_.insert(id, parent);
+
+  QFuture<CollectionModel::QueryResult> future;
+  if (UseIndex()) {
+    QList<int> song_ids;
+    QueryResult result = IndexQuery(parent, &song_ids);
+    future = QtConcurrent::run(this, &CollectionModel::LoadIndexSongs, result, song_ids);
+  }
+  else {
+    GroupBy child_type = GroupBy_None;
+    CollectionQuery q = ChildQuery(parent, &child_type);
+    future = QtConcurrent::run(this, &CollectionModel::ExecQuery, q, child_type);
+  }
+  NewClosure(future, this, SLOT(LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult>, int)), future, id);
+
+}
+
+void CollectionModel::LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult> future, int id) {
+
+  // The model was reset or the node was populated some other way in the meantime.
+  if (!pending_queries_.contains(id)) return;
+
+  CollectionItem *parent = pending_queries_.take(id);
+
+  if (!pending_populate_.contains(parent)) {
+    // This was a prefetch, keep the result until the node is expanded.
+    if (!parent->lazy_loaded) prefetched_[parent] = future.result();
+    return;
+  }
+
+  pending_populate_.remove(parent);
+  RemoveLoadingIndicator(parent);
+
+  PendingInsert pending;
+  pending.parent = parent;
+  pending.result = future.result();
+  pending_inserts_ << pending;
+  insert_timer_->start();
+
+}
+
+void CollectionModel::InsertPendingRows() {
+
+  if (pending_inserts_.isEmpty()) return;
+
+  PendingInsert &pending = pending_inserts_.first();
+  InsertQueryRows(&pending, kLazyPopulateChunkSize);
+
+  if (pending.next_row >= pending.result.count()) {
+    CollectionItem *parent = pending.parent;
+    pending_inserts_.removeFirst();
+    PrefetchSiblings(parent);
+  }
+
+  if (!pending_inserts_.isEmpty()) insert_timer_->start();
+
+}
+
+void CollectionModel::InsertQueryRows(PendingInsert *pending, const int count) {
+
+  CollectionItem *parent = pending->parent;
+
+  // Information about what we want the children to be
+  int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+
+  if (pending->next_row == 0 && pending->result.create_va && !parent->compilation_artist_node_) {
+    CreateCompilationArtistNode(true, parent);
+  }
+
+  const int rows = pending->result.rows.count();
+  const int end = count == -1 ? pending->result.count() : qMin(pending->result.count(), pending->next_row + count);
+  if (end <= pending->next_row) return;
+
+  // Insert the whole chunk with one signal
+  beginInsertRows(ItemToIndex(parent), parent->children.count(), parent->children.count() + end - pending->next_row - 1);
+  for (int i = pending->next_row ; i < end ; ++i) {
+    CollectionItem *item = i < rows ? ItemFromQuery(child_type, false, child_level == 0, parent, pending->result.rows[i], child_level) : ItemFromSong(child_type, false, child_level == 0, parent, pending->result.songs[i - rows], child_level);
+
+    // Save a pointer to it for later
+    if (child_type == GroupBy_None)
+      song_nodes_[item->metadata.id()] = item;
+    else
+      container_nodes_[child_level][item->key] = item;
+  }
+  endInsertRows();
+
+  pending->next_row = end;
+
+}
+
+void CollectionModel::FinishPendingInsert(CollectionItem *parent) {
+
+  for (int i = 0 ; i < pending_inserts_.count() ; ++i) {
+    if (pending_inserts_[i].parent == parent) {
+      InsertQueryRows(&pending_inserts_[i], -1);
+      pending_inserts_.removeAt(i);
+      return;
+    }
+  }
+
+}
+
+void CollectionModel::FinishPendingInserts() {
+
+  while (!pending_inserts_.isEmpty()) {
+    InsertQueryRows(&pending_inserts_.first(), -1);
+    pending_inserts_.removeFirst();
+  }
+
+}
+
+void CollectionModel::RemoveLoadingIndicator(CollectionItem *parent) {
+
+  for (int i = 0 ; i < parent->children.count() ; ++i) {
+    if (parent->children[i]->type == CollectionItem::Type_LoadingIndicator) {
+      parent->DeleteNotify(i);
+      return;
+    }
+  }
+
+}
+
+void CollectionModel::ForgetLazyPopulate(CollectionItem *item) {
+
+  // The item is about to be deleted, so a query still running for it must not find it when it finishes.
+  pending_populate_.remove(item);
+  for (int id : pending_queries_.keys(item)) pending_queries_.remove(id);
+  prefetched_.remove(item);
+
+}
+
+void CollectionModel::PrefetchSiblings(CollectionItem *item) {
+
+  // Nodes next to one the user expanded are likely to be expanded next, so run their queries in the background.
+  if (UseIndex() || !item->parent || item->type != CollectionItem::Type_Container) return;
+
+  CollectionItem *parent = item->parent;
+  int prefetched = 0;
+  for (int row = item->row + 1 ; row < parent->children.count() && prefetched < kPrefetchSiblings ; ++row) {
+    if (prefetched_.count() + pending_queries_.count() >= kMaxPrefetchedResults) break;
+
+    CollectionItem *sibling = parent->children[row];
+    if (sibling->type != CollectionItem::Type_Container || sibling->lazy_loaded || prefetched_.contains(sibling) || pending_queries_.key(sibling, -1) != -1) continue;
+
+    const int id = next_query_id_++;
+    pending_queries_.insert(id, sibling);
+
+    GroupBy child_type = GroupBy_None;
+    CollectionQuery q = ChildQuery(sibling, &child_type);
+
+    QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::ExecQuery, q, child_type);
+    NewClosure(future, this, SLOT(LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult>, int)), future, id);
+    ++prefetched;
+  }
+
+}
+
 void CollectionModel::ResetAsync() {
-  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::RunQuery, root_);
-  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult>)), future);
+
+  // A previous reset that hasn't finished yet is out of date now, its query is interrupted and the result dropped.
+  const int generation = NextResetGeneration();
+
+  QFuture<CollectionModel::QueryResult> future;
+  if (UseIndex()) {
+    QList<int> song_ids;
+    QueryResult result = IndexQuery(root_, &song_ids);
+    if (song_ids.isEmpty()) {
+      PostReset(result);
+      return;
+    }
+    // Without grouping the top level lists songs, which are loaded from the database in the background.
+    future = QtConcurrent::run(this, &CollectionModel::LoadIndexSongs, result, song_ids);
+  }
+  else {
+    GroupBy child_type = GroupBy_None;
+    CollectionQuery q = ChildQuery(root_, &child_type);
+
+    reset_cancel_ = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+
+    future = QtConcurrent::run(this, &CollectionModel::ExecCancellableQuery, q, child_type, reset_cancel_);
+  }
+  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult>, int)), future, generation);
 
 }
 
-void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future) {
+void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future, int generation) {
+
+  if (generation != reset_generation_) return;
+  reset_cancel_.reset();
+
+  PostReset(future.result());
+
+}
 
-  const struct QueryResult result = future.result();
+void CollectionModel::PostReset(const QueryResult &result) {
 
   BeginReset();
   root_->lazy_loaded = true;
@@ -812,6 +1202,11 @@ void CollectionModel::BeginReset() {
   container_nodes_[2].clear();
   divider_nodes_.clear();
   pending_art_.clear();
+  pending_queries_.clear();
+  pending_populate_.clear();
+  pending_inserts_.clear();
+  prefetched_.clear();
+  insert_timer_->stop();
 
   root_ = new CollectionItem(this);
   root_->compilation_artist_node_ = nullptr;
@@ -821,6 +1216,7 @@ void CollectionModel::BeginReset() {
 
 void CollectionModel::Reset() {
 
+  NextResetGeneration();
   BeginReset();
 
   // Populate top level
@@ -1131,6 +1527,7 @@ CollectionItem *CollectionModel::ItemFromSong(GroupBy type, bool signal, bool cr
       int year = qMax(0, s.year());
       item->metadata.set_year(year);
       item->metadata.set_album(s.album());
+      item->metadata.set_grouping(s.grouping());
       item->key = PrettyYearAlbum(year, s.album());
       item->sort_text = SortTextForNumber(year) + s.grouping() + s.album();
       break;
@@ -1142,6 +1539,7 @@ CollectionItem *CollectionModel::ItemFromSong(GroupBy type, bool signal, bool cr
       item->metadata.set_year(year);
       item->metadata.set_originalyear(originalyear);
       item->metadata.set_album(s.album());
+      item->metadata.set_grouping(s.grouping());
       item->key = PrettyYearAlbum(effective_originalyear, s.album());
       item->sort_text = SortTextForNumber(effective_originalyear) + s.grouping() + s.album();
       break;
@@ -1379,7 +1777,7 @@ void CollectionModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls, Son
 
   switch (item->type) {
     case CollectionItem::Type_Container: {
-      const_cast<CollectionModel*>(this)->LazyPopulate(item);
+      const_cast<CollectionModel*>(this)->LazyPopulate(item, true);
 
       QList<CollectionItem*> children = item->children;
       std::sort(children.begin(), children.end(), std::bind(&CollectionModel::CompareItems, this, _1, _2));
@@ -45,6 +45,9 @@
 #include <QPixmap>
 #include <QNetworkDiskCache>
 #include <QSettings>
+#include <QTimer>
+#include <QSharedPointer>
+#include <QAtomicInt>
 
 #include "core/simpletreemodel.h"
 #include "core/song.h"
@@ -57,6 +60,7 @@ class Application;
 class CollectionBackend;
 class CollectionDirectoryModel;
 class CollectionItem;
+class CollectionIndex;
 
 class CollectionModel : public SimpleTreeModel<CollectionItem> {
   Q_OBJECT
@@ -70,6 +74,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   static const int kPrettyCoverSize;
   static const qint64 kIconCacheSize;
+  static const int kLazyPopulateChunkSize;
+  static const int kPrefetchSiblings;
+  static const int kMaxPrefetchedResults;
 
   enum Role {
     Role_Type = Qt::UserRole + 1,
@@ -123,13 +130,21 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   struct QueryResult {
     QueryResult() : create_va(false) {}
 
+    int count() const { return rows.count() + songs.count(); }
+
+    // Container rows, with just the grouped columns.
     SqlRowList rows;
+    // Song rows, and containers when the result comes from the collection index.
+    SongList songs;
     bool create_va;
   };
 
   CollectionBackend *backend() const { return backend_; }
   CollectionDirectoryModel *directory_model() const { return dir_model_; }
 
+  // When set, nodes are populated from the in-memory index once it has loaded instead of querying the database.
+  void set_collection_index(CollectionIndex *index) { index_ = index; }
+
   // Call before Init()
   void set_show_various_artists(bool show_various_artists) { show_various_artists_ = show_various_artists; }
 
@@ -138,6 +153,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   SongList GetChildSongs(const QModelIndex &index) const;
   SongList GetChildSongs(const QModelIndexList &indexes) const;
 
+  // Populates the node straight away instead of in the background, for callers that need the children immediately.
+  void LazyPopulateNow(const QModelIndex &index);
+
   // Might be accurate
   int total_song_count() const { return total_song_count_; }
   int total_artist_count() const { return total_artist_count_; }
@@ -188,7 +206,8 @@ signals:
   void ResetAsync();
 
  protected:
-  void LazyPopulate(CollectionItem *item) { LazyPopulate(item, true); }
+  // Called when a node is expanded: shows a loading indicator and runs the query in a background thread.
+  void LazyPopulate(CollectionItem *item);
   void LazyPopulate(CollectionItem *item, bool signal);
 
  private slots:
@@ -201,7 +220,11 @@ signals:
   void TotalAlbumCountUpdatedSlot(int count);
 
   // Called after ResetAsync
-  void ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future);
+  void ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future, int generation);
+
+  // Called after an asynchronous LazyPopulate or prefetch
+  void LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult> future, int id);
+  void InsertPendingRows();
 
   void AlbumArtLoaded(quint64 id, const QImage &image);
 
@@ -211,6 +234,36 @@ signals:
   QueryResult RunQuery(CollectionItem *parent);
   void PostQuery(CollectionItem *parent, const QueryResult &result, bool signal);
 
+  // Builds the query for the children of parent in the GUI thread, ExecQuery can then run it in any thread.
+  CollectionQuery ChildQuery(CollectionItem *parent, GroupBy *child_type);
+  QueryResult ExecQuery(CollectionQuery q, const GroupBy child_type);
+  // Same as ExecQuery, but gives up as soon as cancel is set.
+  QueryResult ExecCancellableQuery(CollectionQuery q, const GroupBy child_type, QSharedPointer<QAtomicInt> cancel);
+  // Cancels the query of a pending asynchronous reset, returns the number identifying the next reset.
+  int NextResetGeneration();
+
+  bool UseIndex() const;
+  // Answers the query from the in-memory index in the GUI thread, song rows are only returned as IDs in song_ids.
+  QueryResult IndexQuery(CollectionItem *parent, QList<int> *song_ids);
+  // Loads the songs IndexQuery returned as IDs from the database, can run in any thread.
+  QueryResult LoadIndexSongs(QueryResult result, const QList<int> &song_ids);
+  void PostReset(const QueryResult &result);
+
+  // Helpers for asynchronous lazy loading.
+  struct PendingInsert {
+    PendingInsert() : parent(nullptr), next_row(0) {}
+    CollectionItem *parent;
+    QueryResult result;
+    int next_row;
+  };
+  void StartLazyPopulateQuery(CollectionItem *parent);
+  void InsertQueryRows(PendingInsert *pending, const int count);
+  void FinishPendingInsert(CollectionItem *parent);
+  void FinishPendingInserts();
+  void RemoveLoadingIndicator(CollectionItem *parent);
+  void ForgetLazyPopulate(CollectionItem *item);
+  void PrefetchSiblings(CollectionItem *item);
+
   bool HasCompilations(const CollectionQuery &query);
 
   void BeginReset();
@@ -243,6 +296,7 @@ signals:
 
  private:
   CollectionBackend *backend_;
+  CollectionIndex *index_;
   Application *app_;
   CollectionDirectoryModel *dir_model_;
   bool show_various_artists_;
@@ -282,6 +336,21 @@ signals:
   typedef QPair<CollectionItem*, QString> ItemAndCacheKey;
   QMap<quint64, ItemAndCacheKey> pending_art_;
   QSet<QString> pending_cache_keys_;
+
+  // Results of asynchronous resets are only used if they are from the latest one.
+  int reset_generation_;
+  QSharedPointer<QAtomicInt> reset_cancel_;
+
+  // Background queries for lazy loading, keyed on request ID.
+  int next_query_id_;
+  QMap<int, CollectionItem*> pending_queries_;
+  // Expanded nodes that are showing a loading indicator while their query runs.
+  QSet<CollectionItem*> pending_populate_;
+  // Query results that are inserted into the model a chunk at a time.
+  QList<PendingInsert> pending_inserts_;
+  QTimer *insert_timer_;
+  // Results for siblings of expanded nodes, used when they get expanded too.
+  QMap<CollectionItem*, QueryResult> prefetched_;
 };
 
 Q_DECLARE_METATYPE(CollectionModel::Grouping);
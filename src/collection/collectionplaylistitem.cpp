@@ -25,10 +25,9 @@
 #include <QUrl>
 
 #include "collectionplaylistitem.h"
+#include "core/sqlitequery.h"
 #include "core/tagreaderclient.h"
 
-class SqlRow;
-
 CollectionPlaylistItem::CollectionPlaylistItem() : PlaylistItem(Song::Source_Collection) {
   song_.set_source(Song::Source_Collection);
 }
@@ -43,7 +42,7 @@ void CollectionPlaylistItem::Reload() {
   TagReaderClient::Instance()->ReadFileBlocking(song_.url().toLocalFile(), &song_);
 }
 
-bool CollectionPlaylistItem::InitFromQuery(const SqlRow &query) {
+bool CollectionPlaylistItem::InitFromQuery(const SqliteQuery &query) {
   // Rows from the songs tables come first
   song_.InitFromQuery(query, true);
   song_.set_source(Song::Source_Collection);
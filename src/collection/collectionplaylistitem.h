@@ -32,14 +32,14 @@
 #include "core/song.h"
 #include "playlist/playlistitem.h"
 
-class SqlRow;
+class SqliteQuery;
 
 class CollectionPlaylistItem : public PlaylistItem {
  public:
   CollectionPlaylistItem();
   CollectionPlaylistItem(const Song &song);
 
-  bool InitFromQuery(const SqlRow &query);
+  bool InitFromQuery(const SqliteQuery &query);
   void Reload();
 
   Song Metadata() const;
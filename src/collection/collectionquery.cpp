@@ -33,6 +33,7 @@
 #include "collectionquery.h"
 #include "core/logging.h"
 #include "core/song.h"
+#include "core/sqlitequery.h"
 
 QueryOptions::QueryOptions() : max_age_(-1), query_mode_(QueryMode_All) {}
 
@@ -40,8 +41,8 @@ CollectionQuery::CollectionQuery(const QueryOptions &options)
     : include_unavailable_(false), join_with_fts_(false), limit_(-1) {
 
   if (!options.filter().isEmpty()) {
-    // We need to munge the filter text a little bit to get it to work as expected with sqlite's FTS3:
-    //  1) Append * to all tokens.
+    // We need to munge the filter text a little bit to get it to work as expected with sqlite's FTS5:
+    //  1) Quote all tokens and append * to make them prefix queries.
     //  2) Prefix "fts" to column names.
     //  3) Remove colons which don't correspond to column names.
 
@@ -54,30 +55,29 @@ CollectionQuery::CollectionQuery(const QueryOptions &options)
       token.remove('"');
       token.replace('-', ' ');
 
+      QString column;
       if (token.contains(':')) {
         // Only prefix fts if the token is a valid column name.
         if (Song::kFtsColumns.contains("fts" + token.section(':', 0, 0), Qt::CaseInsensitive)) {
           // Account for multiple colons.
-          QString columntoken = token.section(':', 0, 0, QString::SectionIncludeTrailingSep);
-          QString subtoken = token.section(':', 1, -1);
-          subtoken.replace(":", " ");
-          subtoken = subtoken.trimmed();
-          query += "fts" + columntoken + subtoken + "* ";
+          column = "fts" + token.section(':', 0, 0, QString::SectionIncludeTrailingSep);
+          token = token.section(':', 1, -1);
         }
-        else {
-          token.replace(":", " ");
-          token = token.trimmed();
-          query += token + "* ";
-        }
-      }
-      else {
-        query += token + "* ";
+        token.replace(":", " ");
       }
+      token = token.trimmed();
+
+      // FTS5 doesn't allow empty phrases.
+      if (token.isEmpty()) continue;
+
+      query += column + "\"" + token + "\"* ";
     }
 
-    where_clauses_ << "fts.%fts_table_noprefix MATCH ?";
-    bound_values_ << query;
-    join_with_fts_ = true;
+    if (!query.isEmpty()) {
+      where_clauses_ << "fts.%fts_table_noprefix MATCH ?";
+      bound_values_ << query;
+      join_with_fts_ = true;
+    }
   }
 
   if (options.max_age() != -1) {
@@ -87,12 +87,6 @@ CollectionQuery::CollectionQuery(const QueryOptions &options)
     bound_values_ << cutoff;
   }
 
-  // TODO: Currently you cannot use any QueryMode other than All and fts at the same time.
-  // Joining songs, duplicated_songs and songs_fts all together takes a huge amount of time.
-  // The query takes about 20 seconds on my machine then. Why?
-  // Untagged mode could work with additional filtering but I'm disabling it just to be consistent
-  // this way filtering is available only in the All mode.
-  // Remember though that when you fix the Duplicates + FTS cooperation, enable the filtering in both Duplicates and Untagged modes.
   duplicates_only_ = options.query_mode() == QueryOptions::QueryMode_Duplicates;
 
   if (options.query_mode() == QueryOptions::QueryMode_Untagged) {
@@ -102,11 +96,12 @@ CollectionQuery::CollectionQuery(const QueryOptions &options)
 }
 
 QString CollectionQuery::GetInnerQuery() {
+  // duplicated_songs is a table kept up to date by CollectionBackend, so joining it is cheap and works together with fts.
   return duplicates_only_
-             ? QString(" INNER JOIN (select * from duplicated_songs) dsongs        "
-                   "ON (%songs_table.artist = dsongs.dup_artist       "
-                   "AND %songs_table.album = dsongs.dup_album     "
-                   "AND %songs_table.title = dsongs.dup_title)    ")
+             ? QString(" INNER JOIN duplicated_songs dsongs "
+                   "ON (%songs_table.artist = dsongs.dup_artist "
+                   "AND %songs_table.album = dsongs.dup_album "
+                   "AND %songs_table.title = dsongs.dup_title) ")
              : QString();
 }
 
@@ -151,12 +146,12 @@ void CollectionQuery::AddCompilationRequirement(bool compilation) {
 
 }
 
-QSqlQuery CollectionQuery::Exec(QSqlDatabase db, const QString &songs_table, const QString &fts_table) {
+QString CollectionQuery::GetQuery(const QString &songs_table, const QString &fts_table) {
 
   QString sql;
 
   if (join_with_fts_) {
-    sql = QString("SELECT %1 FROM %2 INNER JOIN %3 AS fts ON %2.ROWID = fts.ROWID").arg(column_spec_, songs_table, fts_table);
+    sql = QString("SELECT %1 FROM %2 INNER JOIN %3 AS fts ON %2.ROWID = fts.ROWID %4").arg(column_spec_, songs_table, fts_table, GetInnerQuery());
   }
   else {
     sql = QString("SELECT %1 FROM %2 %3").arg(column_spec_, songs_table, GetInnerQuery());
@@ -177,8 +172,14 @@ QSqlQuery CollectionQuery::Exec(QSqlDatabase db, const QString &songs_table, con
   sql.replace("%fts_table_noprefix", fts_table.section('.', -1, -1));
   sql.replace("%fts_table", fts_table);
 
+  return sql;
+
+}
+
+QSqlQuery CollectionQuery::Exec(QSqlDatabase db, const QString &songs_table, const QString &fts_table) {
+
   query_ = QSqlQuery(db);
-  query_.prepare(sql);
+  query_.prepare(GetQuery(songs_table, fts_table));
 
   // Bind values
   for (const QVariant &value : bound_values_) {
@@ -190,6 +191,18 @@ QSqlQuery CollectionQuery::Exec(QSqlDatabase db, const QString &songs_table, con
 
 }
 
+void CollectionQuery::Exec(SqliteQuery *query, const QString &songs_table, const QString &fts_table) {
+
+  if (!query->Prepare(GetQuery(songs_table, fts_table))) return;
+
+  for (const QVariant &value : bound_values_) {
+    query->AddBindValue(value);
+  }
+
+  query->Exec();
+
+}
+
 bool CollectionQuery::Next() { return query_.next(); }
 
 QVariant CollectionQuery::Value(int column) const { return query_.value(column); }
@@ -34,14 +34,15 @@
 
 class Song;
 class CollectionBackend;
+class SqliteQuery;
 
 // This structure let's you customize behaviour of any CollectionQuery.
 struct QueryOptions {
   // Modes of CollectionQuery:
   // - use the all songs table
-  // - use the duplicated songs view; by duplicated we mean those songs for which the (artist, album, title) tuple is found more than once in the songs table
+  // - use the duplicated songs table; by duplicated we mean those songs for which the (artist, album, title) tuple is found more than once in the songs table
   // - use the untagged songs view; by untagged we mean those for which at least one of the (artist, album, title) tags is empty
-  // Please note that additional filtering based on fts table (the filter attribute) won't work in Duplicates and Untagged modes.
+  // The filter can be used in all modes.
   enum QueryMode {
     QueryMode_All,
     QueryMode_Duplicates,
@@ -53,19 +54,13 @@ struct QueryOptions {
   bool Matches(const Song &song) const;
 
   QString filter() const { return filter_; }
-  void set_filter(const QString &filter) {
-    this->filter_ = filter;
-    this->query_mode_ = QueryMode_All;
-  }
+  void set_filter(const QString &filter) { this->filter_ = filter; }
 
   int max_age() const { return max_age_; }
   void set_max_age(int max_age) { this->max_age_ = max_age; }
 
   QueryMode query_mode() const { return query_mode_; }
-  void set_query_mode(QueryMode query_mode) {
-    this->query_mode_ = query_mode;
-    this->filter_ = QString();
-  }
+  void set_query_mode(QueryMode query_mode) { this->query_mode_ = query_mode; }
 
  private:
   QString filter_;
@@ -92,6 +87,8 @@ class CollectionQuery {
   void SetIncludeUnavailable(bool include_unavailable) { include_unavailable_ = include_unavailable; }
 
   QSqlQuery Exec(QSqlDatabase db, const QString &songs_table, const QString &fts_table);
+  // Runs the query on a SqliteQuery instead, for reading many rows.
+  void Exec(SqliteQuery *query, const QString &songs_table, const QString &fts_table);
   bool Next();
   QVariant Value(int column) const;
 
@@ -99,6 +96,7 @@ class CollectionQuery {
 
  private:
   QString GetInnerQuery();
+  QString GetQuery(const QString &songs_table, const QString &fts_table);
 
   bool include_unavailable_;
   bool join_with_fts_;
@@ -166,7 +166,8 @@ void CollectionView::RestoreFocus() {
 bool CollectionView::RestoreLevelFocus(const QModelIndex &parent) {
 
   if (model()->canFetchMore(parent)) {
-    model()->fetchMore(parent);
+    // Populate straight away, fetchMore would only start loading the node in the background.
+    app_->collection_model()->LazyPopulateNow(qobject_cast<QSortFilterProxyModel*>(model())->mapToSource(parent));
   }
   int rows = model()->rowCount(parent);
   for (int i = 0; i < rows; i++) {
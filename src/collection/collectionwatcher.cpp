@@ -31,6 +31,7 @@
 #include <QHash>
 #include <QMap>
 #include <QList>
+#include <QPair>
 #include <QSet>
 #include <QTimer>
 #include <QVariant>
@@ -64,6 +65,10 @@ static const char *kNoMusicFile = ".nomusic";
 
 QStringList CollectionWatcher::sValidImages;
 
+const int CollectionWatcher::kScanBatchSize = 500;
+const int CollectionWatcher::kPeriodicScanInterval = 30 * 60 * 1000;
+const int CollectionWatcher::kDeferredScanDelay = 30 * 1000;
+
 CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
     : QObject(parent),
       source_(source),
@@ -73,14 +78,23 @@ CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
       stop_requested_(false),
       scan_on_startup_(true),
       monitor_(true),
+      skip_initial_scan_(false),
       rescan_timer_(new QTimer(this)),
+      rescan_all_queued_(false),
+      periodic_scan_timer_(new QTimer(this)),
       rescan_paused_(false),
+      deferred_scan_timer_(new QTimer(this)),
       total_watches_(0),
       cue_parser_(new CueParser(backend_, this)) {
 
   rescan_timer_->setInterval(1000);
   rescan_timer_->setSingleShot(true);
 
+  periodic_scan_timer_->setInterval(kPeriodicScanInterval);
+
+  deferred_scan_timer_->setInterval(kDeferredScanDelay);
+  deferred_scan_timer_->setSingleShot(true);
+
   if (sValidImages.isEmpty()) {
     sValidImages << "jpg" << "png" << "gif" << "jpeg";
   }
@@ -88,6 +102,14 @@ CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
   ReloadSettings();
 
   connect(rescan_timer_, SIGNAL(timeout()), SLOT(RescanPathsNow()));
+  connect(periodic_scan_timer_, SIGNAL(timeout()), SLOT(QueueIncrementalScan()));
+  connect(deferred_scan_timer_, SIGNAL(timeout()), SLOT(ScanDeferredSubdirs()));
+
+  connect(fs_watcher_, SIGNAL(PathChanged(const QString&)), SLOT(DirectoryChanged(const QString&)));
+  connect(fs_watcher_, SIGNAL(FileChanged(const QString&)), SLOT(FileChanged(const QString&)));
+  connect(fs_watcher_, SIGNAL(EventsLost()), SLOT(QueueIncrementalScan()));
+  connect(fs_watcher_, SIGNAL(WatchLimitReached()), SLOT(WatchLimitReached()));
+
 }
 
 CollectionWatcher::ScanTransaction::ScanTransaction(CollectionWatcher *watcher, int dir, bool incremental, bool ignores_mtime)
@@ -114,9 +136,18 @@ CollectionWatcher::ScanTransaction::ScanTransaction(CollectionWatcher *watcher,
 
 CollectionWatcher::ScanTransaction::~ScanTransaction() {
 
-  // If we're stopping then don't commit the transaction
+  // If we're stopping then don't commit the rest of the transaction
   if (watcher_->stop_requested_) return;
 
+  CommitScanResults();
+
+  watcher_->task_manager_->SetTaskFinished(task_id_);
+  emit watcher_->ScanFinished(task_id_);
+
+}
+
+void CollectionWatcher::ScanTransaction::CommitScanResults() {
+
   if (!new_songs.isEmpty()) emit watcher_->NewOrUpdatedSongs(new_songs);
 
   if (!touched_songs.isEmpty()) emit watcher_->SongsMTimeUpdated(touched_songs);
@@ -130,8 +161,6 @@ CollectionWatcher::ScanTransaction::~ScanTransaction() {
   if (!touched_subdirs.isEmpty())
     emit watcher_->SubdirsMTimeUpdated(touched_subdirs);
 
-  watcher_->task_manager_->SetTaskFinished(task_id_);
-
   if (watcher_->monitor_) {
     // Watch the new subdirectories
     for (const Subdirectory &subdir : new_subdirs) {
@@ -139,6 +168,20 @@ CollectionWatcher::ScanTransaction::~ScanTransaction() {
     }
   }
 
+  new_songs.clear();
+  touched_songs.clear();
+  deleted_songs.clear();
+  readded_songs.clear();
+  new_subdirs.clear();
+  touched_subdirs.clear();
+
+}
+
+void CollectionWatcher::ScanTransaction::CommitScanResultsIfNeeded() {
+
+  const int count = new_songs.count() + touched_songs.count() + deleted_songs.count() + readded_songs.count() + new_subdirs.count() + touched_subdirs.count();
+  if (count >= kScanBatchSize) CommitScanResults();
+
 }
 
 void CollectionWatcher::ScanTransaction::AddToProgress(int n) {
@@ -158,16 +201,14 @@ void CollectionWatcher::ScanTransaction::AddToProgressMax(int n) {
 SongList CollectionWatcher::ScanTransaction::FindSongsInSubdirectory(const QString &path) {
 
   if (cached_songs_dirty_) {
-    cached_songs_ = watcher_->backend_->FindSongsInDirectory(dir_);
+    cached_songs_.clear();
+    for (const Song &song : watcher_->backend_->FindSongsInDirectory(dir_)) {
+      cached_songs_[song.url().toLocalFile().section('/', 0, -2)] << song;
+    }
     cached_songs_dirty_ = false;
   }
 
-  // TODO: Make this faster
-  SongList ret;
-  for (const Song &song : cached_songs_) {
-    if (song.url().toLocalFile().section('/', 0, -2) == path) ret << song;
-  }
-  return ret;
+  return cached_songs_.value(path);
 
 }
 
@@ -176,6 +217,14 @@ void CollectionWatcher::ScanTransaction::SetKnownSubdirs(const SubdirectoryList
   known_subdirs_ = subdirs;
   known_subdirs_dirty_ = false;
 
+  seen_subdirs_.clear();
+  known_subdirs_by_parent_.clear();
+  for (const Subdirectory &subdir : known_subdirs_) {
+    if (subdir.mtime == 0) continue;
+    seen_subdirs_ << subdir.path;
+    known_subdirs_by_parent_[subdir.path.left(subdir.path.lastIndexOf(QDir::separator()))] << subdir;
+  }
+
 }
 
 bool CollectionWatcher::ScanTransaction::HasSeenSubdir(const QString &path) {
@@ -183,10 +232,7 @@ bool CollectionWatcher::ScanTransaction::HasSeenSubdir(const QString &path) {
   if (known_subdirs_dirty_)
     SetKnownSubdirs(watcher_->backend_->SubdirsInDirectory(dir_));
 
-  for (const Subdirectory &subdir : known_subdirs_) {
-    if (subdir.path == path && subdir.mtime != 0) return true;
-  }
-  return false;
+  return seen_subdirs_.contains(path);
 
 }
 
@@ -195,14 +241,7 @@ SubdirectoryList CollectionWatcher::ScanTransaction::GetImmediateSubdirs(const Q
   if (known_subdirs_dirty_)
     SetKnownSubdirs(watcher_->backend_->SubdirsInDirectory(dir_));
 
-  SubdirectoryList ret;
-  for (const Subdirectory &subdir : known_subdirs_) {
-    if (subdir.path.left(subdir.path.lastIndexOf(QDir::separator())) == path && subdir.mtime != 0) {
-      ret << subdir;
-    }
-  }
-
-  return ret;
+  return known_subdirs_by_parent_.value(path);
 
 }
 
@@ -217,6 +256,9 @@ void CollectionWatcher::AddDirectory(const Directory &dir, const SubdirectoryLis
 
   watched_dirs_[dir.id] = dir;
 
+  const bool skip_scan = skip_initial_scan_;
+  skip_initial_scan_ = false;
+
   if (subdirs.isEmpty()) {
     // This is a new directory that we've never seen before. Scan it fully.
     ScanTransaction transaction(this, dir.id, false);
@@ -225,10 +267,35 @@ void CollectionWatcher::AddDirectory(const Directory &dir, const SubdirectoryLis
     ScanSubdirectory(dir.path, Subdirectory(), &transaction);
   }
   else {
+    // The directory itself is missing if the first scan was interrupted, continue it from there.
+    bool has_root = false;
+    for (const Subdirectory &subdir : subdirs) {
+      if (subdir.path == dir.path) {
+        has_root = true;
+        break;
+      }
+    }
+
+    if (skip_scan && has_root) {
+      // Nothing was added, removed or resized since the last scan, so the collection can be used as it is.
+      // Files can still have been renamed or moved, which only changes the mtime of their directories, look for those once the device has settled.
+      qLog(Debug) << "Deferring scan of" << dir.path;
+      deferred_subdirs_[dir.id] = subdirs;
+      deferred_scan_timer_->start();
+      return;
+    }
+
     // We can do an incremental scan - looking at the mtimes of each subdirectory and only rescan if the directory has changed.
     ScanTransaction transaction(this, dir.id, true);
     transaction.SetKnownSubdirs(subdirs);
     transaction.AddToProgressMax(subdirs.count());
+
+    if (!has_root && !stop_requested_) {
+      transaction.AddToProgressMax(1);
+      ScanSubdirectory(dir.path, Subdirectory(), &transaction);
+      if (monitor_) AddWatch(dir, dir.path);
+    }
+
     for (const Subdirectory &subdir : subdirs) {
       if (stop_requested_) return;
 
@@ -245,6 +312,14 @@ void CollectionWatcher::AddDirectory(const Directory &dir, const SubdirectoryLis
 void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory &subdir, ScanTransaction *t, bool force_noincremental) {
 
   QFileInfo path_info(path);
+
+  // Check the mtime first, unchanged directories are the common case and this needs no other file system access.
+  if (!t->ignores_mtime() && !force_noincremental && t->is_incremental() && subdir.mtime == path_info.lastModified().toTime_t()) {
+    // The directory hasn't changed since last time
+    t->AddToProgress(1);
+    return;
+  }
+
   QDir path_dir(path);
 
   // Do not scan symlinked dirs that are already in collection
@@ -264,14 +339,9 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
     return;
   }
 
-  if (!t->ignores_mtime() && !force_noincremental && t->is_incremental() && subdir.mtime == path_info.lastModified().toTime_t()) {
-    // The directory hasn't changed since last time
-    t->AddToProgress(1);
-    return;
-  }
-
   QMap<QString, QStringList> album_art;
   QStringList files_on_disk;
+  QSet<QString> files_on_disk_set;
   SubdirectoryList my_new_subdirs;
 
   // If a directory is moved then only its parent gets a changed notification, so we need to look and see if any of our children don't exist any more.
@@ -308,8 +378,10 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
 
       if (sValidImages.contains(ext_part))
         album_art[dir_part] << child;
-      else if (!child_info.isHidden())
+      else if (!child_info.isHidden()) {
         files_on_disk << child;
+        files_on_disk_set << child;
+      }
     }
   }
 
@@ -318,6 +390,17 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
   // Ask the database for a list of files in this directory
   SongList songs_in_db = t->FindSongsInSubdirectory(path);
 
+  // Index the songs on their path once, so both lists can be compared in linear time.
+  // Songs from a cue sheet share the path of the media file, the first one is used for the comparison.
+  QHash<QString, Song> songs_in_db_by_path;
+  QList<QPair<QString, Song>> songs_in_db_paths;
+  songs_in_db_paths.reserve(songs_in_db.count());
+  for (const Song &song : songs_in_db) {
+    const QString song_path = song.url().toLocalFile();
+    songs_in_db_paths << qMakePair(song_path, song);
+    if (!songs_in_db_by_path.contains(song_path)) songs_in_db_by_path.insert(song_path, song);
+  }
+
   QSet<QString> cues_processed;
 
   // Now compare the list from the database with the list of files on disk
@@ -327,53 +410,12 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
     // associated cue
     QString matching_cue = NoExtensionPart(file) + ".cue";
 
-    Song matching_song;
-    if (FindSongByPath(songs_in_db, file, &matching_song)) {
-      uint matching_cue_mtime = GetMtimeForCue(matching_cue);
-
-      // The song is in the database and still on disk.
-      // Check the mtime to see if it's been changed since it was added.
-      QFileInfo file_info(file);
-
-      if (!file_info.exists()) {
+    QHash<QString, Song>::const_iterator matching_song_it = songs_in_db_by_path.constFind(file);
+    if (matching_song_it != songs_in_db_by_path.constEnd()) {
+      if (!UpdateSong(file, path, matching_song_it.value(), album_art, t)) {
         // Partially fixes race condition - if file was removed between being added to the list and now.
-        files_on_disk.removeAll(file);
-        continue;
+        files_on_disk_set.remove(file);
       }
-
-      // cue sheet's path from collection (if any)
-      QString song_cue = matching_song.cue_path();
-      uint song_cue_mtime = GetMtimeForCue(song_cue);
-
-      bool cue_deleted = song_cue_mtime == 0 && matching_song.has_cue();
-      bool cue_added = matching_cue_mtime != 0 && !matching_song.has_cue();
-
-      // watch out for cue songs which have their mtime equal to qMax(media_file_mtime, cue_sheet_mtime)
-      bool changed = (matching_song.mtime() != qMax(file_info.lastModified().toTime_t(), song_cue_mtime)) || cue_deleted || cue_added;
-
-      // Also want to look to see whether the album art has changed
-      QString image = ImageForSong(file, album_art);
-      if ((matching_song.art_automatic().isEmpty() && !image.isEmpty()) || (!matching_song.art_automatic().isEmpty() && !matching_song.has_embedded_cover() && !QFile::exists(matching_song.art_automatic()))) {
-        changed = true;
-      }
-
-      // the song's changed - reread the metadata from file
-      if (t->ignores_mtime() || changed) {
-        qLog(Debug) << file << "changed";
-
-        // if cue associated...
-        if (!cue_deleted && (matching_song.has_cue() || cue_added)) {
-          UpdateCueAssociatedSongs(file, path, matching_cue, image, t);
-          // if no cue or it's about to lose it...
-        }
-        else {
-          UpdateNonCueAssociatedSong(file, matching_song, image, cue_deleted, t);
-        }
-      }
-
-      // nothing has changed - mark the song available without re-scanning
-      if (matching_song.is_unavailable()) t->readded_songs << matching_song;
-
     }
     else {
       // The song is on disk but not in the DB
@@ -397,14 +439,24 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
   }
 
   // Look for deleted songs
-  for (const Song &song : songs_in_db) {
-    if (!song.is_unavailable() && !files_on_disk.contains(song.url().toLocalFile())) {
-      qLog(Debug) << "Song deleted from disk:" << song.url().toLocalFile();
-      t->deleted_songs << song;
+  for (const QPair<QString, Song> &song_path : songs_in_db_paths) {
+    if (!song_path.second.is_unavailable() && !files_on_disk_set.contains(song_path.first)) {
+      qLog(Debug) << "Song deleted from disk:" << song_path.first;
+      t->deleted_songs << song_path.second;
     }
   }
 
-  // Add this subdir to the new or touched list
+  t->AddToProgress(1);
+
+  // Recurse into the new subdirs that we found
+  t->AddToProgressMax(my_new_subdirs.count());
+  for (const Subdirectory &my_new_subdir : my_new_subdirs) {
+    if (stop_requested_) return;
+    ScanSubdirectory(my_new_subdir.path, my_new_subdir, t, true);
+  }
+
+  // Add this subdir to the new or touched list.
+  // This is done after the new subdirs have been scanned, the mtime marks the whole tree below it as done.
   Subdirectory updated_subdir;
   updated_subdir.directory_id = t->dir();
   updated_subdir.mtime = path_info.exists() ? path_info.lastModified().toTime_t() : 0;
@@ -415,13 +467,102 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
   else
     t->touched_subdirs << updated_subdir;
 
-  t->AddToProgress(1);
+  t->CommitScanResultsIfNeeded();
 
-  // Recurse into the new subdirs that we found
-  t->AddToProgressMax(my_new_subdirs.count());
-  for (const Subdirectory &my_new_subdir : my_new_subdirs) {
-    if (stop_requested_) return;
-    ScanSubdirectory(my_new_subdir.path, my_new_subdir, t, true);
+}
+
+bool CollectionWatcher::UpdateSong(const QString &file, const QString &path, const Song &matching_song, QMap<QString, QStringList> &album_art, ScanTransaction *t) {
+
+  // associated cue
+  QString matching_cue = NoExtensionPart(file) + ".cue";
+  uint matching_cue_mtime = GetMtimeForCue(matching_cue);
+
+  // The song is in the database and still on disk.
+  // Check the mtime to see if it's been changed since it was added.
+  QFileInfo file_info(file);
+
+  if (!file_info.exists()) return false;
+
+  // cue sheet's path from collection (if any)
+  QString song_cue = matching_song.cue_path();
+  uint song_cue_mtime = GetMtimeForCue(song_cue);
+
+  bool cue_deleted = song_cue_mtime == 0 && matching_song.has_cue();
+  bool cue_added = matching_cue_mtime != 0 && !matching_song.has_cue();
+
+  // watch out for cue songs which have their mtime equal to qMax(media_file_mtime, cue_sheet_mtime)
+  bool changed = (matching_song.mtime() != qMax(file_info.lastModified().toTime_t(), song_cue_mtime)) || cue_deleted || cue_added;
+
+  // Also want to look to see whether the album art has changed
+  QString image = ImageForSong(file, album_art);
+  if ((matching_song.art_automatic().isEmpty() && !image.isEmpty()) || (!matching_song.art_automatic().isEmpty() && !matching_song.has_embedded_cover() && !QFile::exists(matching_song.art_automatic()))) {
+    changed = true;
+  }
+
+  // the song's changed - reread the metadata from file
+  if (t->ignores_mtime() || changed) {
+    qLog(Debug) << file << "changed";
+
+    // if cue associated...
+    if (!cue_deleted && (matching_song.has_cue() || cue_added)) {
+      UpdateCueAssociatedSongs(file, path, matching_cue, image, t);
+      // if no cue or it's about to lose it...
+    }
+    else {
+      UpdateNonCueAssociatedSong(file, matching_song, image, cue_deleted, t);
+    }
+  }
+
+  // nothing has changed - mark the song available without re-scanning
+  if (matching_song.is_unavailable()) t->readded_songs << matching_song;
+
+  return true;
+
+}
+
+void CollectionWatcher::ScanFile(const QString &file, ScanTransaction *t) {
+
+  const QString path = DirectoryPart(file);
+
+  // Only the images are listed, they are needed to pick the album art for the song.
+  QStringList image_filters;
+  for (const QString &ext : sValidImages) {
+    image_filters << "*." + ext;
+  }
+  QMap<QString, QStringList> album_art;
+  QDirIterator it(path, image_filters, QDir::Files | QDir::NoDotAndDotDot);
+  while (it.hasNext()) {
+    album_art[path] << it.next();
+  }
+
+  SongList matching_songs;
+  for (const Song &song : t->FindSongsInSubdirectory(path)) {
+    if (song.url().toLocalFile() == file) matching_songs << song;
+  }
+
+  if (!matching_songs.isEmpty()) {
+    if (!UpdateSong(file, path, matching_songs.first(), album_art, t)) {
+      for (const Song &song : matching_songs) {
+        if (song.is_unavailable()) continue;
+        qLog(Debug) << "Song deleted from disk:" << file;
+        t->deleted_songs << song;
+      }
+    }
+  }
+  else if (QFile::exists(file)) {
+    QSet<QString> cues_processed;
+    SongList song_list = ScanNewFile(file, path, NoExtensionPart(file) + ".cue", &cues_processed);
+    if (song_list.isEmpty()) return;
+
+    qLog(Debug) << file << "created";
+    QString image = ImageForSong(file, album_art);
+
+    for (Song song : song_list) {
+      song.set_source(source_);
+      song.set_directory_id(t->dir());
+      if (song.art_automatic().isEmpty()) song.set_art_automatic(image);
+      t->new_songs << song;
+    }
   }
 
 }
@@ -582,7 +723,6 @@ void CollectionWatcher::AddWatch(const Directory &dir, const QString &path) {
 
   if (!QFile::exists(path)) return;
 
-  connect(fs_watcher_, SIGNAL(PathChanged(const QString&)), this, SLOT(DirectoryChanged(const QString&)), Qt::UniqueConnection);
   fs_watcher_->AddPath(path);
   subdir_mapping_[path] = dir;
 
@@ -591,6 +731,8 @@ void CollectionWatcher::AddWatch(const Directory &dir, const QString &path) {
 void CollectionWatcher::RemoveDirectory(const Directory &dir) {
 
   rescan_queue_.remove(dir.id);
+  rescan_files_queue_.remove(dir.id);
+  deferred_subdirs_.remove(dir.id);
   watched_dirs_.remove(dir.id);
 
   // Stop watching the directory's subdirectories
@@ -601,19 +743,6 @@ void CollectionWatcher::RemoveDirectory(const Directory &dir) {
 
 }
 
-bool CollectionWatcher::FindSongByPath(const SongList &list, const QString &path, Song *out) {
-
-  // TODO: Make this faster
-  for (const Song &song : list) {
-    if (song.url().toLocalFile() == path) {
-      *out = song;
-      return true;
-    }
-  }
-  return false;
-
-}
-
 void CollectionWatcher::DirectoryChanged(const QString &subdir) {
 
   // Find what dir it was in
@@ -632,14 +761,70 @@ void CollectionWatcher::DirectoryChanged(const QString &subdir) {
 
 }
 
+void CollectionWatcher::FileChanged(const QString &path) {
+
+  const QString subdir = DirectoryPart(path);
+  QHash<QString, Directory>::const_iterator it = subdir_mapping_.constFind(subdir);
+  if (it == subdir_mapping_.constEnd()) {
+    return;
+  }
+  Directory dir = *it;
+
+  // Images and cue sheets can change any of the songs in the directory, so it's scanned as a whole.
+  const QString ext_part(ExtensionPart(path));
+  if (sValidImages.contains(ext_part) || ext_part == "cue") {
+    DirectoryChanged(subdir);
+    return;
+  }
+
+  // Hidden files are skipped when scanning.
+  if (path.section('/', -1).startsWith('.')) return;
+
+  qLog(Debug) << "File" << path << "changed under directory" << dir.path << "id" << dir.id;
+
+  // Queue the file for rescanning
+  rescan_files_queue_[dir.id] << path;
+
+  if (!rescan_paused_) rescan_timer_->start();
+
+}
+
+void CollectionWatcher::WatchLimitReached() {
+
+  if (periodic_scan_timer_->isActive()) return;
+
+  // Changes in directories that aren't watched are only found by scanning.
+  qLog(Warning) << "Not all collection directories can be monitored, scanning them every" << kPeriodicScanInterval / 60000 << "minutes instead";
+  periodic_scan_timer_->start();
+
+}
+
+void CollectionWatcher::QueueIncrementalScan() {
+
+  rescan_all_queued_ = true;
+  if (!rescan_paused_) rescan_timer_->start();
+
+}
+
 void CollectionWatcher::RescanPathsNow() {
 
-  for (int dir : rescan_queue_.keys()) {
+  if (rescan_all_queued_) {
+    rescan_all_queued_ = false;
+    PerformScan(true, false);
+  }
+
+  QList<int> dirs = rescan_queue_.keys();
+  for (int dir : rescan_files_queue_.keys()) {
+    if (!rescan_queue_.contains(dir)) dirs << dir;
+  }
+
+  for (int dir : dirs) {
     if (stop_requested_) return;
+    const QStringList paths = rescan_queue_.value(dir);
     ScanTransaction transaction(this, dir, false);
-    transaction.AddToProgressMax(rescan_queue_[dir].count());
+    transaction.AddToProgressMax(paths.count());
 
-    for (const QString &path : rescan_queue_[dir]) {
+    for (const QString &path : paths) {
       if (stop_requested_) return;
       Subdirectory subdir;
       subdir.directory_id = dir;
@@ -647,14 +832,56 @@ void CollectionWatcher::RescanPathsNow() {
       subdir.path = path;
       ScanSubdirectory(path, subdir, &transaction);
     }
+
+    // Files in a directory that was scanned above are already up to date.
+    for (const QString &file : rescan_files_queue_.value(dir)) {
+      if (stop_requested_) return;
+      if (!paths.contains(DirectoryPart(file))) ScanFile(file, &transaction);
+    }
   }
 
   rescan_queue_.clear();
+  rescan_files_queue_.clear();
 
   emit CompilationsNeedUpdating();
 
 }
 
+void CollectionWatcher::ScanDeferredSubdirs() {
+
+  bool scanned = false;
+  for (QMap<int, SubdirectoryList>::const_iterator it = deferred_subdirs_.constBegin() ; it != deferred_subdirs_.constEnd() ; ++it) {
+    if (!watched_dirs_.contains(it.key())) continue;
+    const Directory dir = watched_dirs_[it.key()];
+
+    SubdirectoryList changed_subdirs;
+    for (const Subdirectory &subdir : it.value()) {
+      if (stop_requested_) return;
+      if (subdir.mtime != QFileInfo(subdir.path).lastModified().toTime_t()) changed_subdirs << subdir;
+      if (monitor_) AddWatch(dir, subdir.path);
+    }
+
+    if (changed_subdirs.isEmpty()) {
+      qLog(Debug) << "Skipping scan of" << dir.path;
+      continue;
+    }
+
+    ScanTransaction transaction(this, dir.id, true);
+    transaction.SetKnownSubdirs(it.value());
+    transaction.AddToProgressMax(changed_subdirs.count());
+    for (const Subdirectory &subdir : changed_subdirs) {
+      if (stop_requested_) return;
+      ScanSubdirectory(subdir.path, subdir, &transaction);
+    }
+    scanned = true;
+  }
+
+  deferred_subdirs_.clear();
+
+  if (scanned) emit CompilationsNeedUpdating();
+
+}
+
 QString CollectionWatcher::PickBestImage(const QStringList &images) {
 
   // This is used when there is more than one image in a directory.
@@ -742,6 +969,7 @@ void CollectionWatcher::ReloadSettings() {
 
   if (!monitor_ && was_monitoring_before) {
     fs_watcher_->Clear();
+    periodic_scan_timer_->stop();
   }
   else if (monitor_ && !was_monitoring_before) {
     // Add all directories to all QFileSystemWatchers again
@@ -764,7 +992,7 @@ void CollectionWatcher::SetRescanPausedAsync(bool pause) {
 void CollectionWatcher::SetRescanPaused(bool pause) {
 
   rescan_paused_ = pause;
-  if (!rescan_paused_ && !rescan_queue_.isEmpty()) RescanPathsNow();
+  if (!rescan_paused_ && (rescan_all_queued_ || !rescan_queue_.isEmpty() || !rescan_files_queue_.isEmpty())) RescanPathsNow();
 
 }
 
@@ -48,9 +48,19 @@ class CollectionWatcher : public QObject {
  public:
   CollectionWatcher(Song::Source source, QObject *parent = nullptr);
 
+  // Number of songs and subdirectories a scan collects before sending them to the backend.
+  static const int kScanBatchSize;
+  // Time in msec between incremental scans when not every directory can be monitored.
+  static const int kPeriodicScanInterval;
+  // Time in msec before the subdirectories of a directory added with set_skip_initial_scan() are checked.
+  static const int kDeferredScanDelay;
+
   void set_backend(CollectionBackend *backend) { backend_ = backend; }
   void set_task_manager(TaskManager *task_manager) { task_manager_ = task_manager; }
   void set_device_name(const QString& device_name) { device_name_ = device_name; }
+  // Don't touch the file system when the next directory is added, its known subdirectories are checked for changed mtimes and watched after kDeferredScanDelay instead.
+  // Used when the caller knows no files were added, removed or changed since they were last scanned.
+  void set_skip_initial_scan(bool skip) { skip_initial_scan_ = skip; }
 
   void IncrementalScanAsync();
   void FullScanAsync();
@@ -69,6 +79,7 @@ signals:
   void CompilationsNeedUpdating();
 
   void ScanStarted(int task_id);
+  void ScanFinished(int task_id);
 
  public slots:
   void ReloadSettings();
@@ -80,7 +91,8 @@ signals:
   // This class encapsulates a full or partial scan of a directory.
   // Each directory has one or more subdirectories, and any number of subdirectories can be scanned during one transaction.
   // ScanSubdirectory() adds its results to the members of this transaction class,
-  // and they are "committed" through calls to the CollectionBackend in the transaction's dtor.
+  // and they are "committed" through calls to the CollectionBackend in batches while scanning and in the transaction's dtor.
+  // A subdirectory is only committed once everything below it has been scanned, so an interrupted scan continues where it stopped.
   // The transaction also caches the list of songs in this directory according to the collection.
   // Multiple calls to FindSongsInSubdirectory during one transaction will only result in one call to CollectionBackend::FindSongsInDirectory.
   class ScanTransaction {
@@ -97,6 +109,11 @@ signals:
     void AddToProgress(int n = 1);
     void AddToProgressMax(int n);
 
+    // Sends the results collected so far to the backend.
+    void CommitScanResults();
+    // Only commits once at least kScanBatchSize results have been collected.
+    void CommitScanResultsIfNeeded();
+
     int dir() const { return dir_; }
     bool is_incremental() const { return incremental_; }
     bool ignores_mtime() const { return ignores_mtime_; }
@@ -126,22 +143,29 @@ signals:
 
     CollectionWatcher *watcher_;
 
-    SongList cached_songs_;
+    // Keyed on the path of the subdirectory the songs are in.
+    QHash<QString, SongList> cached_songs_;
     bool cached_songs_dirty_;
 
     SubdirectoryList known_subdirs_;
+    // Paths of the known subdirectories that have been scanned, and the same subdirectories keyed on the path of their parent.
+    QSet<QString> seen_subdirs_;
+    QHash<QString, SubdirectoryList> known_subdirs_by_parent_;
     bool known_subdirs_dirty_;
   };
 
  private slots:
   void DirectoryChanged(const QString &path);
+  void FileChanged(const QString &path);
+  void WatchLimitReached();
+  void QueueIncrementalScan();
   void IncrementalScanNow();
   void FullScanNow();
   void RescanPathsNow();
+  void ScanDeferredSubdirs();
   void ScanSubdirectory(const QString &path, const Subdirectory &subdir, ScanTransaction *t, bool force_noincremental = false);
 
  private:
-  static bool FindSongByPath(const SongList &list, const QString &path, Song *out);
   inline static QString NoExtensionPart(const QString &fileName);
   inline static QString ExtensionPart(const QString &fileName);
   inline static QString DirectoryPart(const QString &fileName);
@@ -150,6 +174,12 @@ signals:
   void AddWatch(const Directory &dir, const QString &path);
   uint GetMtimeForCue(const QString &cue_path);
   void PerformScan(bool incremental, bool ignore_mtimes);
+  // Compares a single file with the collection, without listing the rest of its directory.
+  void ScanFile(const QString &file, ScanTransaction *t);
+
+  // Checks whether a file that is already in the collection has changed and reads it again if it has.
+  // Returns false if the file doesn't exist anymore.
+  bool UpdateSong(const QString &file, const QString &path, const Song &matching_song, QMap<QString, QStringList> &album_art, ScanTransaction *t);
 
   // Updates the sections of a cue associated and altered (according to mtime) media file during a scan.
   void UpdateCueAssociatedSongs(const QString &file, const QString &path, const QString &matching_cue, const QString &image, ScanTransaction *t);
@@ -177,11 +207,17 @@ signals:
   bool stop_requested_;
   bool scan_on_startup_;
   bool monitor_;
+  bool skip_initial_scan_;
 
   QMap<int, Directory> watched_dirs_;
   QTimer *rescan_timer_;
   QMap<int, QStringList> rescan_queue_; // dir id -> list of subdirs to be scanned
+  QMap<int, QSet<QString>> rescan_files_queue_; // dir id -> files to be scanned on their own
+  bool rescan_all_queued_;
+  QTimer *periodic_scan_timer_;
   bool rescan_paused_;
+  QTimer *deferred_scan_timer_;
+  QMap<int, SubdirectoryList> deferred_subdirs_; // dir id -> known subdirs that are checked when the timer fires
 
   int total_watches_;
 
@@ -27,11 +27,22 @@
 #include "sqlrow.h"
 
 #include "collectionquery.h"
+#include "core/sqlitequery.h"
 
 SqlRow::SqlRow(const QSqlQuery &query) { Init(query); }
 
 SqlRow::SqlRow(const CollectionQuery &query) { Init(query); }
 
+SqlRow::SqlRow(const SqliteQuery &query) {
+
+  const int count = query.column_count();
+  columns_.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    columns_ << query.Value(i);
+  }
+
+}
+
 void SqlRow::Init(const QSqlQuery &query) {
 
   int rows = query.record().count();
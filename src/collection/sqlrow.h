@@ -28,6 +28,7 @@
 #include <QSqlQuery>
 
 class CollectionQuery;
+class SqliteQuery;
 
 class SqlRow {
 
@@ -35,6 +36,7 @@ class SqlRow {
   // WARNING: Implicit construction from QSqlQuery and CollectionQuery.
   SqlRow(const QSqlQuery &query);
   SqlRow(const CollectionQuery &query);
+  SqlRow(const SqliteQuery &query);
 
   const QVariant &value(int i) const { return columns_[i]; }
 
@@ -34,6 +34,7 @@
 #include "core/closure.h"
 #include "core/lazy.h"
 #include "core/tagreaderclient.h"
+#include "core/tracing.h"
 #include "core/song.h"
 
 #include "database.h"
@@ -76,38 +77,42 @@
 #  include "moodbar/moodbarloader.h"
 #endif
 
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+#  include "musicbrainz/fingerprintstore.h"
+#endif
+
 bool Application::kIsPortable = false;
 
 class ApplicationImpl {
  public:
   explicit ApplicationImpl(Application *app) :
-       tag_reader_client_([=]() {
+       tag_reader_client_("TagReaderClient", [=]() {
           TagReaderClient *client = new TagReaderClient(app);
           app->MoveToNewThread(client);
           client->Start();
           return client;
         }),
-        database_([=]() {
+        database_("Database", [=]() {
           Database *db = new Database(app, app);
           app->MoveToNewThread(db);
           DoInAMinuteOrSo(db, SLOT(DoBackup()));
           return db;
         }),
-        appearance_([=]() { return new Appearance(app); }),
-        task_manager_([=]() { return new TaskManager(app); }),
-        player_([=]() { return new Player(app, app); }),
-        enginedevice_([=]() { return new EngineDevice(app); }),
+        appearance_("Appearance", [=]() { return new Appearance(app); }),
+        task_manager_("TaskManager", [=]() { return new TaskManager(app); }),
+        player_("Player", [=]() { return new Player(app, app); }),
+        enginedevice_("EngineDevice", [=]() { return new EngineDevice(app); }),
 #ifndef Q_OS_WIN
-        device_manager_([=]() { return new DeviceManager(app, app); }),
+        device_manager_("DeviceManager", [=]() { return new DeviceManager(app, app); }),
 #endif
-        collection_([=]() { return new SCollection(app, app); }),
-        playlist_backend_([=]() {
+        collection_("SCollection", [=]() { return new SCollection(app, app); }),
+        playlist_backend_("PlaylistBackend", [=]() {
           PlaylistBackend *backend = new PlaylistBackend(app, app);
           app->MoveToThread(backend, database_->thread());
           return backend;
         }),
-        playlist_manager_([=]() { return new PlaylistManager(app); }),
-        cover_providers_([=]() {
+        playlist_manager_("PlaylistManager", [=]() { return new PlaylistManager(app); }),
+        cover_providers_("CoverProviders", [=]() {
           CoverProviders *cover_providers = new CoverProviders(app);
           // Initialize the repository of cover providers.
           cover_providers->AddProvider(new LastFmCoverProvider(app, app));
@@ -119,19 +124,19 @@ class ApplicationImpl {
 #endif
           return cover_providers;
         }),
-        album_cover_loader_([=]() {
+        album_cover_loader_("AlbumCoverLoader", [=]() {
           AlbumCoverLoader *loader = new AlbumCoverLoader(app);
           app->MoveToNewThread(loader);
           return loader;
         }),
-        current_art_loader_([=]() { return new CurrentArtLoader(app, app); }),
-        lyrics_providers_([=]() {
+        current_art_loader_("CurrentArtLoader", [=]() { return new CurrentArtLoader(app, app); }),
+        lyrics_providers_("LyricsProviders", [=]() {
           LyricsProviders *lyrics_providers = new LyricsProviders(app);
           lyrics_providers->AddProvider(new AuddLyricsProvider(app));
           lyrics_providers->AddProvider(new ChartLyricsProvider(app));
           return lyrics_providers;
         }),
-        internet_services_([=]() {
+        internet_services_("InternetServices", [=]() {
           InternetServices *internet_services = new InternetServices(app);
 #ifdef HAVE_TIDAL
           internet_services->AddService(new TidalService(app, internet_services));
@@ -139,13 +144,16 @@ class ApplicationImpl {
           return internet_services;
         }),
 #ifdef HAVE_TIDAL
-        tidal_search_([=]() { return new InternetSearch(app, Song::Source_Tidal, app); }),
+        tidal_search_("TidalSearch", [=]() { return new InternetSearch(app, Song::Source_Tidal, app); }),
 #endif
-        scrobbler_([=]() { return new AudioScrobbler(app, app); }),
+        scrobbler_("AudioScrobbler", [=]() { return new AudioScrobbler(app, app); }),
 
 #ifdef HAVE_MOODBAR
-        moodbar_loader_([=]() { return new MoodbarLoader(app, app); }),
-        moodbar_controller_([=]() { return new MoodbarController(app, app); }),
+        moodbar_loader_("MoodbarLoader", [=]() { return new MoodbarLoader(app, app); }),
+        moodbar_controller_("MoodbarController", [=]() { return new MoodbarController(app, app); }),
+#endif
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+        fingerprint_store_("FingerprintStore", [=]() { return new FingerprintStore(app, app); }),
 #endif
        dummy_([=]() { return nullptr; })
 
@@ -175,6 +183,9 @@ class ApplicationImpl {
 #ifdef HAVE_MOODBAR
   Lazy<MoodbarLoader> moodbar_loader_;
   Lazy<MoodbarController> moodbar_controller_;
+#endif
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+  Lazy<FingerprintStore> fingerprint_store_;
 #endif
   Lazy<QVariant> dummy_;
 
@@ -183,6 +194,8 @@ class ApplicationImpl {
 Application::Application(QObject *parent)
     : QObject(parent), p_(new ApplicationImpl(this)) {
 
+  tracing::ScopedSpan span("Application::Application");
+
   enginedevice()->Init();
   collection()->Init();
   tag_reader_client();
@@ -252,3 +265,6 @@ AudioScrobbler *Application::scrobbler() const { return p_->scrobbler_.get(); }
 MoodbarController *Application::moodbar_controller() const { return p_->moodbar_controller_.get(); }
 MoodbarLoader *Application::moodbar_loader() const { return p_->moodbar_loader_.get(); }
 #endif
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+FingerprintStore *Application::fingerprint_store() const { return p_->fingerprint_store_.get(); }
+#endif
@@ -63,6 +63,9 @@ class InternetSearch;
 class MoodbarController;
 class MoodbarLoader;
 #endif
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+class FingerprintStore;
+#endif
 
 class Application : public QObject {
   Q_OBJECT
@@ -108,6 +111,10 @@ class Application : public QObject {
   MoodbarLoader *moodbar_loader() const;
 #endif
 
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+  FingerprintStore *fingerprint_store() const;
+#endif
+
   void MoveToNewThread(QObject *object);
   void MoveToThread(QObject *object, QThread *thread);
 
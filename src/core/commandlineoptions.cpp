@@ -72,7 +72,8 @@ const char *CommandlineOptions::kHelpText =
     "      --quiet               %29\n"
     "      --verbose             %30\n"
     "      --log-levels <levels> %31\n"
-    "      --version             %32\n";
+    "      --trace <file>        %32\n"
+    "      --version             %33\n";
 
 const char *CommandlineOptions::kVersionText = "Strawberry %1";
 
@@ -143,6 +144,7 @@ bool CommandlineOptions::Parse() {
       {"quiet", no_argument, 0, Quiet},
       {"verbose", no_argument, 0, Verbose},
       {"log-levels", required_argument, 0, LogLevels},
+      {"trace", required_argument, 0, TraceFile},
       {"version", no_argument, 0, Version},
       {0, 0, 0, 0}};
 
@@ -185,7 +187,8 @@ bool CommandlineOptions::Parse() {
                      tr("Equivalent to --log-levels *:1"),
                      tr("Equivalent to --log-levels *:3"),
                      tr("Comma separated list of class:level, level is 0-3"))
-                .arg(tr("Print out version information"));
+                .arg(tr("Write a startup and playback trace in Chrome trace format to <file>"),
+                     tr("Print out version information"));
 
         std::cout << translated_help_text.toLocal8Bit().constData();
         return false;
@@ -246,6 +249,9 @@ bool CommandlineOptions::Parse() {
       case LogLevels:
         log_levels_ = QString(optarg);
         break;
+      case TraceFile:
+        trace_file_ = QString(optarg);
+        break;
       case Version: {
         QString version_text = QString(kVersionText).arg(STRAWBERRY_VERSION_DISPLAY);
         std::cout << version_text.toLocal8Bit().constData() << std::endl;
@@ -78,6 +78,7 @@ class CommandlineOptions {
   QList<QUrl> urls() const { return urls_; }
   QString language() const { return language_; }
   QString log_levels() const { return log_levels_; }
+  QString trace_file() const { return trace_file_; }
   QString playlist_name() const { return playlist_name_; }
 
   QByteArray Serialize() const;
@@ -94,6 +95,7 @@ class CommandlineOptions {
     Quiet,
     Verbose,
     LogLevels,
+    TraceFile,
     Version,
     VolumeIncreaseBy,
     VolumeDecreaseBy,
@@ -121,6 +123,8 @@ class CommandlineOptions {
   QString language_;
   QString log_levels_;
   QString playlist_name_;
+  // Only used by the instance that is starting up, not serialized.
+  QString trace_file_;
 
   QList<QUrl> urls_;
 };
@@ -36,6 +36,8 @@
 #include <QString>
 #include <QStringBuilder>
 #include <QStringList>
+#include <QVarLengthArray>
+#include <QVector>
 #include <QRegExp>
 #include <QUrl>
 #include <QSqlDriver>
@@ -46,14 +48,21 @@
 #include <QtDebug>
 
 #include "core/logging.h"
+#include "core/tracing.h"
 #include "taskmanager.h"
 #include "database.h"
 #include "application.h"
 #include "scopedtransaction.h"
+#include "sqlitequery.h"
+#include "song.h"
 
 const char *Database::kDatabaseFilename = "strawberry.db";
-const int Database::kSchemaVersion = 5;
+const int Database::kSchemaVersion = 8;
 const char *Database::kMagicAllSongsTables = "%allsongstables";
+const int Database::kProgressHandlerInterval = 1000;
+const int Database::kMaxCachedQueries = 64;
+
+thread_local const QAtomicInt *Database::sCancelFlag = nullptr;
 
 int Database::sNextConnectionId = 1;
 QMutex Database::sNextConnectionIdMutex;
@@ -61,6 +70,62 @@ QMutex Database::sNextConnectionIdMutex;
 Database::Token::Token(const QString &token, int start, int end)
     : token(token), start_offset(start), end_offset(end) {}
 
+namespace {
+
+// The folded form of a single character, most characters fold to one character but ligatures like "ﬁ" fold to more.
+typedef QVarLengthArray<uint, 4> FoldedCharacter;
+
+// Lowercased and decomposed characters for the first few Unicode blocks, which covers most of the accented characters in tags.
+const uint kFoldTableSize = 0x0300;
+// Marks the characters in the table that don't fold to exactly one character.
+const uint kFoldNotSingle = 0xFFFFFFFF;
+
+// Decomposes c with NFKD, so compatibility characters are split up too, and drops the accents.
+void FoldCharacterDecomposed(uint c, FoldedCharacter *folded) {
+
+  folded->clear();
+  const QString decomposed = QString::fromUcs4(&c, 1).normalized(QString::NormalizationForm_KD);
+  for (const uint d : decomposed.toUcs4()) {
+    if (QChar::category(d) != QChar::Mark_NonSpacing) folded->append(QChar::toLower(d));
+  }
+
+}
+
+QVector<uint> BuildFoldTable() {
+
+  QVector<uint> table(kFoldTableSize);
+  FoldedCharacter folded;
+  for (uint i = 0 ; i < kFoldTableSize ; ++i) {
+    FoldCharacterDecomposed(i, &folded);
+    table[i] = folded.count() == 1 ? folded[0] : kFoldNotSingle;
+  }
+  return table;
+
+}
+
+void FoldCharacter(const uint c, FoldedCharacter *folded) {
+
+  static const QVector<uint> fold_table = BuildFoldTable();
+
+  if (c < kFoldTableSize && fold_table[c] != kFoldNotSingle) {
+    folded->clear();
+    folded->append(fold_table[c]);
+    return;
+  }
+
+  // Most characters outside the table don't decompose, so skip the normalization for them.
+  if (c >= kFoldTableSize && QChar::decompositionTag(c) == QChar::NoDecomposition && QChar::category(c) != QChar::Mark_NonSpacing) {
+    folded->clear();
+    folded->append(QChar::toLower(c));
+    return;
+  }
+
+  FoldCharacterDecomposed(c, folded);
+
+}
+
+}  // namespace
+
 struct sqlite3_tokenizer_module {
 
   int iVersion;
@@ -154,11 +219,9 @@ int Database::FTSOpen(sqlite3_tokenizer *pTokenizer, const char *input, int byte
       }
     }
     else {
-      if (data[i].decompositionTag() != QChar::NoDecomposition) {
-        token.push_back(data[i].decomposition()[0]);
-      } else {
-        token.push_back(data[i]);
-      }
+      FoldedCharacter folded;
+      FoldCharacter(data[i].unicode(), &folded);
+      for (const uint f : folded) token.append(QString::fromUcs4(&f, 1));
     }
 
     if (i == str.length() - 1) {
@@ -208,6 +271,137 @@ int Database::FTSNext(sqlite3_tokenizer_cursor *cursor, const char* *token, int
 
 }
 
+namespace {
+
+// Decodes the character at *pos and moves *pos past it.  Invalid sequences are returned as U+FFFD.
+uint DecodeUtf8(const unsigned char *input, const int bytes, int *pos) {
+
+  const unsigned char lead = input[(*pos)++];
+  if (lead < 0x80) return lead;
+
+  int length = 0;
+  uint c = 0;
+  if ((lead & 0xE0) == 0xC0) { length = 1; c = lead & 0x1F; }
+  else if ((lead & 0xF0) == 0xE0) { length = 2; c = lead & 0x0F; }
+  else if ((lead & 0xF8) == 0xF0) { length = 3; c = lead & 0x07; }
+  else return 0xFFFD;
+
+  for (int i = 0 ; i < length ; ++i) {
+    if (*pos >= bytes || (input[*pos] & 0xC0) != 0x80) return 0xFFFD;
+    c = (c << 6) | (input[(*pos)++] & 0x3F);
+  }
+  return c;
+
+}
+
+void AppendUtf8(QVarLengthArray<char, 256> *output, const uint c) {
+
+  if (c < 0x80) {
+    output->append(static_cast<char>(c));
+  }
+  else if (c < 0x800) {
+    output->append(static_cast<char>(0xC0 | (c >> 6)));
+    output->append(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+  else if (c < 0x10000) {
+    output->append(static_cast<char>(0xE0 | (c >> 12)));
+    output->append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+    output->append(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+  else {
+    output->append(static_cast<char>(0xF0 | (c >> 18)));
+    output->append(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+    output->append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+    output->append(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+
+}
+
+}  // namespace
+
+QString Database::FoldString(const QString &str) {
+
+  const QVector<uint> ucs4 = str.toUcs4();
+  QVector<uint> folded;
+  folded.reserve(ucs4.count());
+  FoldedCharacter folded_c;
+  for (const uint c : ucs4) {
+    FoldCharacter(c, &folded_c);
+    for (const uint f : folded_c) folded << f;
+  }
+  return QString::fromUcs4(folded.constData(), folded.count());
+
+}
+
+fts5_tokenizer Database::sFTS5Tokenizer = { &Database::FTS5Create, &Database::FTS5Delete, &Database::FTS5Tokenize };
+
+fts5_api *Database::FTS5Api(sqlite3 *handle) {
+
+  fts5_api *api = nullptr;
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(handle, "SELECT fts5(?1)", -1, &stmt, nullptr) == SQLITE_OK) {
+    sqlite3_bind_pointer(stmt, 1, reinterpret_cast<void*>(&api), "fts5_api_ptr", nullptr);
+    sqlite3_step(stmt);
+  }
+  sqlite3_finalize(stmt);
+
+  return api;
+
+}
+
+int Database::FTS5Create(void*, const char**, int, Fts5Tokenizer **tokenizer) {
+
+  *tokenizer = reinterpret_cast<Fts5Tokenizer*>(new FoldingTokenizer);
+
+  return SQLITE_OK;
+
+}
+
+void Database::FTS5Delete(Fts5Tokenizer *tokenizer) {
+
+  delete reinterpret_cast<FoldingTokenizer*>(tokenizer);
+
+}
+
+int Database::FTS5Tokenize(Fts5Tokenizer*, void *context, int, const char *input, int bytes, int (*token_callback)(void *context, int flags, const char *token, int token_bytes, int start, int end)) {
+
+  const unsigned char *data = reinterpret_cast<const unsigned char*>(input);
+
+  QVarLengthArray<char, 256> token;
+  FoldedCharacter folded;
+  int start_offset = -1;
+  int pos = 0;
+  while (pos < bytes) {
+    const int offset = pos;
+    const uint c = DecodeUtf8(data, bytes, &pos);
+
+    bool letter_or_number = false;
+    if (c < 0x80) letter_or_number = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    else letter_or_number = QChar::isLetterOrNumber(c);
+
+    if (letter_or_number) {
+      // Token continues.
+      if (start_offset == -1) start_offset = offset;
+      FoldCharacter(c, &folded);
+      for (const uint f : folded) AppendUtf8(&token, f);
+    }
+    else if (start_offset != -1) {
+      // Token finished.
+      const int result = token_callback(context, 0, token.constData(), token.size(), start_offset, offset);
+      if (result != SQLITE_OK) return result;
+      token.clear();
+      start_offset = -1;
+    }
+  }
+
+  if (start_offset != -1) {
+    return token_callback(context, 0, token.constData(), token.size(), start_offset, bytes);
+  }
+
+  return SQLITE_OK;
+
+}
+
 void Database::StaticInit() {
 
   sFTSTokenizer = new sqlite3_tokenizer_module;
@@ -241,6 +435,12 @@ Database::Database(Application *app, QObject *parent, const QString &database_na
 
 }
 
+Database::~Database() {
+
+  LogCachedQueryStats();
+
+}
+
 QSqlDatabase Database::Connect() {
 
   QMutexLocker l(&connect_mutex_);
@@ -252,7 +452,7 @@ QSqlDatabase Database::Connect() {
     }
   }
 
-  const QString connection_id = QString("%1_thread_%2").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
+  const QString connection_id = ThreadConnectionName();
 
   // Try to find an existing connection for this thread
   QSqlDatabase db = QSqlDatabase::database(connection_id);
@@ -272,24 +472,40 @@ QSqlDatabase Database::Connect() {
     return db;
   }
 
+  // The connection and its cached statements are only used by this thread, close them when it finishes.
+  connect(QThread::currentThread(), SIGNAL(finished()), SLOT(ThreadFinished()), static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
+
   // Find Sqlite3 functions in the Qt plugin.
   StaticInit();
 
   {
 
+    sqlite3 *handle = nullptr;
+    QVariant v = db.driver()->handle();
+    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+      handle = *static_cast<sqlite3**>(v.data());
+    }
+
 #ifdef SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER
     // In case sqlite>=3.12 is compiled without -DSQLITE_ENABLE_FTS3_TOKENIZER
     // (generally a good idea  due to security reasons) the fts3 support should be enabled explicitly.
-    QVariant v = db.driver()->handle();
-    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
-      sqlite3 *handle = *static_cast<sqlite3**>(v.data());
-      if (handle) {
-        int result = sqlite3_db_config(handle, SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER, 1, NULL);
-        if (result != SQLITE_OK) qLog(Fatal) << "Unable to enable FTS3 tokenizer";
-      }
-      else qLog(Fatal) << "Unable to enable FTS3 tokenizer";
+    if (handle) {
+      int result = sqlite3_db_config(handle, SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER, 1, NULL);
+      if (result != SQLITE_OK) qLog(Fatal) << "Unable to enable FTS3 tokenizer";
     }
+    else qLog(Fatal) << "Unable to enable FTS3 tokenizer";
 #endif
+
+    // Lets long running queries be interrupted, see SetCancelFlag.
+    if (handle) sqlite3_progress_handler(handle, kProgressHandlerInterval, &Database::ProgressHandler, nullptr);
+
+    // The FTS5 tokenizer used by the search tables.
+    fts5_api *api = handle ? FTS5Api(handle) : nullptr;
+    if (!api || api->xCreateTokenizer(api, "unicodefold", nullptr, &sFTS5Tokenizer, nullptr) != SQLITE_OK) {
+      qLog(Error) << "Couldn't register FTS5 tokenizer";
+    }
+
+    // The FTS3 tokenizer is still needed to drop the old FTS3 tables when updating the schema.
     QSqlQuery set_fts_tokenizer(db);
     set_fts_tokenizer.prepare("SELECT fts3_tokenizer(:name, :pointer)");
     set_fts_tokenizer.bindValue(":name", "unicode");
@@ -345,6 +561,8 @@ QSqlDatabase Database::Connect() {
 
 void Database::UpdateMainSchema(QSqlDatabase *db) {
 
+  tracing::ScopedSpan span("Database::UpdateMainSchema");
+
   // Get the database's schema version
   int schema_version = 0;
   {
@@ -380,6 +598,9 @@ void Database::RecreateAttachedDb(const QString &database_name) {
   {
     QSqlDatabase db(Connect());
 
+    // Cached statements might still refer to tables in the attached database.
+    ClearCachedQueries(db.connectionName());
+
     QSqlQuery q(db);
     q.prepare("DETACH DATABASE :alias");
     q.bindValue(":alias", database_name);
@@ -395,6 +616,7 @@ void Database::RecreateAttachedDb(const QString &database_name) {
 
   // We can't just re-attach the database now because it needs to be done for each thread.
   // Close all the database connections, so each thread will re-attach it when they next connect.
+  ClearCachedQueries();
   for (const QString &name : QSqlDatabase::connectionNames()) {
     QSqlDatabase::removeDatabase(name);
   }
@@ -426,6 +648,9 @@ void Database::DetachDatabase(const QString &database_name) {
   {
     QSqlDatabase db(Connect());
 
+    // Cached statements might still refer to tables in the attached database.
+    ClearCachedQueries(db.connectionName());
+
     QSqlQuery q(db);
     q.prepare("DETACH DATABASE :alias");
     q.bindValue(":alias", database_name);
@@ -441,6 +666,8 @@ void Database::DetachDatabase(const QString &database_name) {
 
 void Database::UpdateDatabaseSchema(int version, QSqlDatabase &db) {
 
+  tracing::ScopedSpan span("Database::UpdateDatabaseSchema", QString::number(version));
+
   QString filename;
   if (version == 0) filename = ":/schema/schema.sql";
   else {
@@ -450,6 +677,35 @@ void Database::UpdateDatabaseSchema(int version, QSqlDatabase &db) {
 
   ExecSchemaCommandsFromFile(db, filename, version - 1);
 
+  // Version 6 moves the search tables from FTS3 to FTS5, device tables aren't covered by the schema file.
+  if (version == 6) RecreateDeviceFtsTables(db);
+
+}
+
+void Database::RecreateDeviceFtsTables(QSqlDatabase &db) {
+
+  // Query the tables before beginning the transaction, see ExecSchemaCommands.
+  const QStringList tables = db.tables();
+  const QRegExp device_fts_table("device_(\\d+)_fts");
+
+  ScopedTransaction t(&db);
+  for (const QString &table : tables) {
+    if (!device_fts_table.exactMatch(table)) continue;
+    const QString songs_table = QString("device_%1_songs").arg(device_fts_table.cap(1));
+
+    qLog(Info) << "Recreating" << table << "with FTS5";
+
+    QSqlQuery drop(db.exec(QString("DROP TABLE %1").arg(table)));
+    if (CheckErrors(drop)) qFatal("Unable to update music collection database");
+
+    QSqlQuery create(db.exec(QString("CREATE VIRTUAL TABLE %1 USING fts5(%2, tokenize='unicodefold', prefix='1 2 3')").arg(table, Song::kFtsColumnSpec)));
+    if (CheckErrors(create)) qFatal("Unable to update music collection database");
+
+    QSqlQuery insert(db.exec(QString("INSERT INTO %1 (ROWID, %2) SELECT ROWID, title, album, artist, albumartist, composer, performer, grouping, genre, comment FROM %3").arg(table, Song::kFtsColumnSpec, songs_table)));
+    if (CheckErrors(insert)) qFatal("Unable to update music collection database");
+  }
+  t.Commit();
+
 }
 
 void Database::UrlEncodeFilenameColumn(const QString &table, QSqlDatabase &db) {
@@ -564,10 +820,20 @@ QStringList Database::SongsTables(QSqlDatabase &db, int schema_version) const {
 
 }
 
+int Database::ProgressHandler(void*) {
+
+  // Returning non-zero makes sqlite abort the query with SQLITE_INTERRUPT.
+  return IsCancelled() ? 1 : 0;
+
+}
+
 bool Database::CheckErrors(const QSqlQuery &query) {
 
   QSqlError last_error = query.lastError();
   if (last_error.isValid()) {
+    // The query was cancelled on purpose.
+    if (IsCancelled()) return true;
+
     qLog(Error) << "db error: " << last_error;
     qLog(Error) << "faulty query: " << query.lastQuery();
     qLog(Error) << "bound values: " << query.boundValues();
@@ -579,6 +845,92 @@ bool Database::CheckErrors(const QSqlQuery &query) {
 
 }
 
+bool Database::CheckErrors(const SqliteQuery &query) {
+
+  if (query.has_error()) {
+    if (IsCancelled()) return true;
+
+    qLog(Error) << "db error: " << query.last_error();
+    qLog(Error) << "faulty query: " << query.last_query();
+    qLog(Error) << "bound values: " << query.bound_values();
+
+    return true;
+  }
+
+  return false;
+
+}
+
+QString Database::ThreadConnectionName() const {
+
+  return QString("%1_thread_%2").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
+
+}
+
+void Database::ThreadFinished() {
+
+  // Called from the thread that is finishing.
+  QMutexLocker l(&connect_mutex_);
+
+  const QString connection_name = ThreadConnectionName();
+  ClearCachedQueries(connection_name);
+  QSqlDatabase::removeDatabase(connection_name);
+
+}
+
+QSqlQuery Database::CachedQuery(QSqlDatabase &db, const QString &sql) {
+
+  QMutexLocker l(&cached_queries_mutex_);
+
+  QHash<QString, QSqlQuery> &queries = cached_queries_[db.connectionName()];
+  QHash<QString, QSqlQuery>::iterator it = queries.find(sql);
+  if (it != queries.end()) {
+    ++cached_query_stats_.hits;
+    // Reset the statement in case the last user didn't read all the rows.
+    it->finish();
+    return *it;
+  }
+
+  ++cached_query_stats_.misses;
+
+  QSqlQuery q(db);
+  // Failed statements aren't cached, exec() reports the error to the caller.
+  if (!q.prepare(sql)) return q;
+
+  if (queries.count() >= kMaxCachedQueries) queries.clear();
+  queries.insert(sql, q);
+
+  return q;
+
+}
+
+void Database::ClearCachedQueries(const QString &connection_name) {
+
+  QMutexLocker l(&cached_queries_mutex_);
+
+  if (connection_name.isEmpty()) {
+    cached_queries_.clear();
+  }
+  else {
+    cached_queries_.remove(connection_name);
+  }
+
+}
+
+Database::CachedQueryStats Database::cached_query_stats() {
+
+  QMutexLocker l(&cached_queries_mutex_);
+  return cached_query_stats_;
+
+}
+
+void Database::LogCachedQueryStats() {
+
+  const CachedQueryStats stats = cached_query_stats();
+  qLog(Debug) << "Cached queries:" << stats.hits << "hits," << stats.misses << "misses";
+
+}
+
 bool Database::IntegrityCheck(QSqlDatabase db) {
 
   qLog(Debug) << "Starting database integrity check";
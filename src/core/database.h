@@ -29,9 +29,11 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QByteArray>
 #include <QList>
 #include <QMap>
+#include <QHash>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QString>
@@ -45,12 +47,14 @@ struct sqlite3_tokenizer_module;
 }
 
 class Application;
+class SqliteQuery;
 
 class Database : public QObject {
   Q_OBJECT
 
  public:
   Database(Application *app, QObject *parent = nullptr, const QString &database_name = QString());
+  ~Database();
 
   struct AttachedDatabase {
     AttachedDatabase() {}
@@ -65,11 +69,34 @@ class Database : public QObject {
   static const int kSchemaVersion;
   static const char *kDatabaseFilename;
   static const char *kMagicAllSongsTables;
+  static const int kMaxCachedQueries;
+
+  struct CachedQueryStats {
+    CachedQueryStats() : hits(0), misses(0) {}
+    quint64 hits;
+    quint64 misses;
+  };
 
   QSqlDatabase Connect();
   bool CheckErrors(const QSqlQuery &query);
+  bool CheckErrors(const SqliteQuery &query);
   QMutex *Mutex() { return &mutex_; }
 
+  // Returns a query prepared with sql on the connection db, the statement is kept and reused the next time the same sql is asked for on that connection.
+  // Only use this for sql text that doesn't change between calls, and don't nest two uses of the same sql, the returned queries share the statement.
+  // Call finish() on the query if not all rows are read, otherwise the statement keeps holding a read lock.
+  QSqlQuery CachedQuery(QSqlDatabase &db, const QString &sql);
+  void ClearCachedQueries(const QString &connection_name = QString());
+  CachedQueryStats cached_query_stats();
+  void LogCachedQueryStats();
+
+  // Queries run by the calling thread are interrupted as soon as *cancel is set, until this is called again with nullptr.
+  static void SetCancelFlag(const QAtomicInt *cancel) { sCancelFlag = cancel; }
+  static bool IsCancelled() { return sCancelFlag && sCancelFlag->load(); }
+
+  // Lowercases and strips accents the same way the unicodefold tokenizer does, so text can be matched like full text search matches it.
+  static QString FoldString(const QString &str);
+
   void RecreateAttachedDb(const QString &database_name);
   void ExecSchemaCommands(QSqlDatabase &db, const QString &schema, int schema_version, bool in_transaction = false);
 
@@ -86,7 +113,11 @@ signals:
  public slots:
   void DoBackup();
 
+ private slots:
+  void ThreadFinished();
+
  private:
+  QString ThreadConnectionName() const;
   void UpdateMainSchema(QSqlDatabase *db);
 
   void ExecSchemaCommandsFromFile(QSqlDatabase &db, const QString &filename, int schema_version, bool in_transaction = false);
@@ -94,6 +125,7 @@ signals:
 
   void UpdateDatabaseSchema(int version, QSqlDatabase &db);
   void UrlEncodeFilenameColumn(const QString &table, QSqlDatabase &db);
+  void RecreateDeviceFtsTables(QSqlDatabase &db);
   QStringList SongsTables(QSqlDatabase &db, int schema_version) const;
   bool IntegrityCheck(QSqlDatabase db);
   void BackupFile(const QString &filename);
@@ -120,12 +152,22 @@ signals:
   uint query_hash_;
   QStringList query_cache_;
 
+  // Connection name -> sql -> prepared query
+  QMutex cached_queries_mutex_;
+  QHash<QString, QHash<QString, QSqlQuery>> cached_queries_;
+  CachedQueryStats cached_query_stats_;
+
   // This is the schema version of Strawberry's DB from the app's last run.
   int startup_schema_version_;
 
   // Do static initialisation like loading sqlite functions.
   static void StaticInit();
 
+  // Number of virtual machine instructions between checks of the cancel flag.
+  static const int kProgressHandlerInterval;
+  static thread_local const QAtomicInt *sCancelFlag;
+  static int ProgressHandler(void *context);
+
   typedef int (*Sqlite3CreateFunc)(sqlite3*, const char*, int, int, void*, void (*)(sqlite3_context*, int, sqlite3_value**), void (*)(sqlite3_context*, int, sqlite3_value**), void (*)(sqlite3_context*));
 
   static sqlite3_tokenizer_module *sFTSTokenizer;
@@ -136,6 +178,15 @@ signals:
   static int FTSClose(sqlite3_tokenizer_cursor *cursor);
   static int FTSNext(sqlite3_tokenizer_cursor *cursor, const char **token, int *bytes, int *start_offset, int *end_offset, int *position);
 
+  // Tokenizer for the FTS5 tables, works on the UTF-8 input directly.
+  // Tokens are lowercased and diacritics are removed, the same as the FTS3 tokenizer above.
+  static fts5_tokenizer sFTS5Tokenizer;
+
+  static fts5_api *FTS5Api(sqlite3 *handle);
+  static int FTS5Create(void *context, const char **argv, int argc, Fts5Tokenizer **tokenizer);
+  static void FTS5Delete(Fts5Tokenizer *tokenizer);
+  static int FTS5Tokenize(Fts5Tokenizer *tokenizer, void *context, int flags, const char *input, int bytes, int (*token_callback)(void *context, int flags, const char *token, int token_bytes, int start, int end));
+
   struct Token {
     Token(const QString &token, int start, int end);
     QString token;
@@ -148,6 +199,8 @@ signals:
     const sqlite3_tokenizer_module *pModule;
   };
 
+  struct FoldingTokenizer {};
+
   struct UnicodeTokenizerCursor {
     const sqlite3_tokenizer *pTokenizer;
 
@@ -163,7 +216,9 @@ class MemoryDatabase : public Database {
       : Database(app, parent, ":memory:") {}
   ~MemoryDatabase() {
     // Make sure Qt doesn't reuse the same database
-    QSqlDatabase::removeDatabase(Connect().connectionName());
+    const QString connection_name = Connect().connectionName();
+    ClearCachedQueries(connection_name);
+    QSqlDatabase::removeDatabase(connection_name);
   }
 };
 
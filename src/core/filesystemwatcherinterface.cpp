@@ -28,6 +28,9 @@
 #ifdef Q_OS_MACOS
 #include "macfslistener.h"
 #endif
+#ifdef Q_OS_LINUX
+#include "inotifyfslistener.h"
+#endif
 
 FileSystemWatcherInterface::FileSystemWatcherInterface(QObject *parent)
     : QObject(parent) {}
@@ -36,6 +39,8 @@ FileSystemWatcherInterface *FileSystemWatcherInterface::Create(QObject *parent)
   FileSystemWatcherInterface *ret;
 #ifdef Q_OS_MACOS
   ret = new MacFSListener(parent);
+#elif defined(Q_OS_LINUX)
+  ret = new InotifyFSListener(parent);
 #else
   ret = new QtFSListener(parent);
 #endif
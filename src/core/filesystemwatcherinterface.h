@@ -38,7 +38,15 @@ class FileSystemWatcherInterface : public QObject {
   static FileSystemWatcherInterface *Create(QObject *parent = nullptr);
 
 signals:
+  // A directory changed, it needs to be listed again.
   void PathChanged(const QString &path);
+  // A single file in a watched directory was created, modified, moved or deleted.
+  // Only emitted by listeners that can report changes to files.
+  void FileChanged(const QString &path);
+  // Changes were dropped by the system, the watched directories need to be scanned again.
+  void EventsLost();
+  // A path couldn't be watched, usually because the system limit on watches was reached.
+  void WatchLimitReached();
 };
 
 #endif
@@ -0,0 +1,218 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <QObject>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QString>
+
+#include "core/logging.h"
+#include "filesystemwatcherinterface.h"
+#include "inotifyfslistener.h"
+
+namespace {
+// Directories are watched for files being written, created, deleted and moved in or out, and for being deleted or moved themselves.
+// New files are reported once they are closed after writing, not when they're created.
+const uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+const int InotifyFSListener::kCoalesceDelay = 500;
+
+InotifyFSListener::InotifyFSListener(QObject *parent)
+    : FileSystemWatcherInterface(parent),
+      fd_(-1),
+      notifier_(nullptr),
+      coalesce_timer_(this),
+      events_lost_(false),
+      limit_reached_(false) {
+
+  coalesce_timer_.setSingleShot(true);
+  coalesce_timer_.setInterval(kCoalesceDelay);
+  connect(&coalesce_timer_, SIGNAL(timeout()), SLOT(EmitChanges()));
+
+}
+
+InotifyFSListener::~InotifyFSListener() {
+
+  if (fd_ != -1) close(fd_);
+
+}
+
+void InotifyFSListener::Init() {
+
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ == -1) {
+    qLog(Error) << "Failed to initialize inotify:" << strerror(errno);
+    return;
+  }
+
+  notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+  connect(notifier_, SIGNAL(activated(int)), SLOT(ReadEvents()));
+
+}
+
+void InotifyFSListener::AddPath(const QString &path) {
+
+  if (wds_by_path_.contains(path)) return;
+
+  const int wd = fd_ == -1 ? -1 : inotify_add_watch(fd_, QFile::encodeName(path).constData(), kWatchMask);
+  if (wd == -1) {
+    if (fd_ == -1 || errno == ENOSPC || errno == ENOMEM) {
+      // The directories that can't be watched are picked up by scanning instead, which only needs to be set up once.
+      if (!limit_reached_) {
+        qLog(Warning) << "Can't watch" << path << "- the inotify watch limit has been reached.";
+        limit_reached_ = true;
+        emit WatchLimitReached();
+      }
+    }
+    else {
+      qLog(Debug) << "Can't watch" << path << strerror(errno);
+    }
+    return;
+  }
+
+  // The same directory can be reached through more than one path, the watch descriptor is reused then.
+  if (paths_by_wd_.contains(wd)) wds_by_path_.remove(paths_by_wd_[wd]);
+
+  paths_by_wd_[wd] = path;
+  wds_by_path_[path] = wd;
+
+}
+
+void InotifyFSListener::RemovePath(const QString &path) {
+
+  QHash<QString, int>::const_iterator it = wds_by_path_.constFind(path);
+  if (it == wds_by_path_.constEnd()) return;
+
+  const int wd = it.value();
+  inotify_rm_watch(fd_, wd);
+  RemoveWatch(wd);
+
+}
+
+void InotifyFSListener::Clear() {
+
+  for (const int wd : paths_by_wd_.keys()) {
+    inotify_rm_watch(fd_, wd);
+  }
+  paths_by_wd_.clear();
+  wds_by_path_.clear();
+
+  changed_dirs_.clear();
+  changed_files_.clear();
+  events_lost_ = false;
+  limit_reached_ = false;
+  coalesce_timer_.stop();
+
+}
+
+void InotifyFSListener::RemoveWatch(const int wd) {
+
+  wds_by_path_.remove(paths_by_wd_.take(wd));
+
+}
+
+void InotifyFSListener::ReadEvents() {
+
+  char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  forever {
+    const ssize_t len = read(fd_, buffer, sizeof(buffer));
+    if (len <= 0) break;
+
+    const struct inotify_event *event = nullptr;
+    for (const char *ptr = buffer ; ptr < buffer + len ; ptr += sizeof(struct inotify_event) + event->len) {
+      event = reinterpret_cast<const struct inotify_event*>(ptr);
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        events_lost_ = true;
+        continue;
+      }
+
+      QHash<int, QString>::const_iterator it = paths_by_wd_.constFind(event->wd);
+      if (it == paths_by_wd_.constEnd()) continue;
+      const QString path = it.value();
+
+      if (event->mask & IN_IGNORED) {
+        // The watch was removed by the kernel, the directory is gone or was unmounted.
+        RemoveWatch(event->wd);
+        continue;
+      }
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // Scanning the directory again removes its songs. A moved directory keeps its watch, so it's removed to not report changes under the old path.
+        changed_dirs_ << path;
+        if (event->mask & IN_MOVE_SELF) {
+          inotify_rm_watch(fd_, event->wd);
+          RemoveWatch(event->wd);
+        }
+        continue;
+      }
+
+      if (event->len == 0) continue;
+
+      if (event->mask & IN_ISDIR) {
+        // A subdirectory was added or removed, the parent is scanned to find it.
+        changed_dirs_ << path;
+      }
+      else if (!(event->mask & IN_CREATE)) {
+        changed_files_ << path + "/" + QFile::decodeName(event->name);
+      }
+    }
+  }
+
+  if (events_lost_ || !changed_dirs_.isEmpty() || !changed_files_.isEmpty()) {
+    coalesce_timer_.start();
+  }
+
+}
+
+void InotifyFSListener::EmitChanges() {
+
+  if (events_lost_) {
+    qLog(Warning) << "The inotify event queue overflowed, changes were lost.";
+    events_lost_ = false;
+    changed_dirs_.clear();
+    changed_files_.clear();
+    emit EventsLost();
+    return;
+  }
+
+  const QSet<QString> changed_dirs = changed_dirs_;
+  const QSet<QString> changed_files = changed_files_;
+  changed_dirs_.clear();
+  changed_files_.clear();
+
+  for (const QString &path : changed_dirs) {
+    emit PathChanged(path);
+  }
+
+  // Files in a directory that is scanned anyway don't need to be reported.
+  for (const QString &file : changed_files) {
+    if (!changed_dirs.contains(file.section('/', 0, -2))) emit FileChanged(file);
+  }
+
+}
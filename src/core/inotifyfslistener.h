@@ -0,0 +1,77 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INOTIFYFSLISTENER_H
+#define INOTIFYFSLISTENER_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include "filesystemwatcherinterface.h"
+
+class QSocketNotifier;
+
+// Watches directories with inotify directly instead of through QFileSystemWatcher.
+// Changes to files are reported as file changes, so only the file has to be read again, changes to subdirectories are reported for the parent directory.
+// Events are collected for a short while, so a file that is written in several steps is only reported once.
+class InotifyFSListener : public FileSystemWatcherInterface {
+  Q_OBJECT
+
+ public:
+  explicit InotifyFSListener(QObject *parent = nullptr);
+  ~InotifyFSListener();
+
+  // Time in msec to wait for more events before reporting the changes.
+  static const int kCoalesceDelay;
+
+  void Init();
+  void AddPath(const QString &path);
+  void RemovePath(const QString &path);
+  void Clear();
+
+ private slots:
+  void ReadEvents();
+  void EmitChanges();
+
+ private:
+  void RemoveWatch(const int wd);
+
+  int fd_;
+  QSocketNotifier *notifier_;
+  QTimer coalesce_timer_;
+
+  QHash<int, QString> paths_by_wd_;
+  QHash<QString, int> wds_by_path_;
+
+  // Changes since they were last reported.
+  QSet<QString> changed_dirs_;
+  QSet<QString> changed_files_;
+  bool events_lost_;
+
+  bool limit_reached_;
+
+};
+
+#endif  // INOTIFYFSLISTENER_H
@@ -60,6 +60,8 @@
 
 #include "core/logging.h"
 #include "core/closure.h"
+#include "core/tracing.h"
+#include "core/tagwriter.h"
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
@@ -146,6 +148,7 @@
 #include "scrobbler/audioscrobbler.h"
 
 #if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+#  include "musicbrainz/fingerprintstore.h"
 #  include "musicbrainz/tagfetcher.h"
 #endif
 
@@ -220,6 +223,7 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
       initialised_(false),
       was_maximized_(true),
       playing_widget_(true),
+      first_paint_(true),
       doubleclick_addmode_(BehaviourSettingsPage::AddBehaviour_Append),
       doubleclick_playmode_(BehaviourSettingsPage::PlayBehaviour_Never),
       menu_playmode_(BehaviourSettingsPage::PlayBehaviour_Never)
@@ -227,6 +231,8 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
 
   qLog(Debug) << "Starting";
 
+  tracing::ScopedSpan span("MainWindow::MainWindow");
+
   connect(app, SIGNAL(ErrorAdded(QString)), SLOT(ShowErrorDialog(QString)));
   connect(app, SIGNAL(SettingsDialogRequested(SettingsDialog::Page)), SLOT(OpenSettingsDialogAtPage(SettingsDialog::Page)));
 
@@ -412,6 +418,14 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSD *osd, co
   connect(ui_->action_jump, SIGNAL(triggered()), ui_->playlist->view(), SLOT(JumpToCurrentlyPlayingTrack()));
   connect(ui_->action_update_collection, SIGNAL(triggered()), app_->collection(), SLOT(IncrementalScan()));
   connect(ui_->action_full_collection_scan, SIGNAL(triggered()), app_->collection(), SLOT(FullScan()));
+#if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
+  connect(ui_->action_fingerprint_collection, SIGNAL(triggered()), app_->fingerprint_store(), SLOT(FingerprintCollection()));
+  connect(ui_->action_find_acoustic_duplicates, SIGNAL(triggered()), app_->fingerprint_store(), SLOT(FindDuplicatesAsync()));
+  connect(app_->fingerprint_store(), SIGNAL(DuplicatesFound(SongList)), SLOT(AcousticDuplicatesFound(SongList)));
+#else
+  ui_->action_fingerprint_collection->setVisible(false);
+  ui_->action_find_acoustic_duplicates->setVisible(false);
+#endif
 #if defined(HAVE_GSTREAMER)
   connect(ui_->action_add_files_to_transcoder, SIGNAL(triggered()), SLOT(AddFilesToTranscoder()));
 #else
@@ -1179,6 +1193,17 @@ void MainWindow::StopAfterCurrent() {
   emit StopAfterToggled(app_->playlist_manager()->active()->stop_after_current());
 }
 
+void MainWindow::paintEvent(QPaintEvent *event) {
+
+  if (first_paint_) {
+    first_paint_ = false;
+    tracing::Instant("MainWindow::FirstPaint");
+  }
+
+  QMainWindow::paintEvent(event);
+
+}
+
 void MainWindow::closeEvent(QCloseEvent *event) {
 
   QSettings settings;
@@ -1361,6 +1386,7 @@ void MainWindow::AddToPlaylist(QAction *action) {
   }
   else {
     // we're inserting in a existing playlist
+    app_->playlist_manager()->playlist(destination)->EnsureRestored(true);
     app_->playlist_manager()->playlist(destination)->InsertItems(items);
   }
 
@@ -1634,6 +1660,8 @@ void MainWindow::RenumberTracks() {
     if (first_song.track() > 0) track = first_song.track();
   }
 
+  SongList songs;
+  QList<QPersistentModelIndex> source_indexes;
   for (const QModelIndex &index : indexes) {
     if (index.column() != 0) continue;
 
@@ -1643,21 +1671,35 @@ void MainWindow::RenumberTracks() {
 
     if (song.IsEditable()) {
       song.set_track(track);
-
-      TagReaderReply *reply = TagReaderClient::Instance()->SaveFile(song.url().toLocalFile(), song);
-
-      NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(SongSaveComplete(TagReaderReply*, QPersistentModelIndex)),reply, QPersistentModelIndex(source_index));
+      songs << song;
+      source_indexes << QPersistentModelIndex(source_index);
     }
     track++;
   }
 
+  if (songs.isEmpty()) return;
+
+  TagWriter *writer = new TagWriter(app_, this);
+  NewClosure(writer, SIGNAL(Finished(bool)), this, SLOT(SongsSaveComplete(TagWriter*, QList<QPersistentModelIndex>)), writer, source_indexes);
+  writer->Start(songs);
+
 }
 
-void MainWindow::SongSaveComplete(TagReaderReply *reply, const QPersistentModelIndex &index) {
-  if (reply->is_successful() && index.isValid()) {
-    app_->playlist_manager()->current()->ReloadItems(QList<int>()<< index.row());
+void MainWindow::SongsSaveComplete(TagWriter *writer, const QList<QPersistentModelIndex> &indexes) {
+
+  QSet<QUrl> saved_urls;
+  for (const Song &song : writer->saved()) {
+    saved_urls.insert(song.url());
+  }
+
+  QList<int> rows;
+  for (const QPersistentModelIndex &index : indexes) {
+    if (!index.isValid()) continue;
+    if (!saved_urls.contains(app_->playlist_manager()->current()->item_at(index.row())->Metadata().url())) continue;
+    rows << index.row();
   }
-  reply->deleteLater();
+  if (!rows.isEmpty()) app_->playlist_manager()->current()->ReloadItems(rows);
+
 }
 
 void MainWindow::SelectionSetValue() {
@@ -1667,6 +1709,8 @@ void MainWindow::SelectionSetValue() {
 
   QModelIndexList indexes =ui_->playlist->view()->selectionModel()->selection().indexes();
 
+  SongList songs;
+  QList<QPersistentModelIndex> source_indexes;
   for (const QModelIndex &index : indexes) {
     if (index.column() != 0) continue;
 
@@ -1675,12 +1719,17 @@ void MainWindow::SelectionSetValue() {
     Song song = app_->playlist_manager()->current()->item_at(row)->Metadata();
 
     if (Playlist::set_column_value(song, column, column_value)) {
-      TagReaderReply *reply = TagReaderClient::Instance()->SaveFile(song.url().toLocalFile(), song);
-
-      NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(SongSaveComplete(TagReaderReply*, QPersistentModelIndex)), reply, QPersistentModelIndex(source_index));
+      songs << song;
+      source_indexes << QPersistentModelIndex(source_index);
     }
   }
 
+  if (songs.isEmpty()) return;
+
+  TagWriter *writer = new TagWriter(app_, this);
+  NewClosure(writer, SIGNAL(Finished(bool)), this, SLOT(SongsSaveComplete(TagWriter*, QList<QPersistentModelIndex>)), writer, source_indexes);
+  writer->Start(songs);
+
 }
 
 void MainWindow::EditValue() {
@@ -2256,7 +2305,7 @@ void MainWindow::AutoCompleteTags() {
 
   // Create the tag fetching stuff if it hasn't been already
   if (!tag_fetcher_) {
-    tag_fetcher_.reset(new TagFetcher);
+    tag_fetcher_.reset(new TagFetcher(app_->fingerprint_store()));
     track_selection_dialog_.reset(new TrackSelectionDialog);
     track_selection_dialog_->set_save_on_close(true);
 
@@ -2297,6 +2346,17 @@ void MainWindow::AutoCompleteTagsAccepted() {
   // This is really lame but we don't know what rows have changed
   ui_->playlist->view()->update();
 }
+
+void MainWindow::AcousticDuplicatesFound(const SongList &songs) {
+
+  if (songs.isEmpty()) {
+    QMessageBox::information(this, tr("No duplicates found"), tr("No songs with the same audio were found. Only songs that have been fingerprinted are compared, use \"Fingerprint collection\" in the Tools menu first."));
+    return;
+  }
+
+  app_->playlist_manager()->New(tr("Duplicates"), songs);
+
+}
 #endif
 
 void MainWindow::HandleNotificationPreview(OSD::Behaviour type, QString line1, QString line2) {
@@ -82,6 +82,7 @@ class PlaylistListContainer;
 class QueueView;
 class Song;
 class SystemTrayIcon;
+class TagWriter;
 #if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
 class TagFetcher;
 #endif
@@ -116,6 +117,7 @@ class MainWindow : public QMainWindow, public PlatformInterface {
  protected:
   void keyPressEvent(QKeyEvent *event);
   void closeEvent(QCloseEvent *event);
+  void paintEvent(QPaintEvent *event);
 
 #ifdef Q_OS_WIN
   bool winEvent(MSG *message, long *result);
@@ -161,6 +163,7 @@ signals:
 #if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
   void AutoCompleteTags();
   void AutoCompleteTagsAccepted();
+  void AcousticDuplicatesFound(const SongList &songs);
 #endif
   void PlaylistUndoRedoChanged(QAction *undo, QAction *redo);
 #ifdef HAVE_GSTREAMER
@@ -216,7 +219,7 @@ signals:
 
   void PlayingWidgetPositionChanged(bool above_status_bar);
 
-  void SongSaveComplete(TagReaderReply *reply, const QPersistentModelIndex& index);
+  void SongsSaveComplete(TagWriter *writer, const QList<QPersistentModelIndex> &indexes);
 
   void ShowCoverManager();
 
@@ -348,6 +351,7 @@ signals:
   bool initialised_;
   bool was_maximized_;
   bool playing_widget_;
+  bool first_paint_;
   BehaviourSettingsPage::AddBehaviour doubleclick_addmode_;
   BehaviourSettingsPage::PlayBehaviour doubleclick_playmode_;
   BehaviourSettingsPage::PlaylistAddBehaviour doubleclick_playlist_addmode_;
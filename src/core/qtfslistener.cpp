@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <QString>
+#include <QFileInfo>
 
 #include "filesystemwatcherinterface.h"
 #include "qtfslistener.h"
@@ -31,13 +32,27 @@ QtFSListener::QtFSListener(QObject *parent) : FileSystemWatcherInterface(parent)
 
 }
 
-void QtFSListener::AddPath(const QString &path) { watcher_.addPath(path); }
+void QtFSListener::AddPath(const QString &path) {
+
+  if (paths_.contains(path)) return;
+
+  if (watcher_.addPath(path)) {
+    paths_.insert(path);
+  }
+  // Paths that were removed in the meantime can't be watched either, only report the limit for paths that exist.
+  else if (QFileInfo::exists(path)) {
+    emit WatchLimitReached();
+  }
+
+}
 
 void QtFSListener::RemovePath(const QString &path) {
   watcher_.removePath(path);
+  paths_.remove(path);
 }
 
 void QtFSListener::Clear() {
   watcher_.removePaths(watcher_.directories());
   watcher_.removePaths(watcher_.files());
+  paths_.clear();
 }
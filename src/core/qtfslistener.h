@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QFileSystemWatcher>
 #include <QString>
+#include <QSet>
 
 #include "filesystemwatcherinterface.h"
 
@@ -39,6 +40,8 @@ class QtFSListener : public FileSystemWatcherInterface {
 
  private:
   QFileSystemWatcher watcher_;
+  // The paths being watched, QFileSystemWatcher only has lists of them.
+  QSet<QString> paths_;
 
 };
 
@@ -57,6 +57,8 @@
 #include "core/logging.h"
 #include "core/messagehandler.h"
 #include "core/iconloader.h"
+#include "core/sqlitequery.h"
+#include "core/stringinterner.h"
 
 #include "engine/enginebase.h"
 #include "timeconstants.h"
@@ -73,60 +75,121 @@ using std::sort;
 using namespace Strawberry_TagLib;
 #endif
 
-const QStringList Song::kColumns = QStringList() << "title"
-                                                 << "album"
-                                                 << "artist"
-                                                 << "albumartist"
-                                                 << "track"
-                                                 << "disc"
-                                                 << "year"
-                                                 << "originalyear"
-                                                 << "genre"
-                                                 << "compilation"
-                                                 << "composer"
-                                                 << "performer"
-                                                 << "grouping"
-                                                 << "comment"
-                                                 << "lyrics"
-
-                                                 << "artist_id"
-                                                 << "album_id"
-                                                 << "song_id"
-
-                                                 << "beginning"
-                                                 << "length"
-
-                                                 << "bitrate"
-                                                 << "samplerate"
-                                                 << "bitdepth"
-
-                                                 << "source"
-                                                 << "directory_id"
-                                                 << "filename"
-                                                 << "filetype"
-                                                 << "filesize"
-                                                 << "mtime"
-                                                 << "ctime"
-                                                 << "unavailable"
-
-                                                 << "playcount"
-                                                 << "skipcount"
-                                                 << "lastplayed"
-
-                                                 << "compilation_detected"
-                                                 << "compilation_on"
-                                                 << "compilation_off"
-                                                 << "compilation_effective"
-
-                                                 << "art_automatic"
-                                                 << "art_manual"
-
-                                                 << "effective_albumartist"
-                                                 << "effective_originalyear"
-
-                                                 << "cue_path"
-
-						 ;
+namespace {
+
+// Where each column of the songs table goes when a song is read from the database.
+// Columns that are only computed by queries are ignored.
+enum ColumnField {
+  Field_Title,
+  Field_Album,
+  Field_Artist,
+  Field_AlbumArtist,
+  Field_Track,
+  Field_Disc,
+  Field_Year,
+  Field_OriginalYear,
+  Field_Genre,
+  Field_Compilation,
+  Field_Composer,
+  Field_Performer,
+  Field_Grouping,
+  Field_Comment,
+  Field_Lyrics,
+  Field_ArtistId,
+  Field_AlbumId,
+  Field_SongId,
+  Field_Beginning,
+  Field_Length,
+  Field_Bitrate,
+  Field_Samplerate,
+  Field_Bitdepth,
+  Field_Source,
+  Field_DirectoryId,
+  Field_Filename,
+  Field_Filetype,
+  Field_Filesize,
+  Field_Mtime,
+  Field_Ctime,
+  Field_Unavailable,
+  Field_Playcount,
+  Field_Skipcount,
+  Field_Lastplayed,
+  Field_CompilationDetected,
+  Field_CompilationOn,
+  Field_CompilationOff,
+  Field_ArtAutomatic,
+  Field_ArtManual,
+  Field_CuePath,
+  Field_Ignored
+};
+
+struct ColumnDescriptor {
+  const char *name;
+  ColumnField field;
+};
+
+// The order of the columns in the songs table, Song::kColumns is built from this.
+constexpr ColumnDescriptor kColumnTable[] = {
+  { "title", Field_Title },
+  { "album", Field_Album },
+  { "artist", Field_Artist },
+  { "albumartist", Field_AlbumArtist },
+  { "track", Field_Track },
+  { "disc", Field_Disc },
+  { "year", Field_Year },
+  { "originalyear", Field_OriginalYear },
+  { "genre", Field_Genre },
+  { "compilation", Field_Compilation },
+  { "composer", Field_Composer },
+  { "performer", Field_Performer },
+  { "grouping", Field_Grouping },
+  { "comment", Field_Comment },
+  { "lyrics", Field_Lyrics },
+  { "artist_id", Field_ArtistId },
+  { "album_id", Field_AlbumId },
+  { "song_id", Field_SongId },
+  { "beginning", Field_Beginning },
+  { "length", Field_Length },
+  { "bitrate", Field_Bitrate },
+  { "samplerate", Field_Samplerate },
+  { "bitdepth", Field_Bitdepth },
+  { "source", Field_Source },
+  { "directory_id", Field_DirectoryId },
+  { "filename", Field_Filename },
+  { "filetype", Field_Filetype },
+  { "filesize", Field_Filesize },
+  { "mtime", Field_Mtime },
+  { "ctime", Field_Ctime },
+  { "unavailable", Field_Unavailable },
+  { "playcount", Field_Playcount },
+  { "skipcount", Field_Skipcount },
+  { "lastplayed", Field_Lastplayed },
+  { "compilation_detected", Field_CompilationDetected },
+  { "compilation_on", Field_CompilationOn },
+  { "compilation_off", Field_CompilationOff },
+  { "compilation_effective", Field_Ignored },
+  { "art_automatic", Field_ArtAutomatic },
+  { "art_manual", Field_ArtManual },
+  { "effective_albumartist", Field_Ignored },
+  { "effective_originalyear", Field_Ignored },
+  { "cue_path", Field_CuePath }
+};
+
+constexpr int kColumnCount = sizeof(kColumnTable) / sizeof(kColumnTable[0]);
+
+QStringList ColumnNames() {
+
+  QStringList ret;
+  for (const ColumnDescriptor &column : kColumnTable) {
+    ret << column.name;
+  }
+  return ret;
+
+}
+
+}  // namespace
+
+const QStringList Song::kColumns = ColumnNames();
 
 const QString Song::kColumnSpec = Song::kColumns.join(", ");
 const QString Song::kBindSpec = Utilities::Prepend(":", Song::kColumns).join(", ");
@@ -616,18 +679,18 @@ void Song::InitFromProtobuf(const pb::tagreader::SongMetadata &pb) {
   d->init_from_file_ = true;
   d->valid_ = pb.valid();
   d->title_ = QStringFromStdString(pb.title());
-  d->album_ = QStringFromStdString(pb.album());
-  d->artist_ = QStringFromStdString(pb.artist());
-  d->albumartist_ = QStringFromStdString(pb.albumartist());
+  d->album_ = StringInterner::Intern(QStringFromStdString(pb.album()));
+  d->artist_ = StringInterner::Intern(QStringFromStdString(pb.artist()));
+  d->albumartist_ = StringInterner::Intern(QStringFromStdString(pb.albumartist()));
   d->track_ = pb.track();
   d->disc_ = pb.disc();
   d->year_ = pb.year();
   d->originalyear_ = pb.originalyear();
-  d->genre_ = QStringFromStdString(pb.genre());
+  d->genre_ = StringInterner::Intern(QStringFromStdString(pb.genre()));
   d->compilation_ = pb.compilation();
-  d->composer_ = QStringFromStdString(pb.composer());
-  d->performer_ = QStringFromStdString(pb.performer());
-  d->grouping_ = QStringFromStdString(pb.grouping());
+  d->composer_ = StringInterner::Intern(QStringFromStdString(pb.composer()));
+  d->performer_ = StringInterner::Intern(QStringFromStdString(pb.performer()));
+  d->grouping_ = StringInterner::Intern(QStringFromStdString(pb.grouping()));
   d->comment_ = QStringFromStdString(pb.comment());
   d->lyrics_ = QStringFromStdString(pb.lyrics());
   set_length_nanosec(pb.length_nanosec());
@@ -694,167 +757,193 @@ void Song::ToProtobuf(pb::tagreader::SongMetadata *pb) const {
 
 }
 
-#define tostr(n) (q.value(n).isNull() ? QString::null : q.value(n).toString())
-#define toint(n) (q.value(n).isNull() ? -1 : q.value(n).toInt())
-#define tolonglong(n) (q.value(n).isNull() ? -1 : q.value(n).toLongLong())
-#define tofloat(n) (q.value(n).isNull() ? -1 : q.value(n).toDouble())
+namespace {
 
-void Song::InitFromQuery(const SqlRow &q, bool reliable_metadata, int col) {
+// Lets InitFromRow read rows from QSqlQuery and SqliteQuery the same way.
+class VariantRow {
+ public:
+  explicit VariantRow(const SqlRow &row) : row_(row) {}
 
-  //qLog(Debug) << "Song::kColumns.size():" << Song::kColumns.size() << "q.columns_.size():" << q.columns_.size() << "col:" << col;
+  int count() const { return row_.columns_.size(); }
+  bool IsNull(const int i) const { return row_.value(i).isNull(); }
+  bool Bool(const int i) const { return row_.value(i).toBool(); }
+  int Int(const int i) const { return row_.value(i).toInt(); }
+  qint64 LongLong(const int i) const { return row_.value(i).toLongLong(); }
+  QString String(const int i) const { return row_.value(i).toString(); }
+  QByteArray Utf8(const int i) const { return row_.value(i).toString().toUtf8(); }
 
-  int x = col;
-  d->id_ = toint(col);
-
-  for (int i = 0 ; i < Song::kColumns.size(); i++) {
-    x++;
-
-    if (x >= q.columns_.size()) {
-      qLog(Error) << "Skipping" << Song::kColumns.value(i);
-      break;
-    }
-
-    //qLog(Debug) << "Index:" << i << x << Song::kColumns.value(i) << q.value(x).toString();
+ private:
+  const SqlRow &row_;
+};
 
-    if (Song::kColumns.value(i) == "title") {
-      d->title_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "album") {
-      d->album_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "artist") {
-      d->artist_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "albumartist") {
-      d->albumartist_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "track") {
-      d->track_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "disc") {
-      d->disc_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "year") {
-      d->year_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "originalyear") {
-      d->originalyear_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "genre") {
-      d->genre_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "compilation") {
-      d->compilation_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "composer") {
-      d->composer_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "performer") {
-      d->performer_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "grouping") {
-      d->grouping_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "comment") {
-      d->comment_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "lyrics") {
-      d->comment_ = tostr(x);
-    }
+class SqliteRow {
+ public:
+  explicit SqliteRow(const SqliteQuery &query) : query_(query) {}
 
-    else if (Song::kColumns.value(i) == "artist_id") {
-      d->artist_id_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "album_id") {
-      d->album_id_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "song_id") {
-      d->song_id_ = toint(x);
-    }
+  int count() const { return query_.column_count(); }
+  bool IsNull(const int i) const { return query_.IsNull(i); }
+  bool Bool(const int i) const { return query_.Int(i) != 0; }
+  int Int(const int i) const { return query_.Int(i); }
+  qint64 LongLong(const int i) const { return query_.LongLong(i); }
+  QString String(const int i) const { return query_.String(i); }
+  QByteArray Utf8(const int i) const { return query_.Utf8(i); }
 
-    else if (Song::kColumns.value(i) == "beginning") {
-      d->beginning_ = q.value(x).isNull() ? 0 : q.value(x).toLongLong();
-    }
-    else if (Song::kColumns.value(i) == "length") {
-      set_length_nanosec(tolonglong(x));
-    }
+ private:
+  const SqliteQuery &query_;
+};
 
-    else if (Song::kColumns.value(i) == "bitrate") {
-      d->bitrate_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "samplerate") {
-      d->samplerate_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "bitdepth") {
-      d->bitdepth_ = toint(x);
-    }
+}  // namespace
 
-    else if (Song::kColumns.value(i) == "source") {
-      d->source_ = Source(q.value(x).toInt());
-    }
-    else if (Song::kColumns.value(i) == "directory_id") {
-      d->directory_id_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "filename") {
-     set_url(QUrl::fromEncoded(tostr(x).toUtf8()));
-     d->basefilename_ = QFileInfo(d->url_.toLocalFile()).fileName();
-    }
-    else if (Song::kColumns.value(i) == "filetype") {
-      d->filetype_ = FileType(q.value(x).toInt());
-    }
-    else if (Song::kColumns.value(i) == "filesize") {
-      d->filesize_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "mtime") {
-      d->mtime_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "ctime") {
-      d->ctime_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "unavailable") {
-      d->unavailable_ = q.value(x).toBool();
-    }
+void Song::InitFromQuery(const SqlRow &q, bool reliable_metadata, int col) {
+  InitFromRow(VariantRow(q), reliable_metadata, col);
+}
 
-    else if (Song::kColumns.value(i) == "playcount") {
-      d->playcount_ = q.value(x).isNull() ? 0 : q.value(x).toInt();
-    }
-    else if (Song::kColumns.value(i) == "skipcount") {
-      d->skipcount_ = q.value(x).isNull() ? 0 : q.value(x).toInt();
-    }
-    else if (Song::kColumns.value(i) == "lastplayed") {
-      d->lastplayed_ = toint(x);
-    }
+void Song::InitFromQuery(const SqliteQuery &q, bool reliable_metadata, int col) {
+  InitFromRow(SqliteRow(q), reliable_metadata, col);
+}
 
-    else if (Song::kColumns.value(i) == "compilation_detected") {
-      d->compilation_detected_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_on") {
-      d->compilation_on_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_off") {
-      d->compilation_off_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_effective") {
-    }
+#define tostr(n) (row.IsNull(n) ? QString::null : row.String(n))
+#define toint(n) (row.IsNull(n) ? -1 : row.Int(n))
+#define tolonglong(n) (row.IsNull(n) ? -1 : row.LongLong(n))
 
-    else if (Song::kColumns.value(i) == "art_automatic") {
-      d->art_automatic_ = q.value(x).toString();
-    }
-    else if (Song::kColumns.value(i) == "art_manual") {
-      d->art_manual_ = q.value(x).toString();
-    }
+template <typename Row>
+void Song::InitFromRow(const Row &row, bool reliable_metadata, int col) {
 
-    else if (Song::kColumns.value(i) == "effective_albumartist") {
-    }
-    else if (Song::kColumns.value(i) == "effective_originalyear") {
-    }
+  d->id_ = toint(col);
 
-    else if (Song::kColumns.value(i) == "cue_path") {
-      d->cue_path_ = tostr(x);
-    }
+  int count = kColumnCount;
+  if (col + kColumnCount >= row.count()) {
+    count = qMax(0, row.count() - col - 1);
+    qLog(Error) << "Skipping" << kColumnCount - count << "columns starting at" << kColumnTable[count].name;
+  }
 
-    else {
-      qLog(Error) << "Forgot to handle" << Song::kColumns.value(i);
+  for (int i = 0 ; i < count ; ++i) {
+    const int x = col + 1 + i;
+
+    switch (kColumnTable[i].field) {
+      case Field_Title:
+        d->title_ = tostr(x);
+        break;
+      case Field_Album:
+        d->album_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Artist:
+        d->artist_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_AlbumArtist:
+        d->albumartist_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Track:
+        d->track_ = toint(x);
+        break;
+      case Field_Disc:
+        d->disc_ = toint(x);
+        break;
+      case Field_Year:
+        d->year_ = toint(x);
+        break;
+      case Field_OriginalYear:
+        d->originalyear_ = toint(x);
+        break;
+      case Field_Genre:
+        d->genre_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Compilation:
+        d->compilation_ = row.Bool(x);
+        break;
+      case Field_Composer:
+        d->composer_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Performer:
+        d->performer_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Grouping:
+        d->grouping_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Comment:
+        d->comment_ = tostr(x);
+        break;
+      case Field_Lyrics:
+        d->lyrics_ = tostr(x);
+        break;
+      case Field_ArtistId:
+        d->artist_id_ = toint(x);
+        break;
+      case Field_AlbumId:
+        d->album_id_ = toint(x);
+        break;
+      case Field_SongId:
+        d->song_id_ = toint(x);
+        break;
+      case Field_Beginning:
+        d->beginning_ = row.IsNull(x) ? 0 : row.LongLong(x);
+        break;
+      case Field_Length:
+        set_length_nanosec(tolonglong(x));
+        break;
+      case Field_Bitrate:
+        d->bitrate_ = toint(x);
+        break;
+      case Field_Samplerate:
+        d->samplerate_ = toint(x);
+        break;
+      case Field_Bitdepth:
+        d->bitdepth_ = toint(x);
+        break;
+      case Field_Source:
+        d->source_ = Source(row.Int(x));
+        break;
+      case Field_DirectoryId:
+        d->directory_id_ = toint(x);
+        break;
+      case Field_Filename:
+        set_url(QUrl::fromEncoded(row.Utf8(x)));
+        d->basefilename_ = QFileInfo(d->url_.toLocalFile()).fileName();
+        break;
+      case Field_Filetype:
+        d->filetype_ = FileType(row.Int(x));
+        break;
+      case Field_Filesize:
+        d->filesize_ = toint(x);
+        break;
+      case Field_Mtime:
+        d->mtime_ = toint(x);
+        break;
+      case Field_Ctime:
+        d->ctime_ = toint(x);
+        break;
+      case Field_Unavailable:
+        d->unavailable_ = row.Bool(x);
+        break;
+      case Field_Playcount:
+        d->playcount_ = row.IsNull(x) ? 0 : row.Int(x);
+        break;
+      case Field_Skipcount:
+        d->skipcount_ = row.IsNull(x) ? 0 : row.Int(x);
+        break;
+      case Field_Lastplayed:
+        d->lastplayed_ = toint(x);
+        break;
+      case Field_CompilationDetected:
+        d->compilation_detected_ = row.Bool(x);
+        break;
+      case Field_CompilationOn:
+        d->compilation_on_ = row.Bool(x);
+        break;
+      case Field_CompilationOff:
+        d->compilation_off_ = row.Bool(x);
+        break;
+      case Field_ArtAutomatic:
+        d->art_automatic_ = StringInterner::Intern(row.String(x));
+        break;
+      case Field_ArtManual:
+        d->art_manual_ = StringInterner::Intern(row.String(x));
+        break;
+      case Field_CuePath:
+        d->cue_path_ = StringInterner::Intern(tostr(x));
+        break;
+      case Field_Ignored:
+        break;
     }
   }
 
@@ -866,7 +955,6 @@ void Song::InitFromQuery(const SqlRow &q, bool reliable_metadata, int col) {
 #undef tostr
 #undef toint
 #undef tolonglong
-#undef tofloat
 
 }
 
@@ -61,6 +61,7 @@ struct LIBMTP_track_struct;
 #endif
 
 class SqlRow;
+class SqliteQuery;
 
 class Song {
 
@@ -149,6 +150,7 @@ class Song {
   void Init(const QString &title, const QString &artist, const QString &album, qint64 beginning, qint64 end);
   void InitFromProtobuf(const pb::tagreader::SongMetadata &pb);
   void InitFromQuery(const SqlRow &query, bool reliable_metadata, int col = 0);
+  void InitFromQuery(const SqliteQuery &query, bool reliable_metadata, int col = 0);
   void InitFromFilePartial(const QString &filename);  // Just store the filename: incomplete but fast
   void InitArtManual();  // Check if there is already a art in the cache and store the filename in art_manual
 
@@ -340,6 +342,9 @@ class Song {
  private:
   struct Private;
 
+  template <typename Row>
+  void InitFromRow(const Row &row, bool reliable_metadata, int col);
+
   QSharedDataPointer<Private> d;
 };
 Q_DECLARE_METATYPE(Song);
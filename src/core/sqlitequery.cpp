@@ -0,0 +1,239 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <sqlite3.h>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVariant>
+#include <QString>
+#include <QSqlDriver>
+#include <QSqlDatabase>
+
+#include "sqlitequery.h"
+
+SqliteQuery::SqliteQuery(QSqlDatabase db) : handle_(nullptr), stmt_(nullptr), bind_index_(0), state_(State_Prepared) {
+
+  QVariant v = db.driver()->handle();
+  if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+    handle_ = *static_cast<sqlite3**>(v.data());
+  }
+
+}
+
+SqliteQuery::~SqliteQuery() {
+  if (stmt_) sqlite3_finalize(stmt_);
+}
+
+bool SqliteQuery::Prepare(const QString &sql) {
+
+  if (stmt_) {
+    sqlite3_finalize(stmt_);
+    stmt_ = nullptr;
+  }
+  bind_index_ = 0;
+  state_ = State_Prepared;
+  bound_values_.clear();
+  last_error_.clear();
+  last_query_ = sql;
+
+  if (!handle_) {
+    last_error_ = "No SQLite connection";
+    return false;
+  }
+
+  const QByteArray utf8 = sql.toUtf8();
+  const int result = sqlite3_prepare_v2(handle_, utf8.constData(), utf8.size(), &stmt_, nullptr);
+  if (result != SQLITE_OK) {
+    SetError(result);
+    return false;
+  }
+
+  return true;
+
+}
+
+void SqliteQuery::AddBindValue(const QVariant &value) {
+  Bind(++bind_index_, value);
+}
+
+void SqliteQuery::BindValue(const QString &placeholder, const QVariant &value) {
+
+  if (!stmt_) return;
+
+  const int index = sqlite3_bind_parameter_index(stmt_, placeholder.toUtf8().constData());
+  if (index == 0) {
+    last_error_ = QString("Unknown placeholder %1").arg(placeholder);
+    return;
+  }
+  Bind(index, value);
+
+}
+
+bool SqliteQuery::Bind(const int index, const QVariant &value) {
+
+  if (!stmt_) return false;
+
+  bound_values_ << value;
+
+  int result = SQLITE_OK;
+  if (value.isNull()) {
+    result = sqlite3_bind_null(stmt_, index);
+  }
+  else {
+    switch (value.type()) {
+      case QVariant::Bool:
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+      case QVariant::ULongLong:
+        result = sqlite3_bind_int64(stmt_, index, value.toLongLong());
+        break;
+      case QVariant::Double:
+        result = sqlite3_bind_double(stmt_, index, value.toDouble());
+        break;
+      case QVariant::ByteArray: {
+        const QByteArray data = value.toByteArray();
+        result = sqlite3_bind_blob(stmt_, index, data.constData(), data.size(), SQLITE_TRANSIENT);
+        break;
+      }
+      default: {
+        const QByteArray utf8 = value.toString().toUtf8();
+        result = sqlite3_bind_text(stmt_, index, utf8.constData(), utf8.size(), SQLITE_TRANSIENT);
+        break;
+      }
+    }
+  }
+
+  if (result != SQLITE_OK) {
+    SetError(result);
+    return false;
+  }
+
+  return true;
+
+}
+
+bool SqliteQuery::Exec() {
+
+  if (!stmt_ || has_error()) return false;
+
+  sqlite3_reset(stmt_);
+
+  // Step to the first row already, so errors show up here the same as with QSqlQuery::exec().
+  const int result = sqlite3_step(stmt_);
+  if (result == SQLITE_ROW) {
+    state_ = State_FirstRow;
+  }
+  else if (result == SQLITE_DONE) {
+    state_ = State_Done;
+  }
+  else {
+    state_ = State_Done;
+    SetError(result);
+    return false;
+  }
+
+  return true;
+
+}
+
+bool SqliteQuery::Next() {
+
+  switch (state_) {
+    case State_Prepared:
+    case State_Done:
+      return false;
+
+    case State_FirstRow:
+      state_ = State_Stepping;
+      return true;
+
+    case State_Stepping:
+      break;
+  }
+
+  const int result = sqlite3_step(stmt_);
+  if (result == SQLITE_ROW) return true;
+
+  state_ = State_Done;
+  if (result != SQLITE_DONE) SetError(result);
+  return false;
+
+}
+
+int SqliteQuery::column_count() const {
+  return stmt_ ? sqlite3_column_count(stmt_) : 0;
+}
+
+bool SqliteQuery::IsNull(const int column) const {
+  return sqlite3_column_type(stmt_, column) == SQLITE_NULL;
+}
+
+int SqliteQuery::Int(const int column) const {
+  return sqlite3_column_int(stmt_, column);
+}
+
+qint64 SqliteQuery::LongLong(const int column) const {
+  return sqlite3_column_int64(stmt_, column);
+}
+
+double SqliteQuery::Double(const int column) const {
+  return sqlite3_column_double(stmt_, column);
+}
+
+QString SqliteQuery::String(const int column) const {
+
+  const char *text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, column));
+  if (!text) return QString();
+  return QString::fromUtf8(text, sqlite3_column_bytes(stmt_, column));
+
+}
+
+QByteArray SqliteQuery::Utf8(const int column) const {
+
+  const char *text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, column));
+  if (!text) return QByteArray();
+  return QByteArray(text, sqlite3_column_bytes(stmt_, column));
+
+}
+
+QVariant SqliteQuery::Value(const int column) const {
+
+  switch (sqlite3_column_type(stmt_, column)) {
+    case SQLITE_INTEGER:
+      return LongLong(column);
+    case SQLITE_FLOAT:
+      return Double(column);
+    case SQLITE_BLOB:
+      return QByteArray(static_cast<const char*>(sqlite3_column_blob(stmt_, column)), sqlite3_column_bytes(stmt_, column));
+    case SQLITE_NULL:
+      return QVariant(QVariant::String);
+    default:
+      return String(column);
+  }
+
+}
+
+void SqliteQuery::SetError(const int result) {
+
+  last_error_ = QString("%1 (%2)").arg(QString::fromUtf8(sqlite3_errmsg(handle_))).arg(result);
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SQLITEQUERY_H
+#define SQLITEQUERY_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVariant>
+#include <QVariantList>
+#include <QString>
+#include <QSqlDatabase>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Steps a statement with the SQLite API directly, for queries that read many rows.
+// QSqlQuery copies each row into a QSqlRecord of QVariants first, this reads the columns straight into the types they're stored as.
+// The database connection has to stay open as long as the query exists.
+class SqliteQuery {
+ public:
+  explicit SqliteQuery(QSqlDatabase db);
+  ~SqliteQuery();
+
+  bool Prepare(const QString &sql);
+  void AddBindValue(const QVariant &value);
+  void BindValue(const QString &placeholder, const QVariant &value);
+  bool Exec();
+  bool Next();
+
+  int column_count() const;
+  bool IsNull(const int column) const;
+  int Int(const int column) const;
+  qint64 LongLong(const int column) const;
+  double Double(const int column) const;
+  // Text is decoded from UTF-8 once, without an intermediate QVariant.
+  QString String(const int column) const;
+  QByteArray Utf8(const int column) const;
+  QVariant Value(const int column) const;
+
+  bool has_error() const { return !last_error_.isEmpty(); }
+  QString last_error() const { return last_error_; }
+  QString last_query() const { return last_query_; }
+  QVariantList bound_values() const { return bound_values_; }
+
+ private:
+  Q_DISABLE_COPY(SqliteQuery)
+
+  enum State {
+    State_Prepared,
+    State_FirstRow,
+    State_Stepping,
+    State_Done
+  };
+
+  bool Bind(const int index, const QVariant &value);
+  void SetError(const int result);
+
+  sqlite3 *handle_;
+  sqlite3_stmt *stmt_;
+  int bind_index_;
+  State state_;
+  QString last_query_;
+  QString last_error_;
+  QVariantList bound_values_;
+};
+
+#endif  // SQLITEQUERY_H
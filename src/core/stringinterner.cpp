@@ -0,0 +1,95 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QString>
+
+#include "core/logging.h"
+#include "stringinterner.h"
+
+StringInterner::Shard StringInterner::shards_[StringInterner::kShards];
+
+QString StringInterner::Intern(const QString &str) {
+
+  if (str.isEmpty()) return str;
+
+  Shard &shard = shards_[qHash(str) % kShards];
+  QMutexLocker l(&shard.mutex);
+
+  QSet<QString>::const_iterator it = shard.strings.constFind(str);
+  if (it != shard.strings.constEnd()) {
+    ++shard.hits;
+    shard.hit_bytes += str.size() * sizeof(QChar);
+    return *it;
+  }
+
+  shard.strings.insert(str);
+  return str;
+
+}
+
+int StringInterner::Prune() {
+
+  int removed = 0;
+
+  for (Shard &shard : shards_) {
+    QMutexLocker l(&shard.mutex);
+    // A string that's only referenced by the set isn't used by any song.
+    QSet<QString>::iterator it = shard.strings.begin();
+    while (it != shard.strings.end()) {
+      if (it->isDetached()) {
+        it = shard.strings.erase(it);
+        ++removed;
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+
+  return removed;
+
+}
+
+StringInterner::Stats StringInterner::stats() {
+
+  Stats stats;
+
+  for (Shard &shard : shards_) {
+    QMutexLocker l(&shard.mutex);
+    stats.strings += shard.strings.count();
+    for (const QString &str : shard.strings) stats.bytes += str.size() * sizeof(QChar);
+    stats.hits += shard.hits;
+    stats.saved_bytes += shard.hit_bytes;
+  }
+
+  return stats;
+
+}
+
+void StringInterner::LogStats() {
+
+  const Stats s = stats();
+  qLog(Debug) << "Interned" << s.strings << "strings using" << s.bytes / 1024 << "KiB, sharing" << s.hits << "repeated strings saved" << s.saved_bytes / 1024 << "KiB";
+
+}
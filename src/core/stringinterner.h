@@ -0,0 +1,69 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+// Keeps a single copy of the metadata strings that repeat across songs, like artist, album and genre.
+// QString is implicitly shared, so all songs with the same artist point to the same buffer instead of each having their own.
+class StringInterner {
+ public:
+  struct Stats {
+    Stats() : strings(0), bytes(0), hits(0), saved_bytes(0) {}
+    int strings;
+    qint64 bytes;
+    // Calls to Intern() that returned a string that was already there, and the size of the copies they didn't need to keep.
+    // These count from the start, including strings of songs that are gone again.
+    qint64 hits;
+    qint64 saved_bytes;
+  };
+
+  // Thread safe, songs are loaded from the database in worker threads.
+  static QString Intern(const QString &str);
+
+  // Removes the strings that no song uses anymore, returns how many were removed.
+  static int Prune();
+
+  static Stats stats();
+  static void LogStats();
+
+ private:
+  StringInterner() {}
+
+  // The strings are spread over a few sets with their own lock, so threads loading songs at the same time rarely wait for each other.
+  static const int kShards = 16;
+
+  struct Shard {
+    Shard() : hits(0), hit_bytes(0) {}
+    QMutex mutex;
+    QSet<QString> strings;
+    qint64 hits;
+    qint64 hit_bytes;
+  };
+
+  static Shard shards_[kShards];
+};
+
+#endif  // STRINGINTERNER_H
@@ -37,6 +37,7 @@
 #include "tagreaderclient.h"
 
 const char *TagReaderClient::kWorkerExecutableName = "strawberry-tagreader";
+const int TagReaderClient::kSaveFilesBatchSize = 50;
 TagReaderClient *TagReaderClient::sInstance = nullptr;
 
 TagReaderClient::TagReaderClient(QObject *parent) : QObject(parent), worker_pool_(new WorkerPool<HandlerType>(this)) {
@@ -79,6 +80,21 @@ TagReaderReply *TagReaderClient::SaveFile(const QString &filename, const Song &m
 
 }
 
+TagReaderReply *TagReaderClient::SaveFiles(const SongList &songs) {
+
+  pb::tagreader::Message message;
+  pb::tagreader::SaveFilesRequest *req = message.mutable_save_files_request();
+
+  for (const Song &song : songs) {
+    pb::tagreader::SaveFileRequest *file = req->add_files();
+    file->set_filename(DataCommaSizeFromQString(song.url().toLocalFile()));
+    song.ToProtobuf(file->mutable_metadata());
+  }
+
+  return worker_pool_->SendMessageWithReply(&message);
+
+}
+
 TagReaderReply *TagReaderClient::IsMediaFile(const QString &filename) {
 
   pb::tagreader::Message message;
@@ -49,11 +49,14 @@ class TagReaderClient : public QObject {
   typedef HandlerType::ReplyType ReplyType;
 
   static const char *kWorkerExecutableName;
+  static const int kSaveFilesBatchSize;
 
   void Start();
 
   ReplyType *ReadFile(const QString &filename);
   ReplyType *SaveFile(const QString &filename, const Song &metadata);
+  // Saves the tags of all songs to their local files with one request, the response has the result for each song in the same order.
+  ReplyType *SaveFiles(const SongList &songs);
   ReplyType *IsMediaFile(const QString &filename);
   ReplyType *LoadEmbeddedArt(const QString &filename);
 
@@ -0,0 +1,98 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QObject>
+#include <QMetaObject>
+
+#include "core/application.h"
+#include "core/closure.h"
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/tagreaderclient.h"
+#include "core/taskmanager.h"
+#include "collection/collectionbackend.h"
+#include "tagwriter.h"
+
+TagWriter::TagWriter(Application *app, QObject *parent)
+    : QObject(parent),
+      app_(app),
+      task_id_(-1),
+      pending_(0),
+      done_(0),
+      total_(0) {}
+
+void TagWriter::Start(const SongList &songs) {
+
+  total_ = songs.count();
+  if (total_ == 0) {
+    // Let the caller connect to Finished first.
+    QMetaObject::invokeMethod(this, "Finish", Qt::QueuedConnection);
+    return;
+  }
+
+  task_id_ = app_->task_manager()->StartTask(tr("Saving tags"));
+
+  // The batches are spread over the workers, each worker saves a whole batch per round trip.
+  for (int i = 0 ; i < songs.count() ; i += TagReaderClient::kSaveFilesBatchSize) {
+    const SongList batch = songs.mid(i, TagReaderClient::kSaveFilesBatchSize);
+    TagReaderReply *reply = TagReaderClient::Instance()->SaveFiles(batch);
+    NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(BatchSaved(TagReaderReply*, SongList)), reply, batch);
+    ++pending_;
+  }
+
+}
+
+void TagWriter::BatchSaved(TagReaderReply *reply, const SongList &songs) {
+
+  reply->deleteLater();
+
+  const pb::tagreader::SaveFilesResponse &response = reply->message().save_files_response();
+  for (int i = 0 ; i < songs.count() ; ++i) {
+    if (reply->is_successful() && i < response.success_size() && response.success(i)) {
+      saved_ << songs[i];
+    }
+    else {
+      qLog(Error) << "Failed to write metadata to" << songs[i].url().toLocalFile();
+      failed_ << songs[i];
+    }
+  }
+
+  done_ += songs.count();
+  app_->task_manager()->SetTaskProgress(task_id_, done_, total_);
+
+  if (--pending_ == 0) Finish();
+
+}
+
+void TagWriter::Finish() {
+
+  if (task_id_ != -1) app_->task_manager()->SetTaskFinished(task_id_);
+
+  // Update the collection in one go, AddOrUpdateSongs does it in a single transaction.
+  SongList collection_songs;
+  for (const Song &song : saved_) {
+    if (song.directory_id() != -1) collection_songs << song;
+  }
+  if (!collection_songs.isEmpty()) app_->collection_backend()->AddOrUpdateSongs(collection_songs);
+
+  emit Finished(failed_.isEmpty());
+  deleteLater();
+
+}
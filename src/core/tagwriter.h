@@ -0,0 +1,65 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TAGWRITER_H
+#define TAGWRITER_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QObject>
+
+#include "core/song.h"
+#include "core/tagreaderclient.h"
+
+class Application;
+
+// Saves the tags of many songs, in batches of TagReaderClient::kSaveFilesBatchSize songs per request to the tagreader workers.
+// Progress is shown as one task, and the collection is updated for all saved songs at once when everything is done.
+// The TagWriter deletes itself after emitting Finished.
+class TagWriter : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit TagWriter(Application *app, QObject *parent = nullptr);
+
+  void Start(const SongList &songs);
+
+  const SongList &saved() const { return saved_; }
+  const SongList &failed() const { return failed_; }
+
+ signals:
+  void Finished(bool success);
+
+ private slots:
+  void BatchSaved(TagReaderReply *reply, const SongList &songs);
+  void Finish();
+
+ private:
+  Application *app_;
+  int task_id_;
+  int pending_;
+  int done_;
+  int total_;
+
+  SongList saved_;
+  SongList failed_;
+};
+
+#endif  // TAGWRITER_H
@@ -21,21 +21,44 @@
 #include "config.h"
 
 #include <QObject>
+#include <QThread>
 #include <QThreadPool>
-
+#include <QIODevice>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QByteArray>
+#include <QString>
+#include <QStandardPaths>
+
+#include "core/closure.h"
+#include "core/logging.h"
 #include "core/song.h"
+#include "core/tagreaderclient.h"
 #include "albumcoverexporter.h"
 #include "coverexportrunnable.h"
 
-const int AlbumCoverExporter::kMaxConcurrentRequests = 3;
+const int AlbumCoverExporter::kMaxEmbeddedArtRequests = 8;
+const char *AlbumCoverExporter::kJournalFilename = "coverexport.journal";
 
 AlbumCoverExporter::AlbumCoverExporter(QObject *parent)
     : QObject(parent),
       thread_pool_(new QThreadPool(this)),
+      running_(0),
+      embedded_art_requests_(0),
       exported_(0),
       skipped_(0),
       all_(0) {
-  thread_pool_->setMaxThreadCount(kMaxConcurrentRequests);
+  thread_pool_->setMaxThreadCount(QThread::idealThreadCount());
+}
+
+AlbumCoverExporter::~AlbumCoverExporter() {
+
+  // The running jobs use the cache.
+  requests_.clear();
+  thread_pool_->waitForDone();
+
 }
 
 void AlbumCoverExporter::SetDialogResult(const AlbumCoverExport::DialogResult& dialog_result) {
@@ -43,40 +66,177 @@ void AlbumCoverExporter::SetDialogResult(const AlbumCoverExport::DialogResult& d
 }
 
 void AlbumCoverExporter::AddExportRequest(Song song) {
-  requests_.append(new CoverExportRunnable(dialog_result_, song));
+  requests_.append(song);
   all_ = requests_.count();
 }
 
-void AlbumCoverExporter::Cancel() { requests_.clear(); }
+void AlbumCoverExporter::Cancel() {
+
+  // The journal is kept, so the export can be resumed later.
+  requests_.clear();
+  if (running_ == 0 && embedded_art_requests_ == 0) journal_.close();
+
+}
 
 void AlbumCoverExporter::StartExporting() {
+
   exported_ = 0;
   skipped_ = 0;
+  cache_.Clear();
+
+  OpenJournal();
+
+  if (requests_.isEmpty()) {
+    // An earlier export with the same settings did all of them already.
+    RemoveJournal();
+    emit AlbumCoversExportUpdate(0, 0, 0);
+    return;
+  }
+
   AddJobsToPool();
+
 }
 
 void AlbumCoverExporter::AddJobsToPool() {
 
-  while (!requests_.isEmpty() && thread_pool_->activeThreadCount() < thread_pool_->maxThreadCount()) {
-    CoverExportRunnable *runnable = requests_.dequeue();
+  // Queue a few jobs more than there are threads so the pool never waits for the next job.
+  while (!requests_.isEmpty() && running_ < thread_pool_->maxThreadCount() * 2) {
+    const Song song = requests_.dequeue();
+
+    if (CoverExportRunnable::GetCoverPath(dialog_result_, song) == Song::kEmbeddedCover) {
+      // Embedded art is read by the tagreader workers, the runnable is started once the data arrived.
+      if (embedded_art_requests_ >= kMaxEmbeddedArtRequests) {
+        requests_.prepend(song);
+        break;
+      }
+      TagReaderReply *reply = TagReaderClient::Instance()->LoadEmbeddedArt(song.url().toLocalFile());
+      NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(EmbeddedArtLoaded(TagReaderReply*, Song)), reply, song);
+      ++embedded_art_requests_;
+      ++running_;
+    }
+    else {
+      ++running_;
+      StartRunnable(song, QByteArray());
+    }
+  }
 
-    connect(runnable, SIGNAL(CoverExported()), SLOT(CoverExported()));
-    connect(runnable, SIGNAL(CoverSkipped()), SLOT(CoverSkipped()));
+}
 
-    thread_pool_->start(runnable);
-  }
+void AlbumCoverExporter::EmbeddedArtLoaded(TagReaderReply *reply, const Song &song) {
+
+  --embedded_art_requests_;
+
+  const std::string &data_str = reply->message().load_embedded_art_response().data();
+  StartRunnable(song, QByteArray(data_str.data(), data_str.size()));
+  reply->deleteLater();
 
 }
 
-void AlbumCoverExporter::CoverExported() {
+void AlbumCoverExporter::StartRunnable(const Song &song, const QByteArray &embedded_art) {
+
+  CoverExportRunnable *runnable = new CoverExportRunnable(dialog_result_, song, embedded_art, &cache_);
+
+  connect(runnable, SIGNAL(CoverExported(QString)), SLOT(CoverExported(QString)));
+  connect(runnable, SIGNAL(CoverSkipped(QString)), SLOT(CoverSkipped(QString)));
+
+  thread_pool_->start(runnable);
+
+}
+
+void AlbumCoverExporter::CoverExported(const QString &directory) {
   exported_++;
-  emit AlbumCoversExportUpdate(exported_, skipped_, all_);
-  AddJobsToPool();
+  CoverFinished(directory);
 }
 
-void AlbumCoverExporter::CoverSkipped() {
+void AlbumCoverExporter::CoverSkipped(const QString &directory) {
   skipped_++;
+  CoverFinished(directory);
+}
+
+void AlbumCoverExporter::CoverFinished(const QString &directory) {
+
+  --running_;
+
+  if (journal_.isOpen()) {
+    journal_.write(directory.toUtf8() + '\n');
+    journal_.flush();
+  }
+
   emit AlbumCoversExportUpdate(exported_, skipped_, all_);
-  AddJobsToPool();
+
+  if (exported_ + skipped_ >= all_) {
+    // Everything is done, nothing to resume.
+    RemoveJournal();
+  }
+  else if (requests_.isEmpty() && running_ == 0) {
+    journal_.close();
+  }
+  else {
+    AddJobsToPool();
+  }
+
+}
+
+QString AlbumCoverExporter::JournalPath() const {
+  return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/" + kJournalFilename;
+}
+
+QString AlbumCoverExporter::JournalHeader() const {
+
+  return QString("%1 %2 %3 %4 %5 %6")
+      .arg(dialog_result_.export_downloaded_)
+      .arg(dialog_result_.export_embedded_)
+      .arg(dialog_result_.overwrite_)
+      .arg(dialog_result_.IsSizeForced() ? QString("%1x%2").arg(dialog_result_.width_).arg(dialog_result_.height_) : QString("0x0"))
+      .arg(dialog_result_.fileName_.size())
+      .arg(dialog_result_.fileName_);
+
+}
+
+void AlbumCoverExporter::OpenJournal() {
+
+  if (journal_.isOpen()) journal_.close();
+
+  const QString header = JournalHeader();
+  journal_.setFileName(JournalPath());
+
+  // Skip the albums an interrupted export with the same settings already did.
+  QSet<QString> done;
+  if (journal_.open(QIODevice::ReadOnly)) {
+    if (QString::fromUtf8(journal_.readLine()).trimmed() == header) {
+      while (!journal_.atEnd()) {
+        done << QString::fromUtf8(journal_.readLine()).trimmed();
+      }
+    }
+    journal_.close();
+  }
+
+  if (!done.isEmpty()) {
+    QQueue<Song> requests;
+    for (const Song &song : requests_) {
+      if (!done.contains(song.url().toLocalFile().section('/', 0, -2))) requests << song;
+    }
+    qLog(Info) << "Resuming cover export," << requests_.count() - requests.count() << "albums already done";
+    requests_ = requests;
+    all_ = requests_.count();
+  }
+
+  QDir().mkpath(QFileInfo(JournalPath()).path());
+
+  if (done.isEmpty()) {
+    if (!journal_.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+    journal_.write(header.toUtf8() + '\n');
+  }
+  else {
+    if (!journal_.open(QIODevice::WriteOnly | QIODevice::Append)) return;
+  }
+  journal_.flush();
+
 }
 
+void AlbumCoverExporter::RemoveJournal() {
+
+  journal_.close();
+  QFile::remove(JournalPath());
+
+}
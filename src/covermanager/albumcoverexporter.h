@@ -26,21 +26,24 @@
 #include <QObject>
 #include <QThreadPool>
 #include <QQueue>
+#include <QSet>
+#include <QFile>
 #include <QString>
 
+#include "core/song.h"
+#include "core/tagreaderclient.h"
 #include "albumcoverexport.h"
-
-class Song;
-class CoverExportRunnable;
+#include "coverexportrunnable.h"
 
 class AlbumCoverExporter : public QObject {
   Q_OBJECT
 
  public:
   explicit AlbumCoverExporter(QObject *parent = nullptr);
-  virtual ~AlbumCoverExporter() {}
+  virtual ~AlbumCoverExporter();
 
-  static const int kMaxConcurrentRequests;
+  static const int kMaxEmbeddedArtRequests;
+  static const char *kJournalFilename;
 
   void SetDialogResult(const AlbumCoverExport::DialogResult &dialog_result);
   void AddExportRequest(Song song);
@@ -53,15 +56,30 @@ signals:
   void AlbumCoversExportUpdate(int exported, int skipped, int all);
 
  private slots:
-  void CoverExported();
-  void CoverSkipped();
+  void EmbeddedArtLoaded(TagReaderReply *reply, const Song &song);
+  void CoverExported(const QString &directory);
+  void CoverSkipped(const QString &directory);
 
  private:
   void AddJobsToPool();
+  void StartRunnable(const Song &song, const QByteArray &embedded_art);
+  void CoverFinished(const QString &directory);
+
+  // The journal lists the album directories that are done, so an interrupted export with the same settings continues where it stopped.
+  QString JournalPath() const;
+  QString JournalHeader() const;
+  void OpenJournal();
+  void RemoveJournal();
+
   AlbumCoverExport::DialogResult dialog_result_;
 
-  QQueue<CoverExportRunnable*> requests_;
+  QQueue<Song> requests_;
   QThreadPool *thread_pool_;
+  CoverExportCache cache_;
+  int running_;
+  int embedded_art_requests_;
+
+  QFile journal_;
 
   int exported_;
   int skipped_;
@@ -32,6 +32,8 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QFile>
+#include <QFuture>
+#include <QtConcurrentRun>
 #include <QMenu>
 #include <QSet>
 #include <QTimer>
@@ -52,6 +54,7 @@
 #include <QMessageBox>
 #include <QProgressBar>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QToolButton>
 #include <QKeySequence>
 #include <QtAlgorithms>
@@ -59,6 +62,7 @@
 #include <QSettings>
 
 #include "core/application.h"
+#include "core/closure.h"
 #include "core/iconloader.h"
 #include "core/utilities.h"
 #include "widgets/forcescrollperpixel.h"
@@ -76,6 +80,7 @@
 #include "albumcoverfetcher.h"
 #include "albumcoverloader.h"
 #include "albumcovermanagerlist.h"
+#include "albumcovermanagermodel.h"
 #include "coversearchstatistics.h"
 #include "coversearchstatisticsdialog.h"
 
@@ -85,12 +90,16 @@ using std::unique_ptr;
 using std::stable_sort;
 
 const char *AlbumCoverManager::kSettingsGroup = "CoverManager";
+const int AlbumCoverManager::kUpdateCoversDelayMsec = 100;
 
 AlbumCoverManager::AlbumCoverManager(Application *app, CollectionBackend *collection_backend, QWidget *parent, QNetworkAccessManager *network)
     : QMainWindow(parent),
       ui_(new Ui_CoverManager),
       app_(app),
       album_cover_choice_controller_(new AlbumCoverChoiceController(this)),
+      model_(nullptr),
+      albums_request_(0),
+      update_covers_timer_(new QTimer(this)),
       cover_fetcher_(new AlbumCoverFetcher(app_->cover_providers(), this, network)),
       cover_searcher_(nullptr),
       cover_export_(nullptr),
@@ -109,6 +118,14 @@ AlbumCoverManager::AlbumCoverManager(Application *app, CollectionBackend *collec
   ui_->setupUi(this);
   ui_->albums->set_cover_manager(this);
 
+  model_ = new AlbumCoverManagerModel(app_, no_cover_item_icon_, this);
+  ui_->albums->setModel(model_);
+
+  // Covers are loaded for the visible albums once scrolling stops.
+  update_covers_timer_->setSingleShot(true);
+  update_covers_timer_->setInterval(kUpdateCoversDelayMsec);
+  connect(update_covers_timer_, SIGNAL(timeout()), SLOT(UpdateCoverLoading()));
+
   // Icons
   ui_->action_fetch->setIcon(IconLoader::Load("download" ));
   ui_->export_covers->setIcon(IconLoader::Load("document-save" ));
@@ -203,6 +220,11 @@ void AlbumCoverManager::Init() {
   connect(ui_->albums, SIGNAL(doubleClicked(QModelIndex)), SLOT(AlbumDoubleClicked(QModelIndex)));
   connect(ui_->action_add_to_playlist, SIGNAL(triggered()), SLOT(AddSelectedToPlaylist()));
   connect(ui_->action_load, SIGNAL(triggered()), SLOT(LoadSelectedToPlaylist()));
+  connect(ui_->albums->verticalScrollBar(), SIGNAL(valueChanged(int)), update_covers_timer_, SLOT(start()));
+  connect(model_, SIGNAL(modelReset()), update_covers_timer_, SLOT(start()));
+  connect(model_, SIGNAL(rowsInserted(QModelIndex, int, int)), update_covers_timer_, SLOT(start()));
+  connect(model_, SIGNAL(rowsRemoved(QModelIndex, int, int)), update_covers_timer_, SLOT(start()));
+  connect(model_, SIGNAL(AlbumCoversChanged()), SLOT(UpdateCounts()));
 
   // Restore settings
   QSettings s;
@@ -214,8 +236,6 @@ void AlbumCoverManager::Init() {
     ui_->splitter->setSizes(QList<int>() << 200 << width() - 200);
   }
 
-  connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)), SLOT(CoverImageLoaded(quint64, QImage)));
-
   cover_searcher_->Init(cover_fetcher_);
 
   new ForceScrollPerPixel(ui_->albums, this);
@@ -251,8 +271,7 @@ void AlbumCoverManager::closeEvent(QCloseEvent *e) {
 
 void AlbumCoverManager::CancelRequests() {
 
-  app_->album_cover_loader()->CancelTasks(QSet<quint64>::fromList(cover_loading_tasks_.keys()));
-  cover_loading_tasks_.clear();
+  model_->CancelCoverLoading();
 
   cover_exporter_->Cancel();
 
@@ -308,15 +327,24 @@ void AlbumCoverManager::ArtistChanged(QListWidgetItem *current) {
   QString artist;
   if (current->type() == Specific_Artist) artist = current->text();
 
-  ui_->albums->clear();
+  model_->Clear();
   context_menu_items_.clear();
   CancelRequests();
 
-  // Get the list of albums.  How we do it depends on what thing we have selected in the artist list.
+  // Get the list of albums in the background, the view only gets them a page at a time.
+  const int request = ++albums_request_;
+  QFuture<CollectionBackend::AlbumList> future = QtConcurrent::run(this, &AlbumCoverManager::LoadAlbums, ArtistItemType(current->type()), artist);
+  NewClosure(future, this, SLOT(AlbumsLoaded(QFuture<CollectionBackend::AlbumList>, int, bool)), future, request, !artist.isEmpty());
+
+}
+
+CollectionBackend::AlbumList AlbumCoverManager::LoadAlbums(const ArtistItemType type, const QString &artist) {
+
+  // How we get the list depends on what thing we have selected in the artist list.
   CollectionBackend::AlbumList albums;
-  switch (current->type()) {
+  switch (type) {
     case Various_Artists: albums = collection_backend_->GetCompilationAlbums(); break;
-    case Specific_Artist: albums = collection_backend_->GetAlbumsByArtist(current->text()); break;
+    case Specific_Artist: albums = collection_backend_->GetAlbumsByArtist(artist); break;
     case All_Artists:
     default:              albums = collection_backend_->GetAllAlbums(); break;
   }
@@ -324,48 +352,16 @@ void AlbumCoverManager::ArtistChanged(QListWidgetItem *current) {
   // Sort by album name.  The list is already sorted by sqlite but it was done case sensitively.
   std::stable_sort(albums.begin(), albums.end(), CompareAlbumNameNocase);
 
-  for (const CollectionBackend::Album &info : albums) {
-    // Don't show songs without an album, obviously
-    if (info.album_name.isEmpty()) continue;
-
-    QListWidgetItem *item = new QListWidgetItem(no_cover_item_icon_, info.album_name, ui_->albums);
-    item->setData(Role_ArtistName, info.artist);
-    item->setData(Role_AlbumArtistName, info.album_artist);
-    item->setData(Role_AlbumName, info.album_name);
-    item->setData(Role_FirstUrl, info.first_url);
-    item->setData(Qt::TextAlignmentRole, QVariant(Qt::AlignTop | Qt::AlignHCenter));
-    item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled);
-    item->setToolTip(info.artist + " - " + info.album_name);
-
-    QString effective_artist = EffectiveAlbumArtistName(*item);
-    if (!artist.isEmpty()) {
-      item->setToolTip(effective_artist + " - " + info.album_name);
-    }
-    else {
-      item->setToolTip(info.album_name);
-    }
-
-    if (!info.art_automatic.isEmpty() || !info.art_manual.isEmpty()) {
-      quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, info.art_automatic, info.art_manual, info.first_url.toLocalFile());
-      item->setData(Role_PathAutomatic, info.art_automatic);
-      item->setData(Role_PathManual, info.art_manual);
-      cover_loading_tasks_[id] = item;
-    }
-  }
-
-  UpdateFilter();
+  return albums;
 
 }
 
-void AlbumCoverManager::CoverImageLoaded(quint64 id, const QImage &image) {
-
-  if (!cover_loading_tasks_.contains(id)) return;
+void AlbumCoverManager::AlbumsLoaded(QFuture<CollectionBackend::AlbumList> future, const int request, const bool tooltip_with_artist) {
 
-  QListWidgetItem *item = cover_loading_tasks_.take(id);
+  // Another artist was selected in the meantime.
+  if (request != albums_request_) return;
 
-  if (image.isNull()) return;
-
-  item->setIcon(QPixmap::fromImage(image));
+  model_->SetAlbums(future.result(), tooltip_with_artist);
   UpdateFilter();
 
 }
@@ -376,72 +372,44 @@ void AlbumCoverManager::UpdateFilter() {
   const bool hide_with_covers = filter_without_covers_->isChecked();
   const bool hide_without_covers = filter_with_covers_->isChecked();
 
-  HideCovers hide = Hide_None;
+  AlbumCoverManagerModel::HideCovers hide = AlbumCoverManagerModel::Hide_None;
   if (hide_with_covers) {
-    hide = Hide_WithCovers;
+    hide = AlbumCoverManagerModel::Hide_WithCovers;
   }
   else if (hide_without_covers) {
-    hide = Hide_WithoutCovers;
+    hide = AlbumCoverManagerModel::Hide_WithoutCovers;
   }
 
-  qint32 total_count = 0;
-  qint32 without_cover = 0;
+  model_->SetFilter(filter, hide);
+  UpdateCounts();
 
-  for (int i = 0; i < ui_->albums->count(); ++i) {
-    QListWidgetItem *item = ui_->albums->item(i);
-    bool should_hide = ShouldHide(*item, filter, hide);
-    item->setHidden(should_hide);
+}
 
-    if (!should_hide) {
-      total_count++;
-      if (!ItemHasCover(*item)) {
-        without_cover++;
-      }
-    }
-  }
+void AlbumCoverManager::UpdateCounts() {
 
-  ui_->total_albums->setText(QString::number(total_count));
-  ui_->without_cover->setText(QString::number(without_cover));
+  ui_->total_albums->setText(QString::number(model_->filtered_albums().count()));
+  ui_->without_cover->setText(QString::number(model_->without_cover_count()));
 
 }
 
-bool AlbumCoverManager::ShouldHide(const QListWidgetItem &item, const QString &filter, HideCovers hide) const {
-
-  bool has_cover = ItemHasCover(item);
-  if (hide == Hide_WithCovers && has_cover) {
-    return true;
-  }
-  else if (hide == Hide_WithoutCovers && !has_cover) {
-    return true;
-  }
+void AlbumCoverManager::UpdateCoverLoading() {
 
-  if (filter.isEmpty()) {
-    return false;
-  }
+  int first = 0;
+  int last = 0;
+  if (!ui_->albums->VisibleRows(&first, &last)) return;
 
-  QStringList query = filter.split(' ');
-  for (const QString &s : query) {
-    bool in_text = item.text().contains(s, Qt::CaseInsensitive);
-    bool in_artist = item.data(Role_ArtistName).toString().contains(s, Qt::CaseInsensitive);
-    bool in_albumartist = item.data(Role_AlbumArtistName).toString().contains(s, Qt::CaseInsensitive);
-    if (!in_text && !in_artist && !in_albumartist) {
-      return true;
-    }
-  }
-
-  return false;
+  model_->UpdateLoadingRange(first, last);
 
 }
 
 void AlbumCoverManager::FetchAlbumCovers() {
 
-  for (int i = 0; i < ui_->albums->count(); ++i) {
-    QListWidgetItem *item = ui_->albums->item(i);
-    if (item->isHidden()) continue;
-    if (ItemHasCover(*item)) continue;
+  for (int album : model_->filtered_albums()) {
+    if (model_->AlbumHasCover(album)) continue;
 
-    quint64 id = cover_fetcher_->FetchAlbumCover(EffectiveAlbumArtistName(*item), item->data(Role_AlbumName).toString(), true);
-    cover_fetching_tasks_[id] = item;
+    const CollectionBackend::Album &info = model_->album(album);
+    quint64 id = cover_fetcher_->FetchAlbumCover(EffectiveAlbumArtistName(info), info.album_name, true);
+    cover_fetching_tasks_[id] = album;
     jobs_++;
   }
 
@@ -460,9 +428,9 @@ void AlbumCoverManager::AlbumCoverFetched(quint64 id, const QImage &image, const
   if (!cover_fetching_tasks_.contains(id))
     return;
 
-  QListWidgetItem *item = cover_fetching_tasks_.take(id);
+  const int album = cover_fetching_tasks_.take(id);
   if (!image.isNull()) {
-    SaveAndSetCover(item, image);
+    SaveAndSetCover(album, image);
   }
 
   if (cover_fetching_tasks_.isEmpty()) {
@@ -504,14 +472,21 @@ void AlbumCoverManager::UpdateStatusText() {
 
 bool AlbumCoverManager::eventFilter(QObject *obj, QEvent *event) {
 
+  if (obj == ui_->albums && event->type() == QEvent::Resize) {
+    update_covers_timer_->start();
+  }
+
   if (obj == ui_->albums && event->type() == QEvent::ContextMenu) {
-    context_menu_items_ = ui_->albums->selectedItems();
+    context_menu_items_.clear();
+    for (const QModelIndex &index : ui_->albums->selectionModel()->selectedIndexes()) {
+      context_menu_items_ << model_->AlbumId(index);
+    }
     if (context_menu_items_.isEmpty()) return false;
 
     bool some_with_covers = false;
 
-    for (QListWidgetItem *item : context_menu_items_) {
-      if (ItemHasCover(*item)) some_with_covers = true;
+    for (int album : context_menu_items_) {
+      if (model_->AlbumHasCover(album)) some_with_covers = true;
     }
 
     album_cover_choice_controller_->cover_from_file_action()->setEnabled(context_menu_items_.size() == 1);
@@ -528,19 +503,21 @@ bool AlbumCoverManager::eventFilter(QObject *obj, QEvent *event) {
 }
 
 Song AlbumCoverManager::GetSingleSelectionAsSong() {
-  return context_menu_items_.size() != 1 ? Song() : ItemAsSong(context_menu_items_[0]);
+  return context_menu_items_.size() != 1 ? Song() : AlbumAsSong(context_menu_items_[0]);
 }
 
 Song AlbumCoverManager::GetFirstSelectedAsSong() {
-  return context_menu_items_.isEmpty() ? Song() : ItemAsSong(context_menu_items_[0]);
+  return context_menu_items_.isEmpty() ? Song() : AlbumAsSong(context_menu_items_[0]);
 }
 
-Song AlbumCoverManager::ItemAsSong(QListWidgetItem *item) {
+Song AlbumCoverManager::AlbumAsSong(const int album) {
 
   Song result;
 
-  QString title = item->data(Role_AlbumName).toString();
-  QString artist_name = EffectiveAlbumArtistName(*item);
+  const CollectionBackend::Album &info = model_->album(album);
+
+  QString title = info.album_name;
+  QString artist_name = EffectiveAlbumArtistName(info);
   if (!artist_name.isEmpty()) {
     result.set_title(artist_name + " - " + title);
   }
@@ -548,14 +525,14 @@ Song AlbumCoverManager::ItemAsSong(QListWidgetItem *item) {
     result.set_title(title);
   }
 
-  result.set_artist(item->data(Role_ArtistName).toString());
-  result.set_albumartist(item->data(Role_AlbumArtistName).toString());
-  result.set_album(item->data(Role_AlbumName).toString());
+  result.set_artist(info.artist);
+  result.set_albumartist(info.album_artist);
+  result.set_album(info.album_name);
 
-  result.set_url(item->data(Role_FirstUrl).toUrl());
+  result.set_url(info.first_url);
 
-  result.set_art_automatic(item->data(Role_PathAutomatic).toString());
-  result.set_art_manual(item->data(Role_PathManual).toString());
+  result.set_art_automatic(info.art_automatic);
+  result.set_art_manual(info.art_manual);
 
   // force validity
   result.set_valid(true);
@@ -574,9 +551,10 @@ void AlbumCoverManager::ShowCover() {
 
 void AlbumCoverManager::FetchSingleCover() {
 
-  for (QListWidgetItem *item : context_menu_items_) {
-    quint64 id = cover_fetcher_->FetchAlbumCover(EffectiveAlbumArtistName(*item), item->data(Role_AlbumName).toString(), false);
-    cover_fetching_tasks_[id] = item;
+  for (int album : context_menu_items_) {
+    const CollectionBackend::Album &info = model_->album(album);
+    quint64 id = cover_fetcher_->FetchAlbumCover(EffectiveAlbumArtistName(info), info.album_name, false);
+    cover_fetching_tasks_[id] = album;
     jobs_++;
   }
 
@@ -587,12 +565,8 @@ void AlbumCoverManager::FetchSingleCover() {
 
 }
 
-void AlbumCoverManager::UpdateCoverInList(QListWidgetItem *item, const QString &cover) {
-
-  quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, QString(), cover);
-  item->setData(Role_PathManual, cover);
-  cover_loading_tasks_[id] = item;
-
+void AlbumCoverManager::UpdateCoverInList(const int album, const QString &cover) {
+  model_->SetAlbumArtManual(album, cover);
 }
 
 void AlbumCoverManager::LoadCoverFromFile() {
@@ -600,12 +574,12 @@ void AlbumCoverManager::LoadCoverFromFile() {
   Song song = GetSingleSelectionAsSong();
   if (!song.is_valid()) return;
 
-  QListWidgetItem *item = context_menu_items_[0];
+  const int album = context_menu_items_[0];
 
   QString cover = album_cover_choice_controller_->LoadCoverFromFile(&song);
 
   if (!cover.isEmpty()) {
-    UpdateCoverInList(item, cover);
+    UpdateCoverInList(album, cover);
   }
 
 }
@@ -642,12 +616,12 @@ void AlbumCoverManager::LoadCoverFromURL() {
   Song song = GetSingleSelectionAsSong();
   if (!song.is_valid()) return;
 
-  QListWidgetItem *item = context_menu_items_[0];
+  const int album = context_menu_items_[0];
 
   QString cover = album_cover_choice_controller_->LoadCoverFromURL(&song);
 
   if (!cover.isEmpty()) {
-    UpdateCoverInList(item, cover);
+    UpdateCoverInList(album, cover);
   }
 
 }
@@ -657,16 +631,16 @@ void AlbumCoverManager::SearchForCover() {
   Song song = GetFirstSelectedAsSong();
   if (!song.is_valid()) return;
 
-  QListWidgetItem *item = context_menu_items_[0];
+  const int album = context_menu_items_[0];
 
   QString cover = album_cover_choice_controller_->SearchForCover(&song);
   if (cover.isEmpty()) return;
 
   // Force the found cover on all of the selected items
-  for (QListWidgetItem *current : context_menu_items_) {
+  for (int current : context_menu_items_) {
     // Don't save the first one twice
-    if (current != item) {
-      Song current_song = ItemAsSong(current);
+    if (current != album) {
+      Song current_song = AlbumAsSong(current);
       album_cover_choice_controller_->SaveCover(&current_song, cover);
     }
 
@@ -680,20 +654,19 @@ void AlbumCoverManager::UnsetCover() {
   Song song = GetFirstSelectedAsSong();
   if (!song.is_valid()) return;
 
-  QListWidgetItem *item = context_menu_items_[0];
+  const int album = context_menu_items_[0];
 
   QString cover = album_cover_choice_controller_->UnsetCover(&song);
 
   // Force the 'none' cover on all of the selected items
-  for (QListWidgetItem *current : context_menu_items_) {
-    current->setIcon(no_cover_item_icon_);
-    current->setData(Role_PathManual, cover);
-
+  for (int current : context_menu_items_) {
     // Don't save the first one twice
-    if (current != item) {
-      Song current_song = ItemAsSong(current);
+    if (current != album) {
+      Song current_song = AlbumAsSong(current);
       album_cover_choice_controller_->SaveCover(&current_song, cover);
     }
+
+    model_->SetAlbumArtManual(current, cover);
   }
 
 }
@@ -704,11 +677,11 @@ SongList AlbumCoverManager::GetSongsInAlbum(const QModelIndex &index) const {
 
   CollectionQuery q;
   q.SetColumnSpec("ROWID," + Song::kColumnSpec);
-  q.AddWhere("album", index.data(Role_AlbumName).toString());
+  q.AddWhere("album", index.data(AlbumCoverManagerModel::Role_AlbumName).toString());
   q.SetOrderBy("disc, track, title");
 
-  QString artist = index.data(Role_ArtistName).toString();
-  QString albumartist = index.data(Role_AlbumArtistName).toString();
+  QString artist = index.data(AlbumCoverManagerModel::Role_ArtistName).toString();
+  QString albumartist = index.data(AlbumCoverManagerModel::Role_AlbumArtistName).toString();
 
   if (!albumartist.isEmpty()) {
     q.AddWhere("albumartist", albumartist);
@@ -776,23 +749,22 @@ void AlbumCoverManager::LoadSelectedToPlaylist() {
 
 }
 
-void AlbumCoverManager::SaveAndSetCover(QListWidgetItem *item, const QImage &image) {
+void AlbumCoverManager::SaveAndSetCover(const int album, const QImage &image) {
 
-  const QString artist = item->data(Role_ArtistName).toString();
-  const QString albumartist = item->data(Role_AlbumArtistName).toString();
-  const QString album = item->data(Role_AlbumName).toString();
-  const QUrl url = item->data(Role_FirstUrl).toUrl();
+  const CollectionBackend::Album &info = model_->album(album);
+  const QString artist = info.artist;
+  const QString albumartist = info.album_artist;
+  const QString album_name = info.album_name;
+  const QUrl url = info.first_url;
 
-  QString path = album_cover_choice_controller_->SaveCoverToFileAutomatic((!albumartist.isEmpty() ? albumartist : artist), artist, album, url.adjusted(QUrl::RemoveFilename).path(), image);
+  QString path = album_cover_choice_controller_->SaveCoverToFileAutomatic((!albumartist.isEmpty() ? albumartist : artist), artist, album_name, url.adjusted(QUrl::RemoveFilename).path(), image);
   if (path.isEmpty()) return;
 
   // Save the image in the database
-  collection_backend_->UpdateManualAlbumArtAsync(artist, albumartist, album, path);
+  collection_backend_->UpdateManualAlbumArtAsync(artist, albumartist, album_name, path);
 
   // Update the icon in our list
-  quint64 id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, QString(), path);
-  item->setData(Role_PathManual, path);
-  cover_loading_tasks_[id] = item;
+  model_->SetAlbumArtManual(album, path);
 
 }
 
@@ -808,15 +780,13 @@ void AlbumCoverManager::ExportCovers() {
 
   cover_exporter_->SetDialogResult(result);
 
-  for (int i = 0; i < ui_->albums->count(); ++i) {
-    QListWidgetItem *item = ui_->albums->item(i);
-
-    // skip hidden and coverless albums
-    if (item->isHidden() || !ItemHasCover(*item)) {
+  for (int album : model_->filtered_albums()) {
+    // skip coverless albums
+    if (!model_->AlbumHasCover(album)) {
       continue;
     }
 
-    cover_exporter_->AddExportRequest(ItemAsSong(item));
+    cover_exporter_->AddExportRequest(AlbumAsSong(album));
   }
 
   if (cover_exporter_->request_count() > 0) {
@@ -837,6 +807,8 @@ void AlbumCoverManager::ExportCovers() {
 
 void AlbumCoverManager::UpdateExportStatus(int exported, int skipped, int max) {
 
+  // The count is lower than the number of requests when a previous export is resumed.
+  progress_bar_->setMaximum(max);
   progress_bar_->setValue(exported);
 
   QString message = tr("Exported %1 covers out of %2 (%3 skipped)")
@@ -861,12 +833,11 @@ void AlbumCoverManager::UpdateExportStatus(int exported, int skipped, int max) {
 
 }
 
-QString AlbumCoverManager::EffectiveAlbumArtistName(const QListWidgetItem &item) const {
-  QString albumartist = item.data(Role_AlbumArtistName).toString();
-  if (!albumartist.isEmpty()) {
-    return albumartist;
+QString AlbumCoverManager::EffectiveAlbumArtistName(const CollectionBackend::Album &album) const {
+  if (!album.album_artist.isEmpty()) {
+    return album.album_artist;
   }
-  return item.data(Role_ArtistName).toString();
+  return album.artist;
 }
 
 QImage AlbumCoverManager::GenerateNoCoverImage(const QIcon &no_cover_icon) const {
@@ -885,8 +856,3 @@ QImage AlbumCoverManager::GenerateNoCoverImage(const QIcon &no_cover_icon) const
   return square_nocover;
 
 }
-
-bool AlbumCoverManager::ItemHasCover(const QListWidgetItem &item) const {
-  return item.icon().cacheKey() != no_cover_item_icon_.cacheKey();
-}
-
@@ -31,9 +31,11 @@
 #include <QMainWindow>
 #include <QAbstractItemModel>
 #include <QNetworkAccessManager>
+#include <QFuture>
 #include <QList>
 #include <QListWidgetItem>
 #include <QMap>
+#include <QTimer>
 #include <QString>
 #include <QImage>
 #include <QIcon>
@@ -45,16 +47,16 @@
 #include <QtEvents>
 
 #include "core/song.h"
-#include "albumcoverloaderoptions.h"
+#include "collection/collectionbackend.h"
 #include "coversearchstatistics.h"
 
 class Application;
-class CollectionBackend;
 class SongMimeData;
 class AlbumCoverChoiceController;
 class AlbumCoverExport;
 class AlbumCoverExporter;
 class AlbumCoverFetcher;
+class AlbumCoverManagerModel;
 class AlbumCoverSearcher;
 
 class Ui_CoverManager;
@@ -66,6 +68,7 @@ class AlbumCoverManager : public QMainWindow {
   ~AlbumCoverManager();
 
   static const char *kSettingsGroup;
+  static const int kUpdateCoversDelayMsec;
 
   CollectionBackend *backend() const;
   QIcon no_cover_icon() const { return no_cover_icon_; }
@@ -93,8 +96,10 @@ class AlbumCoverManager : public QMainWindow {
 
  private slots:
   void ArtistChanged(QListWidgetItem *current);
-  void CoverImageLoaded(quint64 id, const QImage &image);
+  void AlbumsLoaded(QFuture<CollectionBackend::AlbumList> future, const int request, const bool tooltip_with_artist);
   void UpdateFilter();
+  void UpdateCounts();
+  void UpdateCoverLoading();
   void FetchAlbumCovers();
   void ExportCovers();
   void AlbumCoverFetched(quint64 id, const QImage &image, const CoverSearchStatistics &statistics);
@@ -115,7 +120,7 @@ class AlbumCoverManager : public QMainWindow {
   void AddSelectedToPlaylist();
   void LoadSelectedToPlaylist();
 
-  void UpdateCoverInList(QListWidgetItem *item, const QString &cover);
+  void UpdateCoverInList(const int album, const QString &cover);
   void UpdateExportStatus(int exported, int bad, int count);
 
  private:
@@ -125,34 +130,20 @@ class AlbumCoverManager : public QMainWindow {
     Specific_Artist
   };
 
-  enum Role {
-    Role_ArtistName = Qt::UserRole + 1,
-    Role_AlbumArtistName,
-    Role_AlbumName,
-    Role_PathAutomatic,
-    Role_PathManual,
-    Role_FirstUrl
-  };
-
-  enum HideCovers {
-    Hide_None,
-    Hide_WithCovers,
-    Hide_WithoutCovers
-  };
-
   QString InitialPathForOpenCoverDialog(const QString &path_automatic, const QString &first_file_name) const;
-  QString EffectiveAlbumArtistName(const QListWidgetItem &item) const;
+  QString EffectiveAlbumArtistName(const CollectionBackend::Album &album) const;
+
+  CollectionBackend::AlbumList LoadAlbums(const ArtistItemType type, const QString &artist);
 
   // Returns the selected element in form of a Song ready to be used by AlbumCoverChoiceController or invalid song if there's nothing or multiple elements selected.
   Song GetSingleSelectionAsSong();
   // Returns the first of the selected elements in form of a Song ready to be used by AlbumCoverChoiceController or invalid song if there's nothing selected.
   Song GetFirstSelectedAsSong();
 
-  Song ItemAsSong(QListWidgetItem *item);
+  Song AlbumAsSong(const int album);
 
   void UpdateStatusText();
-  bool ShouldHide(const QListWidgetItem &item, const QString &filter, HideCovers hide) const;
-  void SaveAndSetCover(QListWidgetItem *item, const QImage &image);
+  void SaveAndSetCover(const int album, const QImage &image);
 
  private:
   Ui_CoverManager *ui_;
@@ -164,11 +155,13 @@ class AlbumCoverManager : public QMainWindow {
   QAction *filter_with_covers_;
   QAction *filter_without_covers_;
 
-  AlbumCoverLoaderOptions cover_loader_options_;
-  QMap<quint64, QListWidgetItem*> cover_loading_tasks_;
+  AlbumCoverManagerModel *model_;
+  // Requests for the album list, so a list for an artist that's no longer selected is ignored.
+  int albums_request_;
+  QTimer *update_covers_timer_;
 
   AlbumCoverFetcher *cover_fetcher_;
-  QMap<quint64, QListWidgetItem*> cover_fetching_tasks_;
+  QMap<quint64, int> cover_fetching_tasks_;
   CoverSearchStatistics fetch_statistics_;
 
   AlbumCoverSearcher *cover_searcher_;
@@ -176,7 +169,6 @@ class AlbumCoverManager : public QMainWindow {
   AlbumCoverExporter *cover_exporter_;
 
   QImage GenerateNoCoverImage(const QIcon &no_cover_icon) const;
-  bool ItemHasCover(const QListWidgetItem &item) const;
 
   QIcon artist_icon_;
   QIcon all_artists_icon_;
@@ -185,7 +177,7 @@ class AlbumCoverManager : public QMainWindow {
   const QIcon no_cover_item_icon_;
 
   QMenu *context_menu_;
-  QList<QListWidgetItem*> context_menu_items_;
+  QList<int> context_menu_items_;
 
   QProgressBar *progress_bar_;
   QPushButton *abort_progress_;
@@ -20,14 +20,13 @@
 
 #include "config.h"
 
-#include <memory>
-
 #include <QWidget>
 #include <QList>
 #include <QListView>
-#include <QListWidget>
-#include <QListWidgetItem>
-#include <QMimeData>
+#include <QAbstractItemModel>
+#include <QDrag>
+#include <QPixmap>
+#include <QRect>
 #include <QUrl>
 #include <QDropEvent>
 
@@ -37,42 +36,66 @@
 #include "albumcovermanager.h"
 #include "albumcovermanagerlist.h"
 
-AlbumCoverManagerList::AlbumCoverManagerList(QWidget *parent) : QListWidget(parent), manager_(nullptr) {}
+AlbumCoverManagerList::AlbumCoverManagerList(QWidget *parent) : QListView(parent), manager_(nullptr) {}
+
+bool AlbumCoverManagerList::VisibleRows(int *first, int *last) const {
+
+  if (!model() || model()->rowCount() == 0) return false;
 
-QMimeData *AlbumCoverManagerList::mimeData(const QList<QListWidgetItem*> items) const {
+  const QRect rect = viewport()->rect();
+  const int count = model()->rowCount();
 
-  // Get songs
-  SongList songs;
-  for (QListWidgetItem *item : items) {
-    songs << manager_->GetSongsInAlbum(indexFromItem(item));
+  // The items are laid out left to right and wrapped, so the rows are in order from top to bottom and can be searched with a binary search.
+  int low = 0;
+  int high = count;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (visualRect(model()->index(middle, 0)).bottom() < rect.top()) low = middle + 1;
+    else high = middle;
   }
+  *first = low;
+
+  high = count;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (visualRect(model()->index(middle, 0)).top() <= rect.bottom()) low = middle + 1;
+    else high = middle;
+  }
+  *last = low - 1;
+
+  return *first <= *last;
 
-  if (songs.isEmpty()) return nullptr;
+}
+
+void AlbumCoverManagerList::startDrag(Qt::DropActions supported_actions) {
+
+  const QModelIndexList indexes = selectedIndexes();
+  SongMimeData *mime_data = manager_->GetMimeDataForAlbums(indexes);
+  if (!mime_data) return;
 
   // Get URLs from the songs
   QList<QUrl> urls;
-  for (const Song &song : songs) {
+  for (const Song &song : mime_data->songs) {
     urls << song.url();
   }
+  mime_data->setUrls(urls);
 
-  // Get the QAbstractItemModel data so the picture works
-  std::unique_ptr<QMimeData> orig_data(QListWidget::mimeData(items));
+  QDrag *drag = new QDrag(this);
+  drag->setMimeData(mime_data);
+  if (indexes.count() == 1) {
+    drag->setPixmap(indexes.first().data(Qt::DecorationRole).value<QPixmap>());
+  }
+  drag->exec(supported_actions, Qt::CopyAction);
 
-  SongMimeData *mime_data = new SongMimeData;
-  mime_data->backend = manager_->backend();
-  mime_data->songs = songs;
-  mime_data->setUrls(urls);
-  mime_data->setData(orig_data->formats()[0], orig_data->data(orig_data->formats()[0]));
-  return mime_data;
 }
 
 void AlbumCoverManagerList::dropEvent(QDropEvent *e) {
 
   // Set movement to Static just for this dropEvent so the user can't move the album covers.
   // If it's set to Static all the time then the user can't even drag to the playlist
-  QListWidget::Movement old_movement = movement();
-  setMovement(QListWidget::Static);
-  QListWidget::dropEvent(e);
+  QListView::Movement old_movement = movement();
+  setMovement(QListView::Static);
+  QListView::dropEvent(e);
   setMovement(old_movement);
 
 }
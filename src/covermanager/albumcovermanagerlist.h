@@ -25,24 +25,23 @@
 
 #include <QObject>
 #include <QWidget>
-#include <QList>
-#include <QListWidget>
-#include <QListWidgetItem>
-#include <QString>
-#include <QMimeData>
+#include <QListView>
 #include <QDropEvent>
 
 class AlbumCoverManager;
 
-class AlbumCoverManagerList : public QListWidget {
+class AlbumCoverManagerList : public QListView {
   Q_OBJECT
  public:
   AlbumCoverManagerList(QWidget *parent = nullptr);
 
   void set_cover_manager(AlbumCoverManager *manager) { manager_ = manager; }
 
+  // Finds the first and last row that are at least partly visible, returns false if no rows are visible.
+  bool VisibleRows(int *first, int *last) const;
+
 protected:
-  QMimeData *mimeData(const QList<QListWidgetItem*> items) const;
+  void startDrag(Qt::DropActions supported_actions);
   void dropEvent(QDropEvent *event);
 
 private:
@@ -0,0 +1,400 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QAbstractListModel>
+#include <QVariant>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QImage>
+#include <QIcon>
+#include <QPixmap>
+
+#include "core/application.h"
+#include "core/song.h"
+#include "collection/collectionbackend.h"
+#include "albumcoverloader.h"
+#include "albumcovermanagermodel.h"
+
+const int AlbumCoverManagerModel::kPageSize = 500;
+const int AlbumCoverManagerModel::kPrefetchRows = 40;
+const int AlbumCoverManagerModel::kMaxCachedCovers = 500;
+
+AlbumCoverManagerModel::AlbumCoverManagerModel(Application *app, const QIcon &no_cover_icon, QObject *parent)
+    : QAbstractListModel(parent),
+      app_(app),
+      no_cover_icon_(no_cover_icon),
+      tooltip_with_artist_(false),
+      hide_(Hide_None),
+      fetched_count_(0),
+      covers_(kMaxCachedCovers),
+      first_loading_row_(0),
+      last_loading_row_(-1) {
+
+  connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)), SLOT(CoverImageLoaded(quint64, QImage)));
+
+}
+
+AlbumCoverManagerModel::~AlbumCoverManagerModel() {
+  CancelCoverLoading();
+}
+
+int AlbumCoverManagerModel::rowCount(const QModelIndex &parent) const {
+
+  if (parent.isValid()) return 0;
+  return fetched_count_;
+
+}
+
+QVariant AlbumCoverManagerModel::data(const QModelIndex &index, int role) const {
+
+  if (!index.isValid() || index.row() >= fetched_count_) return QVariant();
+
+  const int id = filtered_[index.row()];
+  const CollectionBackend::Album &info = albums_[id].album;
+
+  switch (role) {
+    case Qt::DisplayRole:
+    case Role_AlbumName:
+      return info.album_name;
+
+    case Qt::DecorationRole: {
+      // Covers are only loaded by UpdateLoadingRange, painting never queues a load.
+      QPixmap *pixmap = covers_.object(id);
+      if (pixmap) return *pixmap;
+      return no_cover_icon_;
+    }
+
+    case Qt::ToolTipRole:
+      if (tooltip_with_artist_) return EffectiveAlbumArtistName(info) + " - " + info.album_name;
+      return info.album_name;
+
+    case Qt::TextAlignmentRole:
+      return QVariant(Qt::AlignTop | Qt::AlignHCenter);
+
+    case Role_ArtistName:
+      return info.artist;
+
+    case Role_AlbumArtistName:
+      return info.album_artist;
+
+    case Role_PathAutomatic:
+      return info.art_automatic;
+
+    case Role_PathManual:
+      return info.art_manual;
+
+    case Role_FirstUrl:
+      return info.first_url;
+
+    default:
+      return QVariant();
+  }
+
+}
+
+Qt::ItemFlags AlbumCoverManagerModel::flags(const QModelIndex &index) const {
+
+  if (!index.isValid()) return Qt::NoItemFlags;
+  return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+
+}
+
+bool AlbumCoverManagerModel::canFetchMore(const QModelIndex &parent) const {
+
+  if (parent.isValid()) return false;
+  return fetched_count_ < filtered_.count();
+
+}
+
+void AlbumCoverManagerModel::fetchMore(const QModelIndex &parent) {
+
+  if (parent.isValid()) return;
+
+  const int count = qMin(kPageSize, filtered_.count() - fetched_count_);
+  if (count <= 0) return;
+
+  beginInsertRows(QModelIndex(), fetched_count_, fetched_count_ + count - 1);
+  fetched_count_ += count;
+  endInsertRows();
+
+}
+
+void AlbumCoverManagerModel::SetAlbums(const CollectionBackend::AlbumList &albums, const bool tooltip_with_artist) {
+
+  beginResetModel();
+
+  CancelCoverLoading();
+  covers_.clear();
+
+  albums_.clear();
+  albums_.reserve(albums.count());
+  for (const CollectionBackend::Album &info : albums) {
+    // Don't show songs without an album, obviously
+    if (info.album_name.isEmpty()) continue;
+    albums_ << Item(info);
+  }
+  tooltip_with_artist_ = tooltip_with_artist;
+
+  filtered_.clear();
+  for (int id = 0 ; id < albums_.count() ; ++id) {
+    if (Matches(id)) filtered_ << id;
+  }
+  fetched_count_ = qMin(kPageSize, filtered_.count());
+
+  endResetModel();
+
+}
+
+void AlbumCoverManagerModel::Clear() {
+  SetAlbums(CollectionBackend::AlbumList(), false);
+}
+
+void AlbumCoverManagerModel::SetFilter(const QString &filter, const HideCovers hide) {
+
+  if (filter == filter_ && hide == hide_) return;
+
+  beginResetModel();
+
+  filter_ = filter;
+  hide_ = hide;
+
+  filtered_.clear();
+  for (int id = 0 ; id < albums_.count() ; ++id) {
+    if (Matches(id)) filtered_ << id;
+  }
+  fetched_count_ = qMin(kPageSize, filtered_.count());
+
+  endResetModel();
+
+}
+
+int AlbumCoverManagerModel::AlbumId(const QModelIndex &index) const {
+
+  if (!index.isValid() || index.row() >= fetched_count_) return -1;
+  return filtered_[index.row()];
+
+}
+
+bool AlbumCoverManagerModel::AlbumHasCover(const int id) const {
+
+  const Item &item = albums_[id];
+  if (item.cover_missing || item.album.art_manual == Song::kManuallyUnsetCover) return false;
+  return !item.album.art_manual.isEmpty() || !item.album.art_automatic.isEmpty();
+
+}
+
+void AlbumCoverManagerModel::SetAlbumArtManual(const int id, const QString &art_manual) {
+
+  CancelCoverLoading(id);
+  covers_.remove(id);
+
+  albums_[id].album.art_manual = art_manual;
+  albums_[id].cover_missing = false;
+
+  const int row = RowForAlbum(id);
+  if (row != -1) {
+    if (row >= first_loading_row_ && row <= last_loading_row_) LoadCover(id);
+    emit dataChanged(index(row), index(row));
+  }
+
+  UpdateAlbumFilter(id);
+  emit AlbumCoversChanged();
+
+}
+
+int AlbumCoverManagerModel::without_cover_count() const {
+
+  int count = 0;
+  for (int id : filtered_) {
+    if (!AlbumHasCover(id)) ++count;
+  }
+  return count;
+
+}
+
+void AlbumCoverManagerModel::UpdateLoadingRange(const int first_row, const int last_row) {
+
+  first_loading_row_ = qMax(0, first_row - kPrefetchRows);
+  last_loading_row_ = qMin(fetched_count_ - 1, last_row + kPrefetchRows);
+
+  // Cancel the covers that were scrolled away before they were loaded.
+  QSet<quint64> cancelled;
+  QMap<quint64, int>::iterator it = cover_loading_tasks_.begin();
+  while (it != cover_loading_tasks_.end()) {
+    const int row = RowForAlbum(it.value());
+    if (row < first_loading_row_ || row > last_loading_row_) {
+      cancelled << it.key();
+      loading_albums_.remove(it.value());
+      it = cover_loading_tasks_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+  if (!cancelled.isEmpty()) app_->album_cover_loader()->CancelTasks(cancelled);
+
+  for (int row = first_loading_row_ ; row <= last_loading_row_ ; ++row) {
+    LoadCover(filtered_[row]);
+  }
+
+}
+
+void AlbumCoverManagerModel::CancelCoverLoading() {
+
+  app_->album_cover_loader()->CancelTasks(QSet<quint64>::fromList(cover_loading_tasks_.keys()));
+  cover_loading_tasks_.clear();
+  loading_albums_.clear();
+  first_loading_row_ = 0;
+  last_loading_row_ = -1;
+
+}
+
+void AlbumCoverManagerModel::CoverImageLoaded(const quint64 id, const QImage &image) {
+
+  if (!cover_loading_tasks_.contains(id)) return;
+
+  const int album_id = cover_loading_tasks_.take(id);
+  loading_albums_.remove(album_id);
+
+  if (image.isNull()) {
+    albums_[album_id].cover_missing = true;
+    UpdateAlbumFilter(album_id);
+    emit AlbumCoversChanged();
+    return;
+  }
+
+  covers_.insert(album_id, new QPixmap(QPixmap::fromImage(image)));
+
+  const int row = RowForAlbum(album_id);
+  if (row != -1) emit dataChanged(index(row), index(row), QVector<int>() << Qt::DecorationRole);
+
+}
+
+QString AlbumCoverManagerModel::EffectiveAlbumArtistName(const CollectionBackend::Album &album) {
+
+  if (!album.album_artist.isEmpty()) return album.album_artist;
+  return album.artist;
+
+}
+
+bool AlbumCoverManagerModel::Matches(const int id) const {
+
+  const bool has_cover = AlbumHasCover(id);
+  if (hide_ == Hide_WithCovers && has_cover) {
+    return false;
+  }
+  else if (hide_ == Hide_WithoutCovers && !has_cover) {
+    return false;
+  }
+
+  if (filter_.isEmpty()) {
+    return true;
+  }
+
+  const CollectionBackend::Album &info = albums_[id].album;
+  QStringList query = filter_.split(' ');
+  for (const QString &s : query) {
+    bool in_text = info.album_name.contains(s, Qt::CaseInsensitive);
+    bool in_artist = info.artist.contains(s, Qt::CaseInsensitive);
+    bool in_albumartist = info.album_artist.contains(s, Qt::CaseInsensitive);
+    if (!in_text && !in_artist && !in_albumartist) {
+      return false;
+    }
+  }
+
+  return true;
+
+}
+
+int AlbumCoverManagerModel::RowForAlbum(const int id) const {
+
+  // filtered_ is in the same order as the albums, so the row can be found with a binary search.
+  QVector<int>::const_iterator it = std::lower_bound(filtered_.begin(), filtered_.end(), id);
+  if (it == filtered_.end() || *it != id) return -1;
+
+  const int row = it - filtered_.begin();
+  return row < fetched_count_ ? row : -1;
+
+}
+
+void AlbumCoverManagerModel::UpdateAlbumFilter(const int id) {
+
+  QVector<int>::iterator it = std::lower_bound(filtered_.begin(), filtered_.end(), id);
+  const bool filtered = it != filtered_.end() && *it == id;
+  const int pos = it - filtered_.begin();
+
+  const bool matches = Matches(id);
+  if (matches == filtered) return;
+
+  if (matches) {
+    // Only add a row if the view has fetched the rows around it already.
+    if (pos < fetched_count_ || fetched_count_ == filtered_.count()) {
+      beginInsertRows(QModelIndex(), pos, pos);
+      filtered_.insert(pos, id);
+      ++fetched_count_;
+      endInsertRows();
+    }
+    else {
+      filtered_.insert(pos, id);
+    }
+  }
+  else {
+    if (pos < fetched_count_) {
+      beginRemoveRows(QModelIndex(), pos, pos);
+      filtered_.remove(pos);
+      --fetched_count_;
+      endRemoveRows();
+    }
+    else {
+      filtered_.remove(pos);
+    }
+  }
+
+}
+
+void AlbumCoverManagerModel::LoadCover(const int id) {
+
+  if (covers_.contains(id) || loading_albums_.contains(id) || !AlbumHasCover(id)) return;
+
+  const CollectionBackend::Album &info = albums_[id].album;
+  const quint64 task_id = app_->album_cover_loader()->LoadImageAsync(cover_loader_options_, info.art_automatic, info.art_manual, info.first_url.toLocalFile());
+  cover_loading_tasks_.insert(task_id, id);
+  loading_albums_.insert(id);
+
+}
+
+void AlbumCoverManagerModel::CancelCoverLoading(const int id) {
+
+  if (!loading_albums_.contains(id)) return;
+
+  const quint64 task_id = cover_loading_tasks_.key(id);
+  app_->album_cover_loader()->CancelTask(task_id);
+  cover_loading_tasks_.remove(task_id);
+  loading_albums_.remove(id);
+
+}
@@ -0,0 +1,141 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ALBUMCOVERMANAGERMODEL_H
+#define ALBUMCOVERMANAGERMODEL_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QAbstractListModel>
+#include <QVariant>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QCache>
+#include <QString>
+#include <QImage>
+#include <QIcon>
+#include <QPixmap>
+
+#include "collection/collectionbackend.h"
+#include "albumcoverloaderoptions.h"
+
+class Application;
+
+// The albums shown in the cover manager.
+// Rows are handed to the view a page at a time, and covers are only loaded for the rows the view reports as visible, plus some rows around them.
+class AlbumCoverManagerModel : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  AlbumCoverManagerModel(Application *app, const QIcon &no_cover_icon, QObject *parent = nullptr);
+  ~AlbumCoverManagerModel();
+
+  static const int kPageSize;
+  static const int kPrefetchRows;
+  static const int kMaxCachedCovers;
+
+  enum Role {
+    Role_ArtistName = Qt::UserRole + 1,
+    Role_AlbumArtistName,
+    Role_AlbumName,
+    Role_PathAutomatic,
+    Role_PathManual,
+    Role_FirstUrl
+  };
+
+  enum HideCovers {
+    Hide_None,
+    Hide_WithCovers,
+    Hide_WithoutCovers
+  };
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+  bool canFetchMore(const QModelIndex &parent) const;
+  void fetchMore(const QModelIndex &parent);
+
+  // Albums are identified by their position in the list given here, they stay the same when the filter changes.
+  void SetAlbums(const CollectionBackend::AlbumList &albums, const bool tooltip_with_artist);
+  void Clear();
+  void SetFilter(const QString &filter, const HideCovers hide);
+
+  int AlbumId(const QModelIndex &index) const;
+  const CollectionBackend::Album &album(const int id) const { return albums_[id].album; }
+  bool AlbumHasCover(const int id) const;
+  void SetAlbumArtManual(const int id, const QString &art_manual);
+
+  // All albums matching the filter, including the ones not fetched by the view yet.
+  const QVector<int> &filtered_albums() const { return filtered_; }
+  int without_cover_count() const;
+
+  // Loads the covers of the rows from first_row to last_row and the rows around them, and cancels loading the rest.
+  void UpdateLoadingRange(const int first_row, const int last_row);
+  void CancelCoverLoading();
+
+ signals:
+  void AlbumCoversChanged();
+
+ private slots:
+  void CoverImageLoaded(const quint64 id, const QImage &image);
+
+ private:
+  struct Item {
+    Item() : cover_missing(false) {}
+    explicit Item(const CollectionBackend::Album &_album) : album(_album), cover_missing(false) {}
+
+    CollectionBackend::Album album;
+    // Set when loading the cover failed.
+    bool cover_missing;
+  };
+
+  static QString EffectiveAlbumArtistName(const CollectionBackend::Album &album);
+
+  bool Matches(const int id) const;
+  int RowForAlbum(const int id) const;
+  void UpdateAlbumFilter(const int id);
+  void LoadCover(const int id);
+  void CancelCoverLoading(const int id);
+
+ private:
+  Application *app_;
+  const QIcon no_cover_icon_;
+  AlbumCoverLoaderOptions cover_loader_options_;
+
+  QVector<Item> albums_;
+  bool tooltip_with_artist_;
+
+  QString filter_;
+  HideCovers hide_;
+  QVector<int> filtered_;
+  int fetched_count_;
+
+  QCache<int, QPixmap> covers_;
+  QMap<quint64, int> cover_loading_tasks_;
+  QSet<int> loading_albums_;
+  int first_loading_row_;
+  int last_loading_row_;
+
+};
+
+#endif  // ALBUMCOVERMANAGERMODEL_H
@@ -20,50 +20,94 @@
 
 #include "config.h"
 
+#include <QMutex>
 #include <QFile>
+#include <QIODevice>
+#include <QBuffer>
+#include <QByteArray>
+#include <QCryptographicHash>
 #include <QSize>
 #include <QString>
 #include <QStringBuilder>
 #include <QUrl>
 #include <QImage>
+#include <QImageReader>
 
 #include "core/song.h"
-#include "core/tagreaderclient.h"
 #include "coverexportrunnable.h"
 
-CoverExportRunnable::CoverExportRunnable(const AlbumCoverExport::DialogResult &dialog_result, const Song &song) :
+const int CoverExportCache::kMaxCovers = 100;
+
+bool CoverExportCache::Find(const QByteArray &hash, QByteArray *data) {
+
+  QMutexLocker l(&mutex_);
+  if (!covers_.contains(hash)) return false;
+  *data = covers_[hash];
+  return true;
+
+}
+
+void CoverExportCache::Insert(const QByteArray &hash, const QByteArray &data) {
+
+  QMutexLocker l(&mutex_);
+  // Identical covers are normally next to each other in the album list, so a small cache is enough.
+  if (covers_.count() >= kMaxCovers) covers_.clear();
+  covers_.insert(hash, data);
+
+}
+
+void CoverExportCache::Clear() {
+
+  QMutexLocker l(&mutex_);
+  covers_.clear();
+
+}
+
+CoverExportRunnable::CoverExportRunnable(const AlbumCoverExport::DialogResult &dialog_result, const Song &song, const QByteArray &embedded_art, CoverExportCache *cache) :
     dialog_result_(dialog_result),
-    song_(song) {}
+    song_(song),
+    embedded_art_(embedded_art),
+    cache_(cache),
+    directory_(song.url().toLocalFile().section('/', 0, -2)) {}
 
 void CoverExportRunnable::run() {
 
-  QString cover_path = GetCoverPath();
+  QString cover_path = GetCoverPath(dialog_result_, song_);
 
   // Manually unset?
   if (cover_path.isEmpty()) {
     EmitCoverSkipped();
+    return;
   }
-  else {
-    if (dialog_result_.RequiresCoverProcessing())
-      ProcessAndExportCover();
-    else
-      ExportCover();
+
+  QString extension = cover_path.section('.', -1);
+  QString new_file = directory_ + '/' + dialog_result_.fileName_ + '.' + (cover_path == Song::kEmbeddedCover ? "jpg" : extension);
+
+  // If the file exists, do not override!
+  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode_None && QFile::exists(new_file)) {
+    EmitCoverSkipped();
+    return;
   }
 
+  if (dialog_result_.RequiresCoverProcessing())
+    ProcessAndExportCover(cover_path, new_file);
+  else
+    ExportCover(cover_path, new_file);
+
 }
 
-QString CoverExportRunnable::GetCoverPath() {
+QString CoverExportRunnable::GetCoverPath(const AlbumCoverExport::DialogResult &dialog_result, const Song &song) {
 
-  if (song_.has_manually_unset_cover()) {
+  if (song.has_manually_unset_cover()) {
     return QString();
     // Export downloaded covers?
   }
-  else if (!song_.art_manual().isEmpty() && dialog_result_.export_downloaded_) {
-    return song_.art_manual();
+  else if (!song.art_manual().isEmpty() && dialog_result.export_downloaded_) {
+    return song.art_manual();
     // Export embedded covers?
   }
-  else if (!song_.art_automatic().isEmpty() && song_.art_automatic() == Song::kEmbeddedCover && dialog_result_.export_embedded_) {
-    return song_.art_automatic();
+  else if (!song.art_automatic().isEmpty() && song.art_automatic() == Song::kEmbeddedCover && dialog_result.export_embedded_) {
+    return song.art_automatic();
   }
   else {
     return QString();
@@ -76,76 +120,71 @@ QString CoverExportRunnable::GetCoverPath() {
 // - either the force size flag is being used
 // - or the "overwrite smaller" mode is used
 // In all other cases, the faster ExportCover() method will be used.
-void CoverExportRunnable::ProcessAndExportCover() {
-
-  QString cover_path = GetCoverPath();
+void CoverExportRunnable::ProcessAndExportCover(const QString &cover_path, const QString &new_file) {
 
   // either embedded or disk - the one we'll export for the current album
-  QImage cover;
+  QByteArray source;
+  if (cover_path == Song::kEmbeddedCover) {
+    source = embedded_art_;
+  }
+  else {
+    QFile file(cover_path);
+    if (file.open(QIODevice::ReadOnly)) source = file.readAll();
+  }
 
-  QImage embedded_cover;
-  QImage disk_cover;
+  if (source.isEmpty()) {
+    EmitCoverSkipped();
+    return;
+  }
 
-  // load embedded cover if any
-  if (song_.has_embedded_cover()) {
-    embedded_cover = TagReaderClient::Instance()->LoadEmbeddedArtBlocking(song_.url().toLocalFile());
+  // The size is read from the image header, without decoding it.
+  QSize size;
+  if (dialog_result_.IsSizeForced()) {
+    size = QSize(dialog_result_.width_, dialog_result_.height_);
+  }
+  else {
+    QBuffer buffer(&source);
+    size = QImageReader(&buffer).size();
+  }
 
-    if (embedded_cover.isNull()) {
+  // if the mode is "overwrite smaller" then skip the cover if a bigger one is already available in the folder
+  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode_Smaller && QFile::exists(new_file)) {
+    const QSize existing = QImageReader(new_file).size();
+    if (!existing.isValid() || existing.height() >= size.height() || existing.width() >= size.width()) {
       EmitCoverSkipped();
       return;
     }
-    cover = embedded_cover;
   }
 
-  // load a file cover which iss mandatory if there's no embedded cover
-  disk_cover.load(cover_path);
+  // The scaling and the format only depend on the export settings, so the result for the same source image can be reused.
+  const QByteArray format = new_file.section('.', -1).toLatin1();
+  const QByteArray hash = QCryptographicHash::hash(source, QCryptographicHash::Sha1) + format;
 
-  if (embedded_cover.isNull()) {
-    if (disk_cover.isNull()) {
+  QByteArray data;
+  if (!cache_->Find(hash, &data)) {
+    QImage cover = QImage::fromData(source);
+    if (cover.isNull()) {
       EmitCoverSkipped();
       return;
     }
-    cover = disk_cover;
-  }
-
-  // rescale if necessary
-  if (dialog_result_.IsSizeForced()) {
-    cover = cover.scaled(QSize(dialog_result_.width_, dialog_result_.height_), Qt::IgnoreAspectRatio);
-  }
 
-  QString dir = song_.url().toLocalFile().section('/', 0, -2);
-  QString extension = cover_path.section('.', -1);
-
-  QString new_file = dir + '/' + dialog_result_.fileName_ + '.' + (cover_path == Song::kEmbeddedCover ? "jpg" : extension);
-
-  // If the file exists, do not override!
-  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode_None && QFile::exists(new_file)) {
-    EmitCoverSkipped();
-    return;
-  }
-
-  // we're handling overwrite as remove + copy so we need to delete the old file first
-  if (QFile::exists(new_file) && dialog_result_.overwrite_ != AlbumCoverExport::OverwriteMode_None) {
-
-    // if the mode is "overwrite smaller" then skip the cover if a bigger one is already available in the folder
-    if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode_Smaller) {
-      QImage existing;
-      existing.load(new_file);
-
-      if (existing.isNull() || existing.size().height() >= cover.size().height() || existing.size().width() >= cover.size().width()) {
-
-        EmitCoverSkipped();
-        return;
-      }
+    // rescale if necessary
+    if (dialog_result_.IsSizeForced()) {
+      cover = cover.scaled(size, Qt::IgnoreAspectRatio);
     }
 
-    if (!QFile::remove(new_file)) {
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!cover.save(&buffer, format.constData())) {
       EmitCoverSkipped();
       return;
     }
+    buffer.close();
+
+    cache_->Insert(hash, data);
   }
 
-  if (cover.save(new_file))
+  if (RemoveExisting(new_file) && WriteFile(new_file, data))
     EmitCoverExported();
   else
     EmitCoverSkipped();
@@ -153,36 +192,27 @@ void CoverExportRunnable::ProcessAndExportCover() {
 }
 
 // Exports a single album cover using a "copy file" approach.
-void CoverExportRunnable::ExportCover() {
-
-  QString cover_path = GetCoverPath();
-
-  QString dir = song_.url().toLocalFile().section('/', 0, -2);
-  QString extension = cover_path.section('.', -1);
-
-  QString new_file = dir + '/' + dialog_result_.fileName_ + '.' + (cover_path == Song::kEmbeddedCover ? "jpg" : extension);
+void CoverExportRunnable::ExportCover(const QString &cover_path, const QString &new_file) {
 
-  // If the file exists, do not override!
-  if (dialog_result_.overwrite_ == AlbumCoverExport::OverwriteMode_None && QFile::exists(new_file)) {
+  if (!RemoveExisting(new_file)) {
     EmitCoverSkipped();
     return;
   }
 
-  // we're handling overwrite as remove + copy so we need to delete the old file
-  // first
-  if (dialog_result_.overwrite_ != AlbumCoverExport::OverwriteMode_None && QFile::exists(new_file)) {
-    if (!QFile::remove(new_file)) {
-      EmitCoverSkipped();
-      return;
-    }
-  }
-
   if (cover_path == Song::kEmbeddedCover) {
-    // an embedded cover
-    QImage embedded = TagReaderClient::Instance()->LoadEmbeddedArtBlocking(song_.url().toLocalFile());
-    if (!embedded.save(new_file)) {
-      EmitCoverSkipped();
-      return;
+    // an embedded cover, JPEG data is written as it is, anything else is converted.
+    if (embedded_art_.startsWith("\xFF\xD8")) {
+      if (!WriteFile(new_file, embedded_art_)) {
+        EmitCoverSkipped();
+        return;
+      }
+    }
+    else {
+      QImage embedded = QImage::fromData(embedded_art_);
+      if (embedded.isNull() || !embedded.save(new_file)) {
+        EmitCoverSkipped();
+        return;
+      }
     }
   }
   else {
@@ -196,7 +226,27 @@ void CoverExportRunnable::ExportCover() {
 
 }
 
-void CoverExportRunnable::EmitCoverExported() { emit CoverExported(); }
+bool CoverExportRunnable::RemoveExisting(const QString &new_file) {
+
+  // we're handling overwrite as remove + copy so we need to delete the old file first
+  if (dialog_result_.overwrite_ != AlbumCoverExport::OverwriteMode_None && QFile::exists(new_file)) {
+    return QFile::remove(new_file);
+  }
+  return true;
+
+}
+
+bool CoverExportRunnable::WriteFile(const QString &new_file, const QByteArray &data) {
+
+  QFile file(new_file);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+  const bool success = file.write(data) == data.size();
+  file.close();
+
+  return success;
+
+}
 
-void CoverExportRunnable::EmitCoverSkipped() { emit CoverSkipped(); }
+void CoverExportRunnable::EmitCoverExported() { emit CoverExported(directory_); }
 
+void CoverExportRunnable::EmitCoverSkipped() { emit CoverSkipped(directory_); }
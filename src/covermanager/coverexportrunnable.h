@@ -25,6 +25,9 @@
 
 #include <QObject>
 #include <QRunnable>
+#include <QMutex>
+#include <QHash>
+#include <QByteArray>
 #include <QString>
 
 #include "core/song.h"
@@ -32,29 +35,51 @@
 
 class AlbumCoverExporter;
 
+// Covers processed during an export, by the hash of the source image.
+// Albums sharing the same image only decode, scale and encode it once.
+class CoverExportCache {
+ public:
+  static const int kMaxCovers;
+
+  bool Find(const QByteArray &hash, QByteArray *data);
+  void Insert(const QByteArray &hash, const QByteArray &data);
+  void Clear();
+
+ private:
+  QMutex mutex_;
+  QHash<QByteArray, QByteArray> covers_;
+};
+
 class CoverExportRunnable : public QObject, public QRunnable {
   Q_OBJECT
 
  public:
-  CoverExportRunnable(const AlbumCoverExport::DialogResult &dialog_result, const Song &song);
+  // embedded_art is the raw image data of the embedded cover, read by AlbumCoverExporter through the tagreader workers.
+  CoverExportRunnable(const AlbumCoverExport::DialogResult &dialog_result, const Song &song, const QByteArray &embedded_art, CoverExportCache *cache);
   virtual ~CoverExportRunnable() {}
 
+  static QString GetCoverPath(const AlbumCoverExport::DialogResult &dialog_result, const Song &song);
+
   void run();
 
 signals:
-  void CoverExported();
-  void CoverSkipped();
+  void CoverExported(const QString &directory);
+  void CoverSkipped(const QString &directory);
 
  private:
   void EmitCoverExported();
   void EmitCoverSkipped();
 
-  void ProcessAndExportCover();
-  void ExportCover();
-  QString GetCoverPath();
+  void ProcessAndExportCover(const QString &cover_path, const QString &new_file);
+  void ExportCover(const QString &cover_path, const QString &new_file);
+  bool RemoveExisting(const QString &new_file);
+  bool WriteFile(const QString &new_file, const QByteArray &data);
 
   AlbumCoverExport::DialogResult dialog_result_;
   Song song_;
+  QByteArray embedded_art_;
+  CoverExportCache *cache_;
+  QString directory_;
 
 };
 
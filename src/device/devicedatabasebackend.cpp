@@ -32,6 +32,7 @@
 
 #include "core/database.h"
 #include "core/scopedtransaction.h"
+#include "core/sqlitequery.h"
 #include "devicedatabasebackend.h"
 
 const int DeviceDatabaseBackend::kDeviceSchemaVersion = 0;
@@ -50,20 +51,20 @@ DeviceDatabaseBackend::DeviceList DeviceDatabaseBackend::GetAllDevices() {
 
   DeviceList ret;
 
-  QSqlQuery q(db);
-  q.prepare("SELECT ROWID, unique_id, friendly_name, size, icon, transcode_mode, transcode_format FROM devices");
-  q.exec();
+  SqliteQuery q(db);
+  q.Prepare("SELECT ROWID, unique_id, friendly_name, size, icon, transcode_mode, transcode_format FROM devices");
+  q.Exec();
   if (db_->CheckErrors(q)) return ret;
 
-  while (q.next()) {
+  while (q.Next()) {
     Device dev;
-    dev.id_ = q.value(0).toInt();
-    dev.unique_id_ = q.value(1).toString();
-    dev.friendly_name_ = q.value(2).toString();
-    dev.size_ = q.value(3).toLongLong();
-    dev.icon_name_ = q.value(4).toString();
-    dev.transcode_mode_ = MusicStorage::TranscodeMode(q.value(5).toInt());
-    dev.transcode_format_ = Song::FileType(q.value(6).toInt());
+    dev.id_ = q.Int(0);
+    dev.unique_id_ = q.String(1);
+    dev.friendly_name_ = q.String(2);
+    dev.size_ = q.LongLong(3);
+    dev.icon_name_ = q.String(4);
+    dev.transcode_mode_ = MusicStorage::TranscodeMode(q.Int(5));
+    dev.transcode_format_ = Song::FileType(q.Int(6));
     ret << dev;
   }
   return ret;
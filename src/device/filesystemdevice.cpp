@@ -23,7 +23,14 @@
 #include <QThread>
 #include <QVariant>
 #include <QString>
+#include <QStringList>
 #include <QUrl>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStorageInfo>
+#include <QSettings>
+#include <QByteArray>
+#include <QCryptographicHash>
 
 #include "core/application.h"
 #include "core/logging.h"
@@ -38,6 +45,8 @@
 
 class DeviceLister;
 
+const char *FilesystemDevice::kSettingsGroup = "FilesystemDevices";
+
 FilesystemDevice::FilesystemDevice(const QUrl &url, DeviceLister *lister, const QString &unique_id, DeviceManager *manager, Application *app, int database_id, bool first_time)
       : FilesystemMusicStorage(url.toLocalFile()),
       ConnectedDevice(url, lister, unique_id, manager, app, database_id, first_time),
@@ -60,13 +69,30 @@ FilesystemDevice::FilesystemDevice(const QUrl &url, DeviceLister *lister, const
   connect(watcher_, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)), backend_, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
   connect(watcher_, SIGNAL(CompilationsNeedUpdating()), backend_, SLOT(UpdateCompilations()));
   connect(watcher_, SIGNAL(ScanStarted(int)), SIGNAL(TaskStarted(int)));
+  connect(watcher_, SIGNAL(ScanStarted(int)), SLOT(ScanStarted()));
+  connect(watcher_, SIGNAL(ScanFinished(int)), SLOT(ScanFinished()));
 
 }
 
 bool FilesystemDevice::Init() {
+
+  // The volume is saved after every completed scan, if it's still the same nothing was written to it since and the collection is up to date.
+  if (!first_time_) {
+    QSettings s;
+    s.beginGroup(kSettingsGroup);
+    const QString volume_identity = s.value(SettingsKey()).toString();
+    s.endGroup();
+
+    if (!volume_identity.isEmpty() && volume_identity == VolumeIdentity(url_.toLocalFile())) {
+      qLog(Debug) << "Volume" << unique_id_ << "is unchanged since the last scan";
+      watcher_->set_skip_initial_scan(true);
+    }
+  }
+
   InitBackendDirectory(url_.toLocalFile(), first_time_);
   model_->Init();
   return true;
+
 }
 
 FilesystemDevice::~FilesystemDevice() {
@@ -76,3 +102,52 @@ FilesystemDevice::~FilesystemDevice() {
   watcher_thread_->wait();
 }
 
+QString FilesystemDevice::SettingsKey() const {
+
+  // The unique ID is made by the device lister and can contain slashes, which QSettings would take as groups.
+  return QString::fromLatin1(QCryptographicHash::hash(unique_id_.toUtf8(), QCryptographicHash::Sha1).toHex());
+
+}
+
+QString FilesystemDevice::VolumeIdentity(const QString &path) {
+
+  QStorageInfo storage(path);
+  if (!storage.isValid() || !storage.isReady()) return QString();
+
+  QStringList identity;
+  identity << storage.device()
+           << storage.fileSystemType()
+           << storage.name()
+           << QString::number(storage.bytesTotal())
+           << QString::number(storage.bytesFree())
+           << QString::number(QFileInfo(path).lastModified().toTime_t());
+
+  return identity.join(" ");
+
+}
+
+void FilesystemDevice::ScanStarted() {
+
+  // Forget the saved volume until the scan is finished, so an interrupted scan is continued next time.
+  scan_volume_identity_ = VolumeIdentity(url_.toLocalFile());
+
+  QSettings s;
+  s.beginGroup(kSettingsGroup);
+  s.remove(SettingsKey());
+  s.endGroup();
+
+}
+
+void FilesystemDevice::ScanFinished() {
+
+  if (scan_volume_identity_.isEmpty()) return;
+
+  QSettings s;
+  s.beginGroup(kSettingsGroup);
+  s.setValue(SettingsKey(), scan_volume_identity_);
+  s.endGroup();
+
+  scan_volume_identity_.clear();
+
+}
+
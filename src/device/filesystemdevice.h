@@ -50,13 +50,27 @@ public:
       int database_id, bool first_time);
   ~FilesystemDevice();
 
+  static const char *kSettingsGroup;
+
   bool Init();
 
   static QStringList url_schemes() { return QStringList() << "file"; }
 
+private slots:
+  void ScanStarted();
+  void ScanFinished();
+
+private:
+  // Identifies the volume and its contents, it changes when files are added, removed or resized.
+  static QString VolumeIdentity(const QString &path);
+  // Key of the device in the settings.
+  QString SettingsKey() const;
+
 private:
   CollectionWatcher *watcher_;
   QThread *watcher_thread_;
+  // Identity of the volume when the current scan started.
+  QString scan_volume_identity_;
 };
 
 #endif // FILESYSTEMDEVICE_H
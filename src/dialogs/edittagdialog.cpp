@@ -70,6 +70,7 @@
 #include "core/iconloader.h"
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
+#include "core/tagwriter.h"
 #include "core/utilities.h"
 #include "widgets/busyindicator.h"
 #include "widgets/lineedit.h"
@@ -97,12 +98,11 @@ EditTagDialog::EditTagDialog(Application *app, QWidget *parent)
       loading_(false),
       ignore_edits_(false),
 #if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
-      tag_fetcher_(new TagFetcher(this)),
+      tag_fetcher_(new TagFetcher(app->fingerprint_store(), this)),
 #endif
       cover_art_id_(0),
       cover_art_is_set_(false),
-      results_dialog_(new TrackSelectionDialog(this)),
-      pending_(0)
+      results_dialog_(new TrackSelectionDialog(this))
   {
 
   cover_options_.default_output_image_ = AlbumCoverLoader::ScaleAndPad(cover_options_, QImage(":/pictures/cdcase.png"));
@@ -730,17 +730,23 @@ void EditTagDialog::ButtonClicked(QAbstractButton *button) {
 
 void EditTagDialog::SaveData(const QList<Data> &data) {
 
+  SongList songs;
   for (int i = 0; i < data.count(); ++i) {
     const Data &ref = data[i];
     if (ref.current_.IsMetadataEqual(ref.original_)) continue;
 
-    pending_++;
-    TagReaderReply *reply = TagReaderClient::Instance()->SaveFile(ref.current_.url().toLocalFile(), ref.current_);
-    NewClosure(reply, SIGNAL(Finished(bool)), this, SLOT(SongSaveComplete(TagReaderReply*, QString, Song)), reply, ref.current_.url().toLocalFile(), ref.current_);
+    songs << ref.current_;
+  }
 
+  if (songs.isEmpty()) {
+    AcceptFinished();
+    return;
   }
 
-  if (pending_ <= 0) AcceptFinished();
+  // All songs are saved in batches, the collection is updated once they're all done.
+  TagWriter *writer = new TagWriter(app_, this);
+  NewClosure(writer, SIGNAL(Finished(bool)), this, SLOT(SongsSaveComplete(TagWriter*)), writer);
+  writer->Start(songs);
 
 }
 
@@ -892,22 +898,13 @@ void EditTagDialog::FetchTagSongChosen(const Song &original_song, const Song &ne
 }
 #endif
 
-void EditTagDialog::SongSaveComplete(TagReaderReply *reply, const QString filename, const Song song) {
-
-  reply->deleteLater();
+void EditTagDialog::SongsSaveComplete(TagWriter *writer) {
 
-  pending_--;
-
-  if (!reply->message().save_file_response().success()) {
-    QString message = tr("An error occurred writing metadata to '%1'").arg(filename);
+  for (const Song &song : writer->failed()) {
+    QString message = tr("An error occurred writing metadata to '%1'").arg(song.url().toLocalFile());
     emit Error(message);
   }
-  else if (song.directory_id() != -1) {
-    SongList songs;
-    songs << song;
-    app_->collection_backend()->AddOrUpdateSongs(songs);
-  }
 
-  if (pending_ <= 0) AcceptFinished();
+  AcceptFinished();
 
 }
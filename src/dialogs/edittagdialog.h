@@ -52,6 +52,7 @@ class QHideEvent;
 
 class Application;
 class AlbumCoverChoiceController;
+class TagWriter;
 class TrackSelectionDialog;
 class Ui_EditTagDialog;
 #if defined(HAVE_GSTREAMER) && defined(HAVE_CHROMAPRINT)
@@ -126,7 +127,7 @@ class EditTagDialog : public QDialog {
   void PreviousSong();
   void NextSong();
 
-  void SongSaveComplete(TagReaderReply *reply, const QString filename, const Song song);
+  void SongsSaveComplete(TagWriter *writer);
 
  private:
   struct FieldData {
@@ -192,8 +193,6 @@ class EditTagDialog : public QDialog {
   QPushButton *next_button_;
 
   TrackSelectionDialog *results_dialog_;
-
-  int pending_;
 };
 
 #endif  // EDITTAGDIALOG_H
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <cmath>
+#include <ctime>
 
 #include <QtGlobal>
 #include <QVariant>
@@ -31,6 +32,7 @@
 #include <QSettings>
 
 #include "core/timeconstants.h"
+#include "core/tracing.h"
 #include "engine_fwd.h"
 #include "enginebase.h"
 #include "settings/backendsettingspage.h"
@@ -55,7 +57,17 @@ Engine::Base::Base()
       fadeout_pause_enabled_(false),
       fadeout_duration_(2),
       fadeout_duration_nanosec_(2 * kNsecPerSec),
-      about_to_end_emitted_(false) {}
+      trace_audio_start_(false),
+      about_to_end_emitted_(false),
+      trace_play_start_(-1),
+      trace_playback_start_(-1),
+      trace_playback_cpu_nanosec_(0),
+      trace_playback_cpu_stream_(false) {
+
+  // The engines emit Playing when they started playing the track, for the engines that can't tell when the audio reached the output the time until then is traced here.
+  connect(this, SIGNAL(StateChanged(Engine::State)), SLOT(TraceStateChanged(Engine::State)));
+
+}
 
 Engine::Base::~Base() {}
 
@@ -75,6 +87,13 @@ bool Engine::Base::Load(const QUrl &media_url, const QUrl &original_url, TrackCh
 
 bool Engine::Base::Play(const QUrl &media_url, const QUrl &original_url, TrackChangeFlags flags, bool force_stop_at_end, quint64 beginning_nanosec, qint64 end_nanosec) {
 
+  if (tracing::IsEnabled()) {
+    // Engines tracing their audio end the playback when they release the stream or the next track is heard.
+    if (!trace_audio_start_) TracePlaybackFinished();
+    trace_play_start_ = tracing::Timestamp();
+    trace_play_change_ = flags;
+  }
+
   if (!Load(media_url, original_url, flags, force_stop_at_end, beginning_nanosec, end_nanosec))
     return false;
 
@@ -136,6 +155,105 @@ void Engine::Base::EmitAboutToEnd() {
   emit TrackAboutToEnd();
 }
 
+void Engine::Base::TraceStateChanged(Engine::State state) {
+
+  switch (state) {
+    case Engine::Playing:
+      if (trace_play_start_ == -1) {
+        // Not requested by Play(), so unpausing.
+        if (trace_playback_start_ == -1) TracePlaybackStarted(tracing::Timestamp());
+        break;
+      }
+
+      // Wait until the audio reached the output.
+      if (trace_audio_start_) break;
+
+      TraceTrackChange(tracing::Timestamp());
+      TracePlaybackStarted(tracing::Timestamp());
+      break;
+
+    case Engine::Paused:
+      TracePlaybackFinished();
+      break;
+
+    case Engine::Empty:
+    case Engine::Error:
+      trace_play_start_ = -1;
+      TracePlaybackFinished();
+      break;
+
+    default:
+      break;
+  }
+
+}
+
+void Engine::Base::TraceAudioStarted(const qint64 gap_start, const qint64 end) {
+
+  if (gap_start != -1) {
+    // The engine moved on to the next track by itself, so the transition is the gap between the audio of both tracks.
+    TracePlaybackFinished(gap_start);
+    tracing::Span("Engine::AutoTrackChange", "gapless", gap_start, end);
+  }
+  else if (trace_play_start_ != -1) {
+    TraceTrackChange(end);
+  }
+
+  if (trace_playback_start_ == -1) TracePlaybackStarted(end);
+
+}
+
+void Engine::Base::TraceTrackChange(const qint64 end) {
+
+  if (trace_play_change_ & Engine::Auto)
+    tracing::Span("Engine::AutoTrackChange", media_url_.toString(), trace_play_start_, end);
+  else if (trace_play_change_ & Engine::First)
+    tracing::Span("Engine::StartPlayback", media_url_.toString(), trace_play_start_, end);
+  else
+    tracing::Span("Engine::TrackChange", media_url_.toString(), trace_play_start_, end);
+  trace_play_start_ = -1;
+
+}
+
+void Engine::Base::TracePlaybackStarted(const qint64 start) {
+
+  trace_playback_start_ = start;
+  trace_playback_cpu_nanosec_ = TraceCpuTime(&trace_playback_cpu_stream_);
+
+}
+
+void Engine::Base::TracePlaybackFinished(const qint64 end) {
+
+  if (trace_playback_start_ == -1) return;
+
+  bool stream = false;
+  const qint64 cpu_nanosec = TraceCpuTime(&stream);
+
+  // Leave the CPU time out if the stream was released before it could be read.
+  QString detail;
+  if (stream == trace_playback_cpu_stream_) {
+    detail = QString("cpu_msec=%1 cpu=%2").arg((cpu_nanosec - trace_playback_cpu_nanosec_) / kNsecPerMsec).arg(stream ? "stream" : "process");
+  }
+
+  if (end == -1)
+    tracing::Span("Engine::Playback", detail, trace_playback_start_);
+  else
+    tracing::Span("Engine::Playback", detail, trace_playback_start_, end);
+  trace_playback_start_ = -1;
+
+}
+
+qint64 Engine::Base::TraceCpuTime(bool *stream) const {
+
+  const qint64 cpu_nanosec = cpu_time_nanosec();
+  *stream = cpu_nanosec != -1;
+  if (*stream) return cpu_nanosec;
+
+  // The CPU time of the whole process.
+  return qint64(std::clock()) * (kNsecPerSec / CLOCKS_PER_SEC);
+
+}
+
 bool Engine::Base::ValidOutput(const QString &output) {
 
   return (true);
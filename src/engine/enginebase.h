@@ -80,6 +80,8 @@ public:
 
   virtual qint64 position_nanosec() const = 0;
   virtual qint64 length_nanosec() const = 0;
+  // CPU time used by the stream that's playing so far, or -1 if the engine can't measure it.
+  virtual qint64 cpu_time_nanosec() const { return -1; }
 
   virtual const Scope &scope(int chunk_length) { return scope_; }
 
@@ -108,6 +110,17 @@ public slots:
 protected:
   void EmitAboutToEnd();
 
+  // For engines that tell when the audio of a track actually reached the output, instead of when they started playing it.
+  // gap_start is the trace time of the last audio of the track before when the engine moved on to the track by itself, otherwise -1.
+  void TraceAudioStarted(const qint64 gap_start, const qint64 end);
+  // Call before the stream that's playing is released, so its CPU time can still be read.
+  void TracePlaybackFinished(const qint64 end = -1);
+  // The engine was asked to play the track it's already playing after moving on to it by itself.
+  void TracePlayRequestHandled() { trace_play_start_ = -1; }
+
+private slots:
+  void TraceStateChanged(Engine::State state);
+
 public:
 
   // Simple accessors
@@ -199,8 +212,26 @@ signals:
   qint64 fadeout_pause_duration_;
   qint64 fadeout_pause_duration_nanosec_;
 
+  // Set by engines that call TraceAudioStarted().
+  bool trace_audio_start_;
+
+private:
+  void TraceTrackChange(const qint64 end);
+  void TracePlaybackStarted(const qint64 start);
+  qint64 TraceCpuTime(bool *stream) const;
+
 private:
   bool about_to_end_emitted_;
+
+  // Trace times of the track that was requested last, and of the track that's playing, -1 if tracing is disabled.
+  qint64 trace_play_start_;
+  TrackChangeFlags trace_play_change_;
+  // Start of the current stretch of playback, a pause ends it.
+  qint64 trace_playback_start_;
+  // CPU time at the start of the playback, of the stream if the engine can measure it, otherwise of the whole process.
+  qint64 trace_playback_cpu_nanosec_;
+  bool trace_playback_cpu_stream_;
+
   Q_DISABLE_COPY(Base);
 
 };
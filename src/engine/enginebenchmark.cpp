@@ -0,0 +1,266 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QObject>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVariant>
+#include <QString>
+#include <QUrl>
+#include <QSettings>
+
+#include "core/logging.h"
+#include "core/taskmanager.h"
+#include "core/timeconstants.h"
+#include "core/tracing.h"
+#include "enginebase.h"
+#include "enginetype.h"
+#include "enginebenchmark.h"
+#ifdef HAVE_GSTREAMER
+#  include "gstengine.h"
+#  include "gststartup.h"
+#endif
+#ifdef HAVE_XINE
+#  include "xineengine.h"
+#endif
+#ifdef HAVE_VLC
+#  include "vlcengine.h"
+#endif
+#include "settings/backendsettingspage.h"
+
+const int EngineBenchmark::kPlayMsec = 2000;
+const int EngineBenchmark::kPollMsec = 5;
+const int EngineBenchmark::kTimeoutMsec = 30000;
+const qint64 EngineBenchmark::kGaplessTailNanosec = 5 * kNsecPerSec;
+const qint64 EngineBenchmark::kSeekToleranceNanosec = 500 * kNsecPerMsec;
+
+EngineBenchmark::EngineBenchmark(TaskManager *task_manager, QObject *parent)
+    : QObject(parent),
+      task_manager_(task_manager),
+#ifdef HAVE_GSTREAMER
+      gst_startup_(new GstStartup(this)),
+#endif
+      spare_pipelines_(true),
+      next_track_(-1),
+      playing_count_(0),
+      tracks_ended_(0) {}
+
+EngineBenchmark::~EngineBenchmark() {}
+
+QList<Engine::EngineType> EngineBenchmark::SupportedEngines() {
+
+  QList<Engine::EngineType> enginetypes;
+#ifdef HAVE_GSTREAMER
+  enginetypes << Engine::GStreamer;
+#endif
+#ifdef HAVE_VLC
+  enginetypes << Engine::VLC;
+#endif
+#ifdef HAVE_XINE
+  enginetypes << Engine::Xine;
+#endif
+  return enginetypes;
+
+}
+
+QString EngineBenchmark::NullOutput(const Engine::EngineType enginetype) {
+
+  switch (enginetype) {
+    case Engine::GStreamer:
+      return "fakesink";
+    case Engine::VLC:
+      return "adummy";
+    case Engine::Xine:
+      return "none";
+    default:
+      return QString();
+  }
+
+}
+
+EngineBase *EngineBenchmark::CreateEngine(const Engine::EngineType enginetype) {
+
+  // The engines read the output from the settings when they are created.
+  QSettings s;
+  s.beginGroup(BackendSettingsPage::kSettingsGroup);
+  s.setValue("output", NullOutput(enginetype));
+  s.setValue("device", QVariant());
+  s.endGroup();
+
+  switch (enginetype) {
+#ifdef HAVE_GSTREAMER
+    case Engine::GStreamer:{
+      GstEngine *gst_engine = new GstEngine(task_manager_);
+      gst_engine->SetStartup(gst_startup_);
+      if (!spare_pipelines_) gst_engine->SetSparePipelines(0);
+      return gst_engine;
+    }
+#endif
+#ifdef HAVE_XINE
+    case Engine::Xine:
+      return new XineEngine(task_manager_);
+#endif
+#ifdef HAVE_VLC
+    case Engine::VLC:
+      return new VLCEngine(task_manager_);
+#endif
+    default:
+      return nullptr;
+  }
+
+}
+
+bool EngineBenchmark::Run(const Engine::EngineType enginetype, const QList<QUrl> &urls) {
+
+  tracing::ScopedSpan span("EngineBenchmark::Run", Engine::EngineName(enginetype));
+
+  engine_.reset(CreateEngine(enginetype));
+  if (!engine_ || !engine_->Init()) {
+    qLog(Error) << "Could not create the" << Engine::EngineName(enginetype) << "engine";
+    engine_.reset();
+    return false;
+  }
+
+  connect(engine_.get(), SIGNAL(StateChanged(Engine::State)), SLOT(StateChanged(Engine::State)));
+  connect(engine_.get(), SIGNAL(TrackAboutToEnd()), SLOT(TrackAboutToEnd()));
+  connect(engine_.get(), SIGNAL(TrackEnded()), SLOT(TrackEnded()));
+
+  urls_ = urls;
+  next_track_ = -1;
+  bool success = true;
+
+  // Start each file by hand, and seek to the middle of it.
+  for (int i = 0 ; i < urls.count() && success ; ++i) {
+    success = Play(urls[i], i == 0 ? Engine::First : Engine::Manual);
+    if (!success) break;
+    Wait(kPlayMsec);
+    if (!Seek(engine_->length_nanosec() / 2)) {
+      qLog(Warning) << "Seek in" << urls[i] << "timed out";
+    }
+    Wait(kPlayMsec);
+  }
+  engine_->Stop();
+
+  // Play them once more, skipping to the end of each file so the engine moves on to the next one by itself.
+  tracks_ended_ = 0;
+  if (success) success = Play(urls[0], Engine::First);
+  for (int i = 0 ; i < urls.count() && success ; ++i) {
+    next_track_ = i + 1 < urls.count() ? i + 1 : -1;
+    Wait(kPlayMsec);
+    const qint64 length_nanosec = engine_->length_nanosec();
+    if (length_nanosec > kGaplessTailNanosec) engine_->Seek(length_nanosec - kGaplessTailNanosec);
+
+    success = WaitForTracksEnded(i + 1);
+    if (!success) {
+      qLog(Error) << "Playback of" << urls[i] << "didn't end";
+      break;
+    }
+    // Like the player does when a track ended.
+    if (next_track_ != -1) engine_->Play(urls[next_track_], urls[next_track_], Engine::Auto, false, 0, -1);
+  }
+  engine_->Stop();
+
+  engine_.reset();
+  return success;
+
+}
+
+bool EngineBenchmark::Play(const QUrl &url, const Engine::TrackChangeFlags flags) {
+
+  const int playing_count = playing_count_;
+  if (!engine_->Play(url, url, flags, false, 0, -1)) {
+    qLog(Error) << "Could not play" << url;
+    return false;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  while (playing_count_ == playing_count) {
+    if (timer.elapsed() > kTimeoutMsec) {
+      qLog(Error) << "Playback of" << url << "didn't start";
+      return false;
+    }
+    Wait(kPollMsec);
+  }
+
+  return true;
+
+}
+
+bool EngineBenchmark::Seek(const qint64 offset_nanosec) {
+
+  // The time until the engine reports the new position, so it's measured the same way for every engine.
+  tracing::ScopedSpan span("EngineBenchmark::Seek", Engine::EngineName(engine_->type()));
+
+  engine_->Seek(offset_nanosec);
+
+  QElapsedTimer timer;
+  timer.start();
+  while (qAbs(engine_->position_nanosec() - offset_nanosec) > kSeekToleranceNanosec) {
+    if (timer.elapsed() > kTimeoutMsec) return false;
+    Wait(kPollMsec);
+  }
+
+  return true;
+
+}
+
+bool EngineBenchmark::WaitForTracksEnded(const int count) {
+
+  QElapsedTimer timer;
+  timer.start();
+  while (tracks_ended_ < count) {
+    if (timer.elapsed() > kTimeoutMsec) return false;
+    Wait(kPollMsec);
+  }
+
+  return true;
+
+}
+
+void EngineBenchmark::Wait(const int msec) {
+
+  QEventLoop loop;
+  QTimer::singleShot(msec, &loop, SLOT(quit()));
+  loop.exec();
+
+}
+
+void EngineBenchmark::StateChanged(Engine::State state) {
+
+  if (state == Engine::Playing) ++playing_count_;
+
+}
+
+void EngineBenchmark::TrackAboutToEnd() {
+
+  if (next_track_ == -1) return;
+  engine_->StartPreloading(urls_[next_track_], urls_[next_track_], false, 0, -1);
+
+}
+
+void EngineBenchmark::TrackEnded() {
+
+  ++tracks_ended_;
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ENGINEBENCHMARK_H
+#define ENGINEBENCHMARK_H
+
+#include "config.h"
+
+#include <memory>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QUrl>
+
+#include "engine_fwd.h"
+#include "enginetype.h"
+
+class TaskManager;
+#ifdef HAVE_GSTREAMER
+class GstStartup;
+#endif
+
+// Plays files with the engines the way the player does, with the audio going to an output that discards it.
+// The engines record how long starting playback, changing tracks and seeking takes in the trace, this only drives them.
+class EngineBenchmark : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit EngineBenchmark(TaskManager *task_manager, QObject *parent = nullptr);
+  ~EngineBenchmark();
+
+  static QList<Engine::EngineType> SupportedEngines();
+  // The output of the engine that doesn't play the audio anywhere.
+  static QString NullOutput(const Engine::EngineType enginetype);
+
+  // Whether the engines build pipelines ahead of the track changes, for engines that do.
+  void set_spare_pipelines(const bool spare_pipelines) { spare_pipelines_ = spare_pipelines; }
+
+  // Starts each file by hand and seeks in it, then plays all of them once more moving on to the next one by itself.
+  // Returns false if the engine failed to play one of the files.
+  bool Run(const Engine::EngineType enginetype, const QList<QUrl> &urls);
+
+ private slots:
+  void StateChanged(Engine::State state);
+  void TrackAboutToEnd();
+  void TrackEnded();
+
+ private:
+  static const int kPlayMsec;
+  static const int kPollMsec;
+  static const int kTimeoutMsec;
+  static const qint64 kGaplessTailNanosec;
+  static const qint64 kSeekToleranceNanosec;
+
+  EngineBase *CreateEngine(const Engine::EngineType enginetype);
+  bool Play(const QUrl &url, const Engine::TrackChangeFlags flags);
+  bool Seek(const qint64 offset_nanosec);
+  bool WaitForTracksEnded(const int count);
+  void Wait(const int msec);
+
+  TaskManager *task_manager_;
+#ifdef HAVE_GSTREAMER
+  GstStartup *gst_startup_;
+#endif
+  std::unique_ptr<EngineBase> engine_;
+  bool spare_pipelines_;
+
+  QList<QUrl> urls_;
+  // The file to preload when the engine is about to move on by itself, -1 if there is none.
+  int next_track_;
+  int playing_count_;
+  int tracks_ended_;
+};
+
+#endif  // ENGINEBENCHMARK_H
@@ -54,6 +54,7 @@
 #include "core/logging.h"
 #include "core/taskmanager.h"
 #include "core/timeconstants.h"
+#include "core/tracing.h"
 #include "enginebase.h"
 #include "enginetype.h"
 #include "gstengine.h"
@@ -82,6 +83,8 @@ GstEngine::GstEngine(TaskManager *task_manager)
     : Engine::Base(),
       task_manager_(task_manager),
       buffering_task_id_(-1),
+      spare_pipeline_count_(kDefaultSparePipelines),
+      spare_pipeline_timer_(new QTimer(this)),
       latest_buffer_(nullptr),
       stereo_balance_(0.0f),
       seek_timer_(new QTimer(this)),
@@ -93,10 +96,15 @@ GstEngine::GstEngine(TaskManager *task_manager)
       have_new_buffer_(false) {
 
   type_ = Engine::GStreamer;
+  trace_audio_start_ = true;
   seek_timer_->setSingleShot(true);
   seek_timer_->setInterval(kSeekDelayNanosec / kNsecPerMsec);
   connect(seek_timer_, SIGNAL(timeout()), SLOT(SeekNow()));
 
+  spare_pipeline_timer_->setSingleShot(true);
+  spare_pipeline_timer_->setInterval(kSparePipelineDelayMsec);
+  connect(spare_pipeline_timer_, SIGNAL(timeout()), SLOT(PrepareSparePipeline()));
+
   ReloadSettings();
 
 }
@@ -104,6 +112,7 @@ GstEngine::GstEngine(TaskManager *task_manager)
 GstEngine::~GstEngine() {
   EnsureInitialised();
   current_pipeline_.reset();
+  spare_pipelines_.clear();
 }
 
 bool GstEngine::Init() {
@@ -158,15 +167,17 @@ bool GstEngine::Load(const QUrl &media_url, const QUrl &original_url, Engine::Tr
 
   if (!crossfade && current_pipeline_ && current_pipeline_->media_url() == gst_url && change & Engine::Auto) {
     // We're not crossfading, and the pipeline is already playing the URI we want, so just do nothing.
+    TracePlayRequestHandled();
     return true;
   }
 
-  shared_ptr<GstEnginePipeline> pipeline = CreatePipeline(gst_url, original_url, force_stop_at_end ? end_nanosec : 0);
+  shared_ptr<GstEnginePipeline> pipeline = CreatePipeline(gst_url, original_url, beginning_nanosec, force_stop_at_end ? end_nanosec : 0);
   if (!pipeline) return false;
 
   if (crossfade) StartFadeout();
 
   BufferingFinished();
+  TracePlaybackFinished();
   current_pipeline_ = pipeline;
 
   SetVolume(volume_);
@@ -187,8 +198,11 @@ bool GstEngine::Play(quint64 offset_nanosec) {
 
   if (!current_pipeline_ || current_pipeline_->is_buffering()) return false;
 
+  // A pipeline that is already playing moved on to this song by itself, so it's at the right position already.
+  const bool initial_seek = offset_nanosec != 0 || current_pipeline_->state() != GST_STATE_PLAYING;
+
   QFuture<GstStateChangeReturn> future = current_pipeline_->SetState(GST_STATE_PLAYING);
-  NewClosure(future, this, SLOT(PlayDone(QFuture<GstStateChangeReturn>, quint64, int)), future, offset_nanosec, current_pipeline_->id());
+  NewClosure(future, this, SLOT(PlayDone(QFuture<GstStateChangeReturn>, quint64, int, bool)), future, offset_nanosec, current_pipeline_->id(), initial_seek);
 
   if (is_fading_out_to_pause_) {
     current_pipeline_->SetState(GST_STATE_PAUSED);
@@ -218,6 +232,7 @@ void GstEngine::Stop(bool stop_after) {
 
   if (fadeout_enabled_ && current_pipeline_ && !stop_after) StartFadeout();
 
+  TracePlaybackFinished();
   current_pipeline_.reset();
   BufferingFinished();
   emit StateChanged(Engine::Empty);
@@ -314,6 +329,13 @@ qint64 GstEngine::length_nanosec() const {
 
 }
 
+qint64 GstEngine::cpu_time_nanosec() const {
+
+  if (!current_pipeline_) return -1;
+  return current_pipeline_->cpu_time_nanosec();
+
+}
+
 const Engine::Scope &GstEngine::scope(int chunk_length) {
 
   // The new buffer could have a different size
@@ -390,6 +412,9 @@ void GstEngine::ReloadSettings() {
 
   if (output_.isEmpty()) output_ = kAutoSink;
 
+  // The spare pipelines were built with the old settings.
+  ClearSparePipelines();
+
 }
 
 GstElement *GstEngine::CreateElement(const QString &factoryName, GstElement *bin, bool showerror) {
@@ -422,6 +447,9 @@ void GstEngine::ConsumeBuffer(GstBuffer *buffer, int pipeline_id) {
 
 void GstEngine::SetEqualizerEnabled(bool enabled) {
 
+  // The equalizer is only linked into pipelines built while it's enabled.
+  if (enabled != equalizer_enabled_) ClearSparePipelines();
+
   equalizer_enabled_ = enabled;
 
   if (current_pipeline_) current_pipeline_->SetEqualizerEnabled(enabled);
@@ -448,11 +476,17 @@ void GstEngine::SetStereoBalance(float value) {
 void GstEngine::AddBufferConsumer(GstBufferConsumer *consumer) {
   buffer_consumers_ << consumer;
   if (current_pipeline_) current_pipeline_->AddBufferConsumer(consumer);
+  for (const shared_ptr<GstEnginePipeline> &pipeline : spare_pipelines_) {
+    pipeline->AddBufferConsumer(consumer);
+  }
 }
 
 void GstEngine::RemoveBufferConsumer(GstBufferConsumer *consumer) {
   buffer_consumers_.removeAll(consumer);
   if (current_pipeline_) current_pipeline_->RemoveBufferConsumer(consumer);
+  for (const shared_ptr<GstEnginePipeline> &pipeline : spare_pipelines_) {
+    pipeline->RemoveBufferConsumer(consumer);
+  }
 }
 
 void GstEngine::timerEvent(QTimerEvent *e) {
@@ -485,6 +519,7 @@ void GstEngine::EndOfStreamReached(int pipeline_id, bool has_next_track) {
     return;
 
   if (!has_next_track) {
+    TracePlaybackFinished();
     current_pipeline_.reset();
     BufferingFinished();
   }
@@ -492,12 +527,22 @@ void GstEngine::EndOfStreamReached(int pipeline_id, bool has_next_track) {
 
 }
 
+void GstEngine::AudioStarted(int pipeline_id, qint64 gap_start, qint64 end) {
+
+  if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id)
+    return;
+
+  TraceAudioStarted(gap_start, end);
+
+}
+
 void GstEngine::HandlePipelineError(int pipeline_id, const QString &message, int domain, int error_code) {
 
   if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id) return;
 
   qLog(Error) << "Gstreamer error:" << domain << error_code << message;
 
+  TracePlaybackFinished();
   current_pipeline_.reset();
   BufferingFinished();
   emit StateChanged(Engine::Error);
@@ -570,7 +615,7 @@ void GstEngine::SeekNow() {
   }
 }
 
-void GstEngine::PlayDone(QFuture<GstStateChangeReturn> future, const quint64 offset_nanosec, const int pipeline_id) {
+void GstEngine::PlayDone(QFuture<GstStateChangeReturn> future, const quint64 offset_nanosec, const int pipeline_id, const bool initial_seek) {
 
   GstStateChangeReturn ret = future.result();
 
@@ -583,7 +628,7 @@ void GstEngine::PlayDone(QFuture<GstStateChangeReturn> future, const quint64 off
     QByteArray redirect_url = current_pipeline_->redirect_url();
     if (!redirect_url.isEmpty() && redirect_url != current_pipeline_->media_url()) {
       qLog(Info) << "Redirecting to" << redirect_url;
-      current_pipeline_ = CreatePipeline(redirect_url, current_pipeline_->original_url(), end_nanosec_);
+      current_pipeline_ = CreatePipeline(redirect_url, current_pipeline_->original_url(), beginning_nanosec_, end_nanosec_);
       Play(offset_nanosec);
       return;
     }
@@ -598,7 +643,7 @@ void GstEngine::PlayDone(QFuture<GstStateChangeReturn> future, const quint64 off
   StartTimers();
 
   // Initial offset
-  if (offset_nanosec != 0 || beginning_nanosec_ != 0) {
+  if (initial_seek && (offset_nanosec != 0 || beginning_nanosec_ != 0)) {
     Seek(offset_nanosec);
   }
 
@@ -752,6 +797,7 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
   }
 
   connect(ret.get(), SIGNAL(EndOfStreamReached(int, bool)), SLOT(EndOfStreamReached(int, bool)));
+  connect(ret.get(), SIGNAL(AudioStarted(int, qint64, qint64)), SLOT(AudioStarted(int, qint64, qint64)));
   connect(ret.get(), SIGNAL(Error(int, QString, int, int)), SLOT(HandlePipelineError(int, QString, int, int)));
   connect(ret.get(), SIGNAL(MetadataFound(int, Engine::SimpleMetaBundle)), SLOT(NewMetaData(int, Engine::SimpleMetaBundle)));
   connect(ret.get(), SIGNAL(BufferingStarted()), SLOT(BufferingStarted()));
@@ -762,14 +808,47 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
 
 }
 
-shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline(const QByteArray &gst_url, const QUrl &original_url, qint64 end_nanosec) {
+shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline(const QByteArray &gst_url, const QUrl &original_url, qint64 beginning_nanosec, qint64 end_nanosec) {
+
+  tracing::ScopedSpan span("GstEngine::CreatePipeline", spare_pipelines_.isEmpty() ? "new" : "spare");
+
+  shared_ptr<GstEnginePipeline> ret = spare_pipelines_.isEmpty() ? CreatePipeline() : spare_pipelines_.takeFirst();
+  if (!ret->InitFromUrl(gst_url, original_url, beginning_nanosec, end_nanosec)) ret.reset();
+
+  // Build the next spare pipeline after the track started playing.
+  if (spare_pipeline_count_ > 0) spare_pipeline_timer_->start();
 
-  shared_ptr<GstEnginePipeline> ret = CreatePipeline();
-  if (!ret->InitFromUrl(gst_url, original_url, end_nanosec)) ret.reset();
   return ret;
 
 }
 
+void GstEngine::PrepareSparePipeline() {
+
+  if (spare_pipelines_.count() >= spare_pipeline_count_) return;
+
+  shared_ptr<GstEnginePipeline> pipeline = CreatePipeline();
+  if (!pipeline->Init()) return;
+  spare_pipelines_ << pipeline;
+
+  if (spare_pipelines_.count() < spare_pipeline_count_) spare_pipeline_timer_->start();
+
+}
+
+void GstEngine::SetSparePipelines(const int count) {
+
+  spare_pipeline_count_ = qMax(0, count);
+  while (spare_pipelines_.count() > spare_pipeline_count_) spare_pipelines_.removeLast();
+  if (spare_pipeline_count_ == 0) spare_pipeline_timer_->stop();
+
+}
+
+void GstEngine::ClearSparePipelines() {
+
+  spare_pipeline_timer_->stop();
+  spare_pipelines_.clear();
+
+}
+
 void GstEngine::UpdateScope(int chunk_length) {
 
   typedef Engine::Scope::value_type sample_type;
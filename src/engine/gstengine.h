@@ -83,6 +83,7 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
  public:
   qint64 position_nanosec() const;
   qint64 length_nanosec() const;
+  qint64 cpu_time_nanosec() const;
   const Engine::Scope &scope(int chunk_length);
 
   OutputDetailsList GetOutputsList() const;
@@ -92,6 +93,8 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   bool ALSADeviceSupport(const QString &output);
 
   void SetStartup(GstStartup *gst_startup) { gst_startup_ = gst_startup; }
+  // Number of pipelines built ahead of the next track change, 0 builds each pipeline when it's needed.
+  void SetSparePipelines(const int count);
   void EnsureInitialised() { gst_startup_->EnsureInitialised(); }
 
   GstElement *CreateElement(const QString &factoryName, GstElement *bin = nullptr, bool showerror = true);
@@ -122,18 +125,21 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
 
  private slots:
   void EndOfStreamReached(int pipeline_id, bool has_next_track);
+  void AudioStarted(int pipeline_id, qint64 gap_start, qint64 end);
   void HandlePipelineError(int pipeline_id, const QString &message, int domain, int error_code);
   void NewMetaData(int pipeline_id, const Engine::SimpleMetaBundle &bundle);
   void AddBufferToScope(GstBuffer *buf, int pipeline_id);
   void FadeoutFinished();
   void FadeoutPauseFinished();
   void SeekNow();
-  void PlayDone(QFuture<GstStateChangeReturn> future, const quint64, const int);
+  void PlayDone(QFuture<GstStateChangeReturn> future, const quint64, const int, const bool);
 
   void BufferingStarted();
   void BufferingProgress(int percent);
   void BufferingFinished();
 
+  void PrepareSparePipeline();
+
  private:
   static const char *kAutoSink;
   static const char *kALSASink;
@@ -158,7 +164,8 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   void StopTimers();
 
   std::shared_ptr<GstEnginePipeline> CreatePipeline();
-  std::shared_ptr<GstEnginePipeline> CreatePipeline(const QByteArray &gst_url, const QUrl &original_url,  qint64 end_nanosec);
+  std::shared_ptr<GstEnginePipeline> CreatePipeline(const QByteArray &gst_url, const QUrl &original_url, qint64 beginning_nanosec, qint64 end_nanosec);
+  void ClearSparePipelines();
 
   void UpdateScope(int chunk_length);
 
@@ -166,6 +173,8 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   static const qint64 kTimerIntervalNanosec = 1000 * kNsecPerMsec;  // 1s
   static const qint64 kPreloadGapNanosec = 3000 * kNsecPerMsec;     // 3s
   static const qint64 kSeekDelayNanosec = 100 * kNsecPerMsec;       // 100msec
+  static const int kDefaultSparePipelines = 2;
+  static const int kSparePipelineDelayMsec = 1000;
 
   TaskManager *task_manager_;
   GstStartup *gst_startup_;
@@ -174,6 +183,10 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   std::shared_ptr<GstEnginePipeline> current_pipeline_;
   std::shared_ptr<GstEnginePipeline> fadeout_pipeline_;
   std::shared_ptr<GstEnginePipeline> fadeout_pause_pipeline_;
+  // Pipelines built ahead with the current settings, so changing tracks only needs to set the URL.
+  QList<std::shared_ptr<GstEnginePipeline>> spare_pipelines_;
+  int spare_pipeline_count_;
+  QTimer *spare_pipeline_timer_;
   QUrl preloaded_url_;
 
   QList<GstBufferConsumer*> buffer_consumers_;
@@ -39,10 +39,16 @@
 #include <QMetaObject>
 #include <QtDebug>
 
+#ifdef Q_OS_LINUX
+#  include <time.h>
+#  include <pthread.h>
+#endif
+
 #include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/signalchecker.h"
 #include "core/timeconstants.h"
+#include "core/tracing.h"
 #include "enginebase.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
@@ -76,16 +82,21 @@ GstEnginePipeline::GstEnginePipeline(GstEngine *engine)
       buffer_duration_nanosec_(1 * kNsecPerSec),
       buffer_min_fill_(33),
       buffering_(false),
-      segment_start_(0),
-      segment_start_received_(false),
+      beginning_offset_nanosec_(0),
       end_offset_nanosec_(-1),
       next_beginning_offset_nanosec_(-1),
       next_end_offset_nanosec_(-1),
-      ignore_next_seek_(false),
+      pending_section_changes_(0),
       ignore_tags_(false),
       pipeline_is_initialised_(false),
       pipeline_is_connected_(false),
       pending_seek_nanosec_(-1),
+      seek_trace_start_(-1),
+      audio_start_pending_(true),
+      last_audio_trace_time_(-1),
+#ifdef Q_OS_LINUX
+      finished_tasks_cpu_nanosec_(0),
+#endif
       next_uri_set_(false),
       volume_percent_(100),
       volume_modifier_(1.0),
@@ -220,6 +231,11 @@ bool GstEnginePipeline::InitAudioBin() {
     return false;
   }
 
+  // fakesink is only used to play without output, make it keep to the clock like an audio device does, instead of going through the song as fast as it can.
+  if (output_ == "fakesink") {
+    g_object_set(G_OBJECT(audiosink_), "sync", TRUE, nullptr);
+  }
+
   if (device_.isValid() && g_object_class_find_property(G_OBJECT_GET_CLASS(audiosink_), "device")) {
     switch (device_.type()) {
       case QVariant::String:
@@ -270,9 +286,7 @@ bool GstEnginePipeline::InitAudioBin() {
   }
 
   // Create the replaygain elements if it's enabled.
-  // event_probe is the audioconvert element we attach the probe to, which will change depending on whether replaygain is enabled.
-  // convert_sink is the element after the first audioconvert, which again will change.
-  GstElement *event_probe = audioconvert_;
+  // convert_sink is the element after the first audioconvert, which will change depending on whether replaygain is enabled.
   GstElement *convert_sink = tee;
 
   if (rg_enabled_) {
@@ -280,7 +294,6 @@ bool GstEnginePipeline::InitAudioBin() {
     rglimiter_ = engine_->CreateElement("rglimiter", audiobin_, false);
     audioconvert2_ = engine_->CreateElement("audioconvert", audiobin_, false);
     if (rgvolume_ && rglimiter_ && audioconvert2_) {
-      event_probe = audioconvert2_;
       convert_sink = rgvolume_;
       // Set replaygain settings
       g_object_set(G_OBJECT(rgvolume_), "album-mode", rg_mode_, nullptr);
@@ -294,12 +307,6 @@ bool GstEnginePipeline::InitAudioBin() {
   gst_element_add_pad(audiobin_, gst_ghost_pad_new("sink", pad));
   gst_object_unref(pad);
 
-  // Add a data probe on the src pad of the audioconvert element for our scope.
-  // We do it here because we want pre-equalized and pre-volume samples so that our visualization are not be affected by them.
-  pad = gst_element_get_static_pad(event_probe, "src");
-  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, &EventHandoffCallback, this, NULL);
-  gst_object_unref(pad);
-
   // Configure the fakesink properly
   g_object_set(G_OBJECT(probe_sink), "sync", TRUE, nullptr);
 
@@ -393,6 +400,15 @@ bool GstEnginePipeline::InitAudioBin() {
   gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, HandoffCallback, this, nullptr);
   gst_object_unref(pad);
 
+  // SEGMENT_DONE is serialized with the audio, so it only reaches the sink once everything before it was played.
+  pad = gst_element_get_static_pad(audiosink_, "sink");
+  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, SegmentDoneCallback, this, nullptr);
+  // Watching every buffer is only worth it when the time until the audio is heard gets traced.
+  if (tracing::IsEnabled()) {
+    gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM), AudioStartCallback, this, nullptr);
+  }
+  gst_object_unref(pad);
+
   GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
   gst_bus_set_sync_handler(bus, BusCallbackSync, this, nullptr);
   bus_cb_id_ = gst_bus_add_watch(bus, BusCallback, this);
@@ -410,16 +426,11 @@ bool GstEnginePipeline::InitFromString(const QString &pipeline) {
 
 }
 
-bool GstEnginePipeline::InitFromUrl(const QByteArray &media_url, const QUrl original_url, qint64 end_nanosec) {
-
-  media_url_ = media_url;
-  original_url_ = original_url;
-  end_offset_nanosec_ = end_nanosec;
+bool GstEnginePipeline::Init() {
 
   pipeline_ = engine_->CreateElement("playbin");
   if (!pipeline_) return false;
 
-  g_object_set(G_OBJECT(pipeline_), "uri", media_url.constData(), nullptr);
   CHECKED_GCONNECT(G_OBJECT(pipeline_), "about-to-finish", &AboutToFinishCallback, this);
 
   CHECKED_GCONNECT(G_OBJECT(pipeline_), "pad-added", &NewPadCallback, this);
@@ -435,6 +446,21 @@ bool GstEnginePipeline::InitFromUrl(const QByteArray &media_url, const QUrl orig
 
 }
 
+bool GstEnginePipeline::InitFromUrl(const QByteArray &media_url, const QUrl original_url, qint64 beginning_nanosec, qint64 end_nanosec) {
+
+  media_url_ = media_url;
+  original_url_ = original_url;
+  beginning_offset_nanosec_ = beginning_nanosec;
+  end_offset_nanosec_ = end_nanosec;
+
+  if (!pipeline_ && !Init()) return false;
+
+  g_object_set(G_OBJECT(pipeline_), "uri", media_url.constData(), nullptr);
+
+  return true;
+
+}
+
 gboolean GstEnginePipeline::BusCallback(GstBus*, GstMessage *msg, gpointer self) {
 
   GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
@@ -501,6 +527,15 @@ GstBusSyncReply GstEnginePipeline::BusCallbackSync(GstBus *, GstMessage *msg, gp
       instance->StreamStartMessageReceived();
       break;
 
+    case GST_MESSAGE_ASYNC_DONE:
+      instance->AsyncDoneMessageReceived();
+      break;
+
+    case GST_MESSAGE_SEGMENT_DONE:
+      // The next segment is started with a seek, which shouldn't be done from a streaming thread.
+      QMetaObject::invokeMethod(instance, "SegmentDoneMessageReceived", Qt::QueuedConnection);
+      break;
+
     default:
       break;
   }
@@ -509,6 +544,16 @@ GstBusSyncReply GstEnginePipeline::BusCallbackSync(GstBus *, GstMessage *msg, gp
 
 }
 
+void GstEnginePipeline::AsyncDoneMessageReceived() {
+
+  // A flushing seek is done when the pipeline prerolled again.
+  const qint64 start = seek_trace_start_.fetchAndStoreRelaxed(-1);
+  if (start == -1) return;
+
+  tracing::Span("GstEnginePipeline::Seek", QString::number(id()), start);
+
+}
+
 void GstEnginePipeline::StreamStatusMessageReceived(GstMessage *msg) {
 
   GstStreamStatusType type;
@@ -520,6 +565,7 @@ void GstEnginePipeline::StreamStatusMessageReceived(GstMessage *msg) {
     if (G_VALUE_TYPE(val) == GST_TYPE_TASK) {
       GstTask *task = static_cast<GstTask*>(g_value_get_object(val));
       gst_task_set_enter_callback(task, &TaskEnterCallback, this, NULL);
+      gst_task_set_leave_callback(task, &TaskLeaveCallback, this, NULL);
     }
   }
 
@@ -530,29 +576,95 @@ void GstEnginePipeline::StreamStartMessageReceived() {
   if (next_uri_set_) {
     next_uri_set_ = false;
 
+    const qint64 beginning_offset_nanosec = next_beginning_offset_nanosec_;
+
     media_url_ = next_media_url_;
     original_url_ = next_original_url_;
+    beginning_offset_nanosec_ = qMax(0ll, beginning_offset_nanosec);
     end_offset_nanosec_ = next_end_offset_nanosec_;
     next_media_url_ = QByteArray();
     next_original_url_ = QUrl();
     next_beginning_offset_nanosec_ = 0;
     next_end_offset_nanosec_ = 0;
 
+    // The new song ends before the end of its file, seek to set the stop position.
+    if (end_offset_nanosec_ > 0) {
+      QMetaObject::invokeMethod(this, "Seek", Qt::QueuedConnection, Q_ARG(qint64, beginning_offset_nanosec_));
+    }
+
     emit EndOfStreamReached(id(), true);
   }
 
 }
 
-void GstEnginePipeline::TaskEnterCallback(GstTask *, GThread *, gpointer) {
+void GstEnginePipeline::TaskEnterCallback(GstTask *, GThread *thread, gpointer self) {
 
   // Bump the priority of the thread only on OS X
 
 #ifdef Q_OS_MACOS
+  Q_UNUSED(thread);
+  Q_UNUSED(self);
+
   sched_param param;
   memset(&param, 0, sizeof(param));
 
   param.sched_priority = 99;
   pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+#elif defined(Q_OS_LINUX)
+  GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
+
+  TaskThreadClock task_clock;
+  task_clock.thread = thread;
+  if (pthread_getcpuclockid(pthread_self(), &task_clock.clock) != 0) return;
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  task_clock.start_nanosec = ts.tv_sec * kNsecPerSec + ts.tv_nsec;
+
+  QMutexLocker l(&instance->task_clocks_mutex_);
+  instance->task_clocks_ << task_clock;
+#else
+  Q_UNUSED(thread);
+  Q_UNUSED(self);
+#endif
+
+}
+
+void GstEnginePipeline::TaskLeaveCallback(GstTask *, GThread *thread, gpointer self) {
+
+#ifdef Q_OS_LINUX
+  GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
+
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  const qint64 now_nanosec = ts.tv_sec * kNsecPerSec + ts.tv_nsec;
+
+  QMutexLocker l(&instance->task_clocks_mutex_);
+  for (int i = 0 ; i < instance->task_clocks_.count() ; ++i) {
+    if (instance->task_clocks_[i].thread != thread) continue;
+    instance->finished_tasks_cpu_nanosec_ += now_nanosec - instance->task_clocks_[i].start_nanosec;
+    instance->task_clocks_.removeAt(i);
+    break;
+  }
+#else
+  Q_UNUSED(thread);
+  Q_UNUSED(self);
+#endif
+
+}
+
+qint64 GstEnginePipeline::cpu_time_nanosec() const {
+
+#ifdef Q_OS_LINUX
+  QMutexLocker l(&task_clocks_mutex_);
+  qint64 cpu_nanosec = finished_tasks_cpu_nanosec_;
+  for (const TaskThreadClock &task_clock : task_clocks_) {
+    timespec ts;
+    if (clock_gettime(task_clock.clock, &ts) != 0) continue;
+    cpu_nanosec += ts.tv_sec * kNsecPerSec + ts.tv_nsec - task_clock.start_nanosec;
+  }
+  return cpu_nanosec;
+#else
+  return -1;
 #endif
 
 }
@@ -674,6 +786,11 @@ void GstEnginePipeline::StateChangedMessageReceived(GstMessage *msg) {
     if (pending_seek_nanosec_ != -1 && pipeline_is_connected_) {
       QMetaObject::invokeMethod(this, "Seek", Qt::QueuedConnection, Q_ARG(qint64, pending_seek_nanosec_));
     }
+    else if (end_offset_nanosec_ > 0 && beginning_offset_nanosec_ == 0 && pipeline_is_connected_) {
+      // The song ends before the end of the file, seek to set the stop position.
+      // Songs starting later in the file get that from GstEngine's initial seek.
+      QMetaObject::invokeMethod(this, "Seek", Qt::QueuedConnection, Q_ARG(qint64, 0));
+    }
   }
 
   if (pipeline_is_initialised_ && new_state != GST_STATE_PAUSED && new_state != GST_STATE_PLAYING) {
@@ -803,58 +920,6 @@ GstPadProbeReturn GstEnginePipeline::HandoffCallback(GstPad*, GstPadProbeInfo *i
     consumer->ConsumeBuffer(buf, instance->id());
   }
 
-  // Calculate the end time of this buffer so we can stop playback if it's after the end time of this song.
-  if (instance->end_offset_nanosec_ > 0) {
-    quint64 start_time = GST_BUFFER_TIMESTAMP(buf) - instance->segment_start_;
-    quint64 duration = GST_BUFFER_DURATION(buf);
-    quint64 end_time = start_time + duration;
-
-    if (end_time > instance->end_offset_nanosec_) {
-      if (instance->has_next_valid_url() && instance->next_media_url_ == instance->media_url_ && instance->next_beginning_offset_nanosec_ == instance->end_offset_nanosec_) {
-          // The "next" song is actually the next segment of this file - so cheat and keep on playing, but just tell the Engine we've moved on.
-          instance->end_offset_nanosec_ = instance->next_end_offset_nanosec_;
-          instance->next_media_url_ = QByteArray();
-          instance->next_original_url_ = QUrl();
-          instance->next_beginning_offset_nanosec_ = 0;
-          instance->next_end_offset_nanosec_ = 0;
-
-          // GstEngine will try to seek to the start of the new section, but we're already there so ignore it.
-          instance->ignore_next_seek_ = true;
-          emit instance->EndOfStreamReached(instance->id(), true);
-      }
-      else {
-        // There's no next song
-        emit instance->EndOfStreamReached(instance->id(), false);
-      }
-    }
-  }
-
-  return GST_PAD_PROBE_OK;
-
-}
-
-GstPadProbeReturn GstEnginePipeline::EventHandoffCallback(GstPad*, GstPadProbeInfo *info, gpointer self) {
-
-  GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
-  GstEvent *e = gst_pad_probe_info_get_event(info);
-
-  qLog(Debug) << instance->id() << "event" << GST_EVENT_TYPE_NAME(e);
-
-  switch (GST_EVENT_TYPE(e)) {
-    case GST_EVENT_SEGMENT:
-      if (!instance->segment_start_received_) {
-        // The segment start time is used to calculate the proper offset of data buffers from the start of the stream
-        const GstSegment *segment = nullptr;
-        gst_event_parse_segment(e, &segment);
-        instance->segment_start_ = segment->start;
-        instance->segment_start_received_ = true;
-      }
-      break;
-
-    default:
-      break;
-  }
-
   return GST_PAD_PROBE_OK;
 
 }
@@ -942,11 +1007,6 @@ QFuture<GstStateChangeReturn> GstEnginePipeline::SetState(GstState state) {
 
 bool GstEnginePipeline::Seek(qint64 nanosec) {
 
-  if (ignore_next_seek_) {
-    ignore_next_seek_ = false;
-    return true;
-  }
-
   if (!pipeline_is_connected_ || !pipeline_is_initialised_) {
     pending_seek_nanosec_ = nanosec;
     return true;
@@ -962,10 +1022,99 @@ bool GstEnginePipeline::Seek(qint64 nanosec) {
 
   pending_seek_nanosec_ = -1;
   last_known_position_ns_ = nanosec;
+  seek_trace_start_.store(tracing::Timestamp());
+
+  // The flush drops any SEGMENT_DONE that is still on its way to the sink.
+  pending_section_changes_ = 0;
+
+  if (end_offset_nanosec_ > 0) {
+    // Play only up to the end of the song, the sink clips the last buffer so it stops at the exact sample.
+    return gst_element_seek(pipeline_, 1.0, GST_FORMAT_TIME, GstSeekFlags(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE | GST_SEEK_FLAG_SEGMENT), GST_SEEK_TYPE_SET, nanosec, GST_SEEK_TYPE_SET, end_offset_nanosec_);
+  }
+
   return gst_element_seek_simple(pipeline_, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH, nanosec);
 
 }
 
+void GstEnginePipeline::SegmentDoneMessageReceived() {
+
+  // The decoder reached the end of the song, but the queues still hold the audio before it.
+  if (!has_next_valid_url() || next_media_url_ != media_url_ || next_beginning_offset_nanosec_ != end_offset_nanosec_) {
+    // There's no next song, or it's in another file. SegmentDone() ends the stream when the audio ran out.
+    return;
+  }
+
+  // The "next" song is actually the next segment of this file - so keep on decoding, and tell the Engine we've moved on once the audio got there.
+  beginning_offset_nanosec_ = next_beginning_offset_nanosec_;
+  end_offset_nanosec_ = next_end_offset_nanosec_;
+  next_media_url_ = QByteArray();
+  next_original_url_ = QUrl();
+  next_beginning_offset_nanosec_ = 0;
+  next_end_offset_nanosec_ = 0;
+
+  // A non flushing seek continues right after the data that is still queued, so the transition is seamless.
+  // Without an end position the song plays to the end of the file, which then posts EOS as usual.
+  if (end_offset_nanosec_ > 0) {
+    gst_element_seek(pipeline_, 1.0, GST_FORMAT_TIME, GstSeekFlags(GST_SEEK_FLAG_ACCURATE | GST_SEEK_FLAG_SEGMENT), GST_SEEK_TYPE_SET, beginning_offset_nanosec_, GST_SEEK_TYPE_SET, end_offset_nanosec_);
+  }
+  else {
+    gst_element_seek(pipeline_, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET, beginning_offset_nanosec_, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+  }
+
+  ++pending_section_changes_;
+
+}
+
+GstPadProbeReturn GstEnginePipeline::SegmentDoneCallback(GstPad*, GstPadProbeInfo *info, gpointer self) {
+
+  GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
+
+  GstEvent *e = gst_pad_probe_info_get_event(info);
+  if (GST_EVENT_TYPE(e) == GST_EVENT_SEGMENT_DONE) {
+    QMetaObject::invokeMethod(instance, "SegmentDone", Qt::QueuedConnection);
+  }
+
+  return GST_PAD_PROBE_OK;
+
+}
+
+GstPadProbeReturn GstEnginePipeline::AudioStartCallback(GstPad*, GstPadProbeInfo *info, gpointer self) {
+
+  GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    const qint64 now = tracing::Timestamp();
+    if (instance->audio_start_pending_) {
+      instance->audio_start_pending_ = false;
+      emit instance->AudioStarted(instance->id(), instance->last_audio_trace_time_, now);
+    }
+    instance->last_audio_trace_time_ = now;
+  }
+  else {
+    // A gapless song starts with a new stream, a following section of the same file after SEGMENT_DONE.
+    GstEvent *e = gst_pad_probe_info_get_event(info);
+    if (GST_EVENT_TYPE(e) == GST_EVENT_STREAM_START || GST_EVENT_TYPE(e) == GST_EVENT_SEGMENT_DONE) {
+      instance->audio_start_pending_ = true;
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+
+}
+
+void GstEnginePipeline::SegmentDone() {
+
+  // The last of the song's audio reached the sink.
+  if (pending_section_changes_ > 0) {
+    --pending_section_changes_;
+    emit EndOfStreamReached(id(), true);
+  }
+  else {
+    emit EndOfStreamReached(id(), false);
+  }
+
+}
+
 void GstEnginePipeline::SetEqualizerEnabled(bool enabled) {
 
   eq_enabled_ = enabled;
@@ -34,6 +34,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QMutex>
+#include <QAtomicInteger>
 #include <QThreadPool>
 #include <QFuture>
 #include <QTimeLine>
@@ -45,6 +46,10 @@
 #include <QUrl>
 #include <QTimerEvent>
 
+#ifdef Q_OS_LINUX
+#  include <time.h>
+#endif
+
 using std::unique_ptr;
 
 class GstEngine;
@@ -74,7 +79,10 @@ class GstEnginePipeline : public QObject {
   void set_buffer_min_fill(int percent);
 
   // Creates the pipeline, returns false on error
-  bool InitFromUrl(const QByteArray &media_url, const QUrl original_url, qint64 end_nanosec);
+  // Init() creates the playbin with the audio bin, so a pipeline can be built before it's known what it will play.
+  // InitFromUrl() calls Init() if that wasn't done already and sets the URL to play.
+  bool Init();
+  bool InitFromUrl(const QByteArray &media_url, const QUrl original_url, qint64 beginning_nanosec, qint64 end_nanosec);
   bool InitFromString(const QString &pipeline);
 
   // GstBufferConsumers get fed audio data.  Thread-safe.
@@ -107,7 +115,6 @@ class GstEnginePipeline : public QObject {
   qint64 length() const;
   // Returns this pipeline's state. May return GST_STATE_NULL if the state check timed out. The timeout value is a reasonable default.
   GstState state() const;
-  qint64 segment_start() const { return segment_start_; }
 
   // Don't allow the user to change the playback state (playing/paused) while the pipeline is buffering.
   bool is_buffering() const { return buffering_; }
@@ -116,6 +123,9 @@ class GstEnginePipeline : public QObject {
 
   QString source_device() const { return source_device_; }
 
+  // CPU time used by the streaming threads of this pipeline so far, or -1 if it can't be measured on this system.
+  qint64 cpu_time_nanosec() const;
+
  public slots:
   void SetVolumeModifier(qreal mod);
 
@@ -126,6 +136,9 @@ signals:
   // The message, domain and error_code are related to GStreamer's GError.
   void Error(int pipeline_id, const QString &message, int domain, int error_code);
   void FaderFinished();
+  // Emitted while tracing when the first audio of a song reached the audio sink.
+  // If the pipeline moved on to the song by itself, gap_start is the trace time of the last audio of the song before, otherwise -1.
+  void AudioStarted(int pipeline_id, qint64 gap_start, qint64 end);
 
   void BufferingStarted();
   void BufferingProgress(int percent);
@@ -140,11 +153,13 @@ signals:
   static gboolean BusCallback(GstBus*, GstMessage*, gpointer);
   static void NewPadCallback(GstElement*, GstPad*, gpointer);
   static GstPadProbeReturn HandoffCallback(GstPad*, GstPadProbeInfo*, gpointer);
-  static GstPadProbeReturn EventHandoffCallback(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn SegmentDoneCallback(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn AudioStartCallback(GstPad*, GstPadProbeInfo*, gpointer);
   static void AboutToFinishCallback(GstPlayBin*, gpointer);
   static GstPadProbeReturn DecodebinProbe(GstPad*, GstPadProbeInfo*, gpointer);
   static void SourceSetupCallback(GstPlayBin*, GParamSpec* pspec, gpointer);
   static void TaskEnterCallback(GstTask*, GThread*, gpointer);
+  static void TaskLeaveCallback(GstTask*, GThread*, gpointer);
 
   void TagMessageReceived(GstMessage*);
   void ErrorMessageReceived(GstMessage*);
@@ -153,6 +168,7 @@ signals:
   void BufferingMessageReceived(GstMessage*);
   void StreamStatusMessageReceived(GstMessage*);
   void StreamStartMessageReceived();
+  void AsyncDoneMessageReceived();
 
   QString ParseStrTag(GstTagList *list, const char *tag) const;
   guint ParseUIntTag(GstTagList *list, const char *tag) const;
@@ -167,6 +183,8 @@ signals:
 
  private slots:
   void FaderTimelineFinished();
+  void SegmentDoneMessageReceived();
+  void SegmentDone();
 
  private:
   static const int kGstStateTimeoutNanosecs;
@@ -213,8 +231,6 @@ signals:
   // These get called when there is a new audio buffer available
   QList<GstBufferConsumer*> buffer_consumers_;
   QMutex buffer_consumers_mutex_;
-  qint64 segment_start_;
-  bool segment_start_received_;
 
   // The URL that is currently playing, and the URL that is to be preloaded when the current track is close to finishing.
   QByteArray media_url_;
@@ -222,15 +238,17 @@ signals:
   QByteArray next_media_url_;
   QUrl next_original_url_;
 
-  // If this is > 0 then the pipeline will be forced to stop when playback goes past this position.
+  // Where the current song starts in its file.
+  qint64 beginning_offset_nanosec_;
+  // If this is > 0 then seeks set this as the stop position, and the pipeline posts SEGMENT_DONE when playback reaches it.
   qint64 end_offset_nanosec_;
 
   // We store the beginning and end for the preloading song too, so we can just carry on without reloading the file if the sections carry on from each other.
   qint64 next_beginning_offset_nanosec_;
   qint64 next_end_offset_nanosec_;
 
-  // Set temporarily when moving to the next contiguous section in a multi-part file.
-  bool ignore_next_seek_;
+  // Number of contiguous sections the decoder already moved on to, whose SEGMENT_DONE hasn't reached the audio sink yet.
+  int pending_section_changes_;
 
   // Set temporarily when switching out the decode bin, so metadata doesn't get sent while the Player still thinks it's playing the last song
   bool ignore_tags_;
@@ -245,6 +263,29 @@ signals:
   bool pipeline_is_initialised_;
   bool pipeline_is_connected_;
   qint64 pending_seek_nanosec_;
+  // Trace time of the seek the pipeline is doing, -1 if tracing is disabled.
+  // Set from the main thread and cleared from the sync bus handler.
+  QAtomicInteger<qint64> seek_trace_start_;
+
+  // Only used from the audio sink's streaming thread while tracing.
+  // Set when a new stream or section starts, until its first buffer reaches the sink.
+  bool audio_start_pending_;
+  // Trace time of the last buffer that reached the sink, -1 before the first one.
+  qint64 last_audio_trace_time_;
+
+#ifdef Q_OS_LINUX
+  // CPU clocks of the streaming threads running a task of this pipeline, with their CPU time when the task entered them.
+  // The threads come from a pool and can run other tasks before, so only the time since then counts.
+  struct TaskThreadClock {
+    GThread *thread;
+    clockid_t clock;
+    qint64 start_nanosec;
+  };
+  mutable QMutex task_clocks_mutex_;
+  QList<TaskThreadClock> task_clocks_;
+  // CPU time of the tasks that already left their thread.
+  qint64 finished_tasks_cpu_nanosec_;
+#endif
 
   // We can only use gst_element_query_position() when the pipeline is in
   // PAUSED nor PLAYING state. Whenever we get a new position (e.g. after a correct call to gst_element_query_position() or after a seek), we store
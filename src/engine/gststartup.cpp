@@ -31,6 +31,7 @@
 #include <QDir>
 
 #include "core/utilities.h"
+#include "core/tracing.h"
 
 #ifdef HAVE_MOODBAR
 #  include "ext/gstmoodbar/gstmoodbarplugin.h"
@@ -47,6 +48,8 @@ GstStartup::~GstStartup() {
 
 void GstStartup::InitialiseGStreamer() {
 
+  tracing::ScopedSpan span("GstStartup::InitialiseGStreamer");
+
   SetEnvironment();
 
   gst_init(nullptr, nullptr);
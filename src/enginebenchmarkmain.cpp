@@ -0,0 +1,116 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+#include "core/logging.h"
+#include "core/metatypes.h"
+#include "core/taskmanager.h"
+#include "core/tracing.h"
+#include "engine/enginetype.h"
+#include "engine/enginebenchmark.h"
+
+// Times the audio engines without the rest of the player, the results are written as a Chrome trace.
+int main(int argc, char *argv[]) {
+
+  // Keep the output settings of the benchmark apart from the player's.
+  QCoreApplication::setApplicationName("strawberry-enginebenchmark");
+  QCoreApplication::setOrganizationName("strawberry");
+  QCoreApplication a(argc, argv);
+
+  RegisterMetaTypes();
+
+  logging::Init();
+  g_log_set_default_handler(reinterpret_cast<GLogFunc>(&logging::GLog), nullptr);
+
+  QStringList default_engines;
+  for (const Engine::EngineType enginetype : EngineBenchmark::SupportedEngines()) {
+    default_engines << Engine::EngineName(enginetype);
+  }
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Plays the files with each engine, with the audio going to a null output, and records the time to start playback, change tracks by hand, move on gaplessly and seek, and the CPU time of each stream.");
+  parser.addHelpOption();
+  QCommandLineOption engines_option("engines", "Comma separated list of the engines to run.", "engines", default_engines.join(","));
+  QCommandLineOption trace_option("trace", "Chrome trace file to write the results to.", "file", "enginebenchmark.json");
+  QCommandLineOption no_spare_pipelines_option("no-spare-pipelines", "Build each GStreamer pipeline when it's needed instead of ahead of the track changes.");
+  parser.addOption(engines_option);
+  parser.addOption(trace_option);
+  parser.addOption(no_spare_pipelines_option);
+  parser.addPositionalArgument("files", "Audio files, or directories with audio files.", "files...");
+  parser.process(a);
+
+  QList<QUrl> urls;
+  for (const QString &path : parser.positionalArguments()) {
+    QFileInfo fileinfo(path);
+    if (fileinfo.isDir()) {
+      QStringList filenames;
+      QDirIterator it(path, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+      while (it.hasNext()) filenames << it.next();
+      filenames.sort();
+      for (const QString &filename : filenames) urls << QUrl::fromLocalFile(QFileInfo(filename).absoluteFilePath());
+    }
+    else {
+      urls << QUrl::fromLocalFile(fileinfo.absoluteFilePath());
+    }
+  }
+  if (urls.count() < 2) {
+    qLog(Error) << "At least two files are needed to change tracks";
+    return 1;
+  }
+
+  QList<Engine::EngineType> enginetypes;
+  for (const QString &name : parser.value(engines_option).split(',', QString::SkipEmptyParts)) {
+    const Engine::EngineType enginetype = Engine::EngineTypeFromName(name.trimmed());
+    if (!EngineBenchmark::SupportedEngines().contains(enginetype)) {
+      qLog(Error) << "Unsupported engine" << name;
+      return 1;
+    }
+    enginetypes << enginetype;
+  }
+
+  tracing::SetOutputFile(parser.value(trace_option));
+
+  TaskManager task_manager;
+  EngineBenchmark benchmark(&task_manager);
+  benchmark.set_spare_pipelines(!parser.isSet(no_spare_pipelines_option));
+
+  bool success = true;
+  for (const Engine::EngineType enginetype : enginetypes) {
+    if (!benchmark.Run(enginetype, urls)) success = false;
+  }
+
+  tracing::Write();
+
+  return success ? 0 : 1;
+
+}
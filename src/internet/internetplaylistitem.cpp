@@ -31,7 +31,7 @@
 #include "internetservices.h"
 #include "internetservice.h"
 #include "core/settingsprovider.h"
-#include "collection/sqlrow.h"
+#include "core/sqlitequery.h"
 #include "playlist/playlistbackend.h"
 
 InternetPlaylistItem::InternetPlaylistItem(const Song::Source &source)
@@ -44,7 +44,7 @@ InternetPlaylistItem::InternetPlaylistItem(InternetService *service, const Song
   InitMetadata();
 }
 
-bool InternetPlaylistItem::InitFromQuery(const SqlRow &query) {
+bool InternetPlaylistItem::InitFromQuery(const SqliteQuery &query) {
   metadata_.InitFromQuery(query, false, (Song::kColumns.count() + 1) * 1);
   InitMetadata();
   return true;
@@ -37,7 +37,7 @@ class InternetPlaylistItem : public PlaylistItem {
  public:
   explicit InternetPlaylistItem(const Song::Source &type);
   InternetPlaylistItem(InternetService *service, const Song &metadata);
-  bool InitFromQuery(const SqlRow &query);
+  bool InitFromQuery(const SqliteQuery &query);
   Song Metadata() const;
   QUrl Url() const;
 
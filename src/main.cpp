@@ -73,6 +73,7 @@
 #include "main.h"
 
 #include "core/logging.h"
+#include "core/tracing.h"
 
 #include <singleapplication.h>
 #include <singlecoreapplication.h>
@@ -140,6 +141,7 @@ int main(int argc, char* argv[]) {
     // Parse commandline options - need to do this before starting the full QApplication so it works without an X server
     if (!options.Parse()) return 1;
     logging::SetLevels(options.log_levels());
+    if (!options.trace_file().isEmpty()) tracing::SetOutputFile(options.trace_file());
     if (core_app.isSecondary()) {
       if (options.is_empty()) {
         qLog(Info) << "Strawberry is already running - activating existing window (1)";
@@ -264,5 +266,7 @@ int main(int argc, char* argv[]) {
 
   int ret = a.exec();
 
+  tracing::Write();
+
   return ret;
 }
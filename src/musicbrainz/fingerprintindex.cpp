@@ -0,0 +1,170 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <chromaprint.h>
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QString>
+
+#include "fingerprintindex.h"
+
+const int FingerprintIndex::kHashedItems = 120;
+const int FingerprintIndex::kMinSharedHashes = 3;
+const int FingerprintIndex::kMaxHashFingerprints = 50;
+const int FingerprintIndex::kComparedItems = 240;
+const int FingerprintIndex::kMaxOffset = 8;
+const int FingerprintIndex::kMinOverlap = 50;
+const double FingerprintIndex::kMaxBitErrorRate = 0.15;
+
+FingerprintIndex::FingerprintIndex() {}
+
+QVector<quint32> FingerprintIndex::Decode(const QString &fingerprint) {
+
+  QVector<quint32> ret;
+
+  QByteArray encoded = fingerprint.toLatin1();
+  if (encoded.isEmpty()) return ret;
+
+#if CHROMAPRINT_VERSION_MAJOR >= 1 && CHROMAPRINT_VERSION_MINOR >= 4
+  uint32_t *raw = nullptr;
+#else
+  void *raw = nullptr;
+#endif
+  int size = 0;
+  int algorithm = 0;
+
+  if (chromaprint_decode_fingerprint(encoded.data(), encoded.size(), &raw, &size, &algorithm, 1) != 1) return ret;
+
+  const uint32_t *items = reinterpret_cast<const uint32_t*>(raw);
+  ret.reserve(size);
+  for (int i = 0 ; i < size ; ++i) {
+    ret << items[i];
+  }
+  chromaprint_dealloc(raw);
+
+  return ret;
+
+}
+
+double FingerprintIndex::BitErrorRate(const QVector<quint32> &fingerprint1, const QVector<quint32> &fingerprint2) {
+
+  double best = 1.0;
+
+  for (int offset = -kMaxOffset ; offset <= kMaxOffset ; ++offset) {
+    const int begin1 = qMax(0, offset);
+    const int begin2 = qMax(0, -offset);
+    const int overlap = qMin(fingerprint1.count() - begin1, fingerprint2.count() - begin2);
+    if (overlap < kMinOverlap) continue;
+
+    int errors = 0;
+    for (int i = 0 ; i < overlap ; ++i) {
+      errors += qPopulationCount(fingerprint1[begin1 + i] ^ fingerprint2[begin2 + i]);
+    }
+    best = qMin(best, static_cast<double>(errors) / (32.0 * overlap));
+  }
+
+  return best;
+
+}
+
+void FingerprintIndex::Add(const int id, const QVector<quint32> &fingerprint) {
+
+  const quint32 index = ids_.count();
+  ids_ << id;
+  fingerprints_ << fingerprint.mid(0, kComparedItems);
+
+  const int items = qMin(fingerprint.count(), kHashedItems);
+  for (int i = 0 ; i + 1 < items ; ++i) {
+    const quint32 item1 = fingerprint[i];
+    const quint32 item2 = fingerprint[i + 1];
+    // One hash from the high and one from the low half of the bits, so a few differing bits don't lose both.
+    // Hashes from the two halves can collide, that only adds candidates which are compared anyway.
+    hashes_ << (static_cast<quint64>((item1 & 0xFFFF0000) | (item2 >> 16)) << 32 | index);
+    hashes_ << (static_cast<quint64>((item1 << 16) | (item2 & 0x0000FFFF)) << 32 | index);
+  }
+
+}
+
+QList<QList<int>> FingerprintIndex::FindDuplicates() {
+
+  std::sort(hashes_.begin(), hashes_.end());
+
+  // Count the hashes each pair of fingerprints shares.
+  QHash<quint64, int> shared_hashes;
+  QVector<quint32> fingerprints;
+  int i = 0;
+  while (i < hashes_.count()) {
+    const quint64 hash = hashes_[i] >> 32;
+    fingerprints.clear();
+    for (; i < hashes_.count() && hashes_[i] >> 32 == hash ; ++i) {
+      const quint32 index = hashes_[i] & 0xFFFFFFFF;
+      if (fingerprints.isEmpty() || fingerprints.last() != index) fingerprints << index;
+    }
+    if (fingerprints.count() < 2 || fingerprints.count() > kMaxHashFingerprints) continue;
+
+    for (int j = 0 ; j < fingerprints.count() ; ++j) {
+      for (int k = j + 1 ; k < fingerprints.count() ; ++k) {
+        ++shared_hashes[static_cast<quint64>(fingerprints[j]) << 32 | fingerprints[k]];
+      }
+    }
+  }
+
+  // Group the matching fingerprints with a union-find.
+  QVector<int> parents(ids_.count());
+  for (int j = 0 ; j < parents.count() ; ++j) parents[j] = j;
+  auto find = [&parents](int index) {
+    while (parents[index] != index) {
+      parents[index] = parents[parents[index]];
+      index = parents[index];
+    }
+    return index;
+  };
+
+  for (QHash<quint64, int>::const_iterator it = shared_hashes.constBegin() ; it != shared_hashes.constEnd() ; ++it) {
+    if (it.value() < kMinSharedHashes) continue;
+    const int root1 = find(it.key() >> 32);
+    const int root2 = find(it.key() & 0xFFFFFFFF);
+    if (root1 == root2) continue;
+    if (BitErrorRate(fingerprints_[it.key() >> 32], fingerprints_[it.key() & 0xFFFFFFFF]) <= kMaxBitErrorRate) {
+      parents[root1] = root2;
+    }
+  }
+
+  QMap<int, QList<int>> groups;
+  for (int j = 0 ; j < ids_.count() ; ++j) {
+    groups[find(j)] << ids_[j];
+  }
+
+  QList<QList<int>> ret;
+  for (const QList<int> &group : groups) {
+    if (group.count() > 1) ret << group;
+  }
+
+  return ret;
+
+}
@@ -0,0 +1,73 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FINGERPRINTINDEX_H
+#define FINGERPRINTINDEX_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+#include <QString>
+
+// Finds songs with the same audio by comparing their raw Chromaprint fingerprints.
+// Comparing every fingerprint with every other one is too slow for a collection, so locality sensitive hashing is used to find candidates:
+// every pair of consecutive items is hashed from a sample of their bits, fingerprints with a few equal hashes are then compared bit by bit.
+// The hashes don't depend on the position of the items, so files with a slightly different start are found too.
+class FingerprintIndex {
+
+ public:
+  FingerprintIndex();
+
+  // Number of items from the start of each fingerprint that are hashed, each item covers about 0.12 seconds.
+  static const int kHashedItems;
+  // Fingerprints sharing at least this many hashes are compared.
+  static const int kMinSharedHashes;
+  // Hashes shared by more fingerprints than this are ignored, they come from silence or noise.
+  static const int kMaxHashFingerprints;
+  // Number of items from the start of each fingerprint that are kept to compare the candidates, the rest isn't needed and would only take memory.
+  static const int kComparedItems;
+  // Number of items the fingerprints are shifted against each other when comparing.
+  static const int kMaxOffset;
+  static const int kMinOverlap;
+  // Fingerprints of the same audio differ in a few bits from different encodings, unrelated audio differs in about half of them.
+  static const double kMaxBitErrorRate;
+
+  // Decodes a fingerprint as returned by Chromaprinter, returns an empty vector if it's invalid.
+  static QVector<quint32> Decode(const QString &fingerprint);
+
+  // Returns the lowest fraction of differing bits of the two fingerprints at any offset, or 1.0 if they're too short to compare.
+  static double BitErrorRate(const QVector<quint32> &fingerprint1, const QVector<quint32> &fingerprint2);
+
+  void Add(const int id, const QVector<quint32> &fingerprint);
+  int count() const { return ids_.count(); }
+
+  // Returns the IDs of the fingerprints that match each other in groups.
+  QList<QList<int>> FindDuplicates();
+
+ private:
+  QList<int> ids_;
+  // The start of each fingerprint, up to kComparedItems.
+  QList<QVector<quint32>> fingerprints_;
+  // Hash in the high and fingerprint index in the low 32 bits, sorted to find the fingerprints sharing a hash.
+  QVector<quint64> hashes_;
+
+};
+
+#endif  // FINGERPRINTINDEX_H
@@ -0,0 +1,288 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVariant>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "core/application.h"
+#include "core/closure.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/taskmanager.h"
+#include "collection/collectionbackend.h"
+#include "chromaprinter.h"
+#include "fingerprintindex.h"
+#include "fingerprintstore.h"
+
+FingerprintStore::FingerprintStore(Application *app, QObject *parent)
+    : QObject(parent),
+      app_(app),
+      db_(app->database()),
+      thread_pool_(new QThreadPool(this)),
+      cancel_(0),
+      files_total_(0),
+      files_done_(0),
+      task_id_(-1),
+      finding_duplicates_(false) {
+
+  // Use every core, the threads run at a low priority so decoding doesn't slow down playback and the rest of the application.
+  thread_pool_->setMaxThreadCount(QThread::idealThreadCount());
+
+}
+
+FingerprintStore::~FingerprintStore() {
+
+  // The files being fingerprinted use the store, wait for them before it's gone.
+  cancel_ = 1;
+  thread_pool_->waitForDone();
+
+}
+
+void FingerprintStore::FingerprintRunnable::run() {
+
+  QThread::currentThread()->setPriority(QThread::LowPriority);
+
+  // Files that were still queued when fingerprinting was cancelled are only counted.
+  if (!store_->cancel_.load()) store_->GetFingerprint(filename_);
+  QMetaObject::invokeMethod(store_, "FileFingerprinted", Qt::QueuedConnection);
+
+}
+
+QString FingerprintStore::GetFingerprint(const QString &filename) {
+
+  const QFileInfo file_info(filename);
+  if (!file_info.exists()) return QString();
+
+  const QUrl url = QUrl::fromLocalFile(filename);
+  const uint mtime = file_info.lastModified().toTime_t();
+
+  QString fingerprint = LoadFingerprint(url, mtime);
+  if (!fingerprint.isEmpty()) return fingerprint;
+
+  // Failures aren't saved, decoding can also fail when the file is busy.
+  fingerprint = Chromaprinter(filename).CreateFingerprint();
+  if (!fingerprint.isEmpty()) SaveFingerprint(url, mtime, fingerprint);
+
+  return fingerprint;
+
+}
+
+QString FingerprintStore::LoadFingerprint(const QUrl &url, const uint mtime) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.prepare("SELECT fingerprint FROM fingerprints WHERE filename = :filename AND mtime = :mtime");
+  q.bindValue(":filename", url.toEncoded());
+  q.bindValue(":mtime", mtime);
+  q.exec();
+  if (db_->CheckErrors(q)) return QString();
+  if (!q.next()) return QString();
+
+  return q.value(0).toString();
+
+}
+
+void FingerprintStore::SaveFingerprint(const QUrl &url, const uint mtime, const QString &fingerprint) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.prepare("INSERT OR REPLACE INTO fingerprints (filename, mtime, fingerprint) VALUES (:filename, :mtime, :fingerprint)");
+  q.bindValue(":filename", url.toEncoded());
+  q.bindValue(":mtime", mtime);
+  q.bindValue(":fingerprint", fingerprint);
+  q.exec();
+  db_->CheckErrors(q);
+
+}
+
+QStringList FingerprintStore::FilesWithoutFingerprint() {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Songs that were modified after the fingerprint was created are included too, GetFingerprint() compares the mtime of the file itself.
+  QSqlQuery q(db);
+  q.prepare("SELECT DISTINCT songs.filename FROM songs LEFT JOIN fingerprints ON songs.filename = fingerprints.filename WHERE songs.unavailable = 0 AND songs.filename LIKE 'file:%' AND (fingerprints.filename IS NULL OR fingerprints.mtime < songs.mtime)");
+  q.exec();
+  if (db_->CheckErrors(q)) return QStringList();
+
+  QStringList files;
+  while (q.next()) {
+    files << QUrl::fromEncoded(q.value(0).toByteArray()).toLocalFile();
+  }
+
+  return files;
+
+}
+
+void FingerprintStore::FingerprintCollection() {
+
+  if (is_running()) return;
+
+  task_id_ = app_->task_manager()->StartTask(tr("Fingerprinting collection"));
+
+  QFuture<QStringList> future = QtConcurrent::run(this, &FingerprintStore::FilesWithoutFingerprint);
+  NewClosure(future, this, SLOT(FilesFound(QFuture<QStringList>)), future);
+
+}
+
+void FingerprintStore::FilesFound(QFuture<QStringList> future) {
+
+  if (!is_running()) return;
+
+  const QStringList files = future.result();
+  if (files.isEmpty()) {
+    FingerprintFinished();
+    return;
+  }
+
+  qLog(Debug) << "Fingerprinting" << files.count() << "files";
+
+  cancel_ = 0;
+  files_total_ = files.count();
+  files_done_ = 0;
+  for (const QString &filename : files) {
+    thread_pool_->start(new FingerprintRunnable(this, filename));
+  }
+
+}
+
+void FingerprintStore::FileFingerprinted() {
+
+  if (files_total_ == 0) return;
+
+  ++files_done_;
+  app_->task_manager()->SetTaskProgress(task_id_, files_done_, files_total_);
+
+  if (files_done_ >= files_total_) FingerprintFinished();
+
+}
+
+void FingerprintStore::FingerprintFinished() {
+
+  files_total_ = 0;
+  files_done_ = 0;
+
+  if (task_id_ != -1) {
+    app_->task_manager()->SetTaskFinished(task_id_);
+    task_id_ = -1;
+  }
+
+  emit FingerprintsUpdated();
+
+}
+
+void FingerprintStore::Cancel() {
+
+  if (files_total_ > 0) {
+    // The files being decoded finish first, the last one ends the task.
+    cancel_ = 1;
+  }
+  else if (is_running()) {
+    FingerprintFinished();
+  }
+
+}
+
+void FingerprintStore::FindDuplicatesAsync() {
+
+  if (finding_duplicates_) return;
+  finding_duplicates_ = true;
+
+  QFuture<SongList> future = QtConcurrent::run(this, &FingerprintStore::FindDuplicates);
+  NewClosure(future, this, SLOT(FindDuplicatesFinished(QFuture<SongList>)), future);
+
+}
+
+SongList FingerprintStore::FindDuplicates() {
+
+  const int task_id = app_->task_manager()->StartTask(tr("Looking for duplicates"));
+
+  FingerprintIndex index;
+  {
+    QMutexLocker l(db_->Mutex());
+    QSqlDatabase db(db_->Connect());
+
+    // Songs from a cue sheet are left out, the fingerprint is from the start of the whole file.
+    // Fingerprints older than the song are left out too, the file was changed since and they may not match its audio anymore.
+    QSqlQuery q(db);
+    q.prepare("SELECT songs.ROWID, fingerprints.fingerprint FROM songs INNER JOIN fingerprints ON songs.filename = fingerprints.filename WHERE songs.unavailable = 0 AND (songs.cue_path IS NULL OR songs.cue_path = '') AND fingerprints.mtime >= songs.mtime");
+    q.exec();
+    if (!db_->CheckErrors(q)) {
+      while (q.next()) {
+        const QVector<quint32> fingerprint = FingerprintIndex::Decode(q.value(1).toString());
+        if (!fingerprint.isEmpty()) index.Add(q.value(0).toInt(), fingerprint);
+      }
+    }
+  }
+
+  const QList<QList<int>> groups = index.FindDuplicates();
+  qLog(Debug) << "Found" << groups.count() << "groups of duplicates in" << index.count() << "fingerprints";
+
+  QList<int> ids;
+  for (const QList<int> &group : groups) {
+    ids << group;
+  }
+
+  QHash<int, Song> songs_by_id;
+  for (const Song &song : app_->collection_backend()->GetSongsById(ids)) {
+    songs_by_id.insert(song.id(), song);
+  }
+
+  SongList songs;
+  for (const int id : ids) {
+    if (songs_by_id.contains(id)) songs << songs_by_id[id];
+  }
+
+  app_->task_manager()->SetTaskFinished(task_id);
+
+  return songs;
+
+}
+
+void FingerprintStore::FindDuplicatesFinished(QFuture<SongList> future) {
+
+  finding_duplicates_ = false;
+  emit DuplicatesFound(future.result());
+
+}
@@ -0,0 +1,114 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FINGERPRINTSTORE_H
+#define FINGERPRINTSTORE_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QFuture>
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+#include "core/song.h"
+
+class QThreadPool;
+
+class Application;
+class Database;
+
+// Keeps the Chromaprint fingerprints of local files in the database, keyed on the file and its modification time.
+// A file is only decoded again when it has been modified since it was fingerprinted.
+class FingerprintStore : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit FingerprintStore(Application *app, QObject *parent = nullptr);
+  ~FingerprintStore();
+
+  // Returns the fingerprint of a local file, creating and saving it if there is no up to date one in the database.
+  // This method is blocking, so you want to call it in another thread.
+  // Returns an empty string if no fingerprint could be created.
+  QString GetFingerprint(const QString &filename);
+
+  // Creates fingerprints through the store with QtConcurrent::mapped, for the few songs of a tag fetch that need the results.
+  struct Fingerprinter {
+    typedef QString result_type;
+    explicit Fingerprinter(FingerprintStore *store) : store_(store) {}
+    QString operator()(const QString &filename) const { return store_->GetFingerprint(filename); }
+    FingerprintStore *store_;
+  };
+
+  bool is_running() const { return task_id_ != -1; }
+
+ public slots:
+  // Fingerprints all local songs in the collection that don't have an up to date fingerprint in the background.
+  void FingerprintCollection();
+  void Cancel();
+
+  // Looks for songs with the same audio among the fingerprinted songs in the collection.
+  void FindDuplicatesAsync();
+
+ signals:
+  void FingerprintsUpdated();
+  // The duplicates are grouped, the songs of each group follow each other.
+  void DuplicatesFound(const SongList &songs);
+
+ private slots:
+  void FilesFound(QFuture<QStringList> future);
+  void FileFingerprinted();
+  void FingerprintFinished();
+  void FindDuplicatesFinished(QFuture<SongList> future);
+
+ private:
+  // Fingerprints one file in the store's thread pool, the fingerprint only goes to the database.
+  class FingerprintRunnable : public QRunnable {
+   public:
+    FingerprintRunnable(FingerprintStore *store, const QString &filename) : store_(store), filename_(filename) {}
+    void run();
+
+   private:
+    FingerprintStore *store_;
+    QString filename_;
+  };
+
+  QStringList FilesWithoutFingerprint();
+  QString LoadFingerprint(const QUrl &url, const uint mtime);
+  void SaveFingerprint(const QUrl &url, const uint mtime, const QString &fingerprint);
+  SongList FindDuplicates();
+
+  Application *app_;
+  Database *db_;
+
+  QThreadPool *thread_pool_;
+  QAtomicInt cancel_;
+  int files_total_;
+  int files_done_;
+  int task_id_;
+  bool finding_duplicates_;
+
+};
+
+#endif  // FINGERPRINTSTORE_H
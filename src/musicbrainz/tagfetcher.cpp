@@ -25,16 +25,18 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QString>
+#include <QStringList>
 #include <QUrl>
 
 #include "core/timeconstants.h"
 #include "acoustidclient.h"
-#include "chromaprinter.h"
+#include "fingerprintstore.h"
 #include "musicbrainzclient.h"
 #include "tagfetcher.h"
 
-TagFetcher::TagFetcher(QObject *parent)
+TagFetcher::TagFetcher(FingerprintStore *fingerprint_store, QObject *parent)
     : QObject(parent),
+      fingerprint_store_(fingerprint_store),
       fingerprint_watcher_(nullptr),
       acoustid_client_(new AcoustidClient(this)),
       musicbrainz_client_(new MusicBrainzClient(this)) {
@@ -44,17 +46,19 @@ TagFetcher::TagFetcher(QObject *parent)
 
 }
 
-QString TagFetcher::GetFingerprint(const Song &song) {
-  return Chromaprinter(song.url().toLocalFile()).CreateFingerprint();
-}
-
 void TagFetcher::StartFetch(const SongList &songs) {
 
   Cancel();
 
   songs_ = songs;
 
-  QFuture<QString> future = QtConcurrent::mapped(songs_, GetFingerprint);
+  QStringList filenames;
+  for (const Song &song : songs_) {
+    filenames << song.url().toLocalFile();
+  }
+
+  // Songs that have been fingerprinted before aren't decoded again.
+  QFuture<QString> future = QtConcurrent::mapped(filenames, FingerprintStore::Fingerprinter(fingerprint_store_));
   fingerprint_watcher_ = new QFutureWatcher<QString>(this);
   fingerprint_watcher_->setFuture(future);
   connect(fingerprint_watcher_, SIGNAL(resultReadyAt(int)), SLOT(FingerprintFound(int)));
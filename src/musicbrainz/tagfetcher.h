@@ -32,6 +32,7 @@
 #include "musicbrainzclient.h"
 
 class AcoustidClient;
+class FingerprintStore;
 
 class TagFetcher : public QObject {
   Q_OBJECT
@@ -39,7 +40,7 @@ class TagFetcher : public QObject {
   // High level interface to Fingerprinter, AcoustidClient and MusicBrainzClient.
 
  public:
-  TagFetcher(QObject *parent = nullptr);
+  TagFetcher(FingerprintStore *fingerprint_store, QObject *parent = nullptr);
 
   void StartFetch(const SongList &songs);
 
@@ -56,8 +57,7 @@ signals:
   void TagsFetched(int index, const MusicBrainzClient::ResultList &result);
 
  private:
-  static QString GetFingerprint(const Song &song);
-
+  FingerprintStore *fingerprint_store_;
   QFutureWatcher<QString> *fingerprint_watcher_;
   AcoustidClient *acoustid_client_;
   MusicBrainzClient *musicbrainz_client_;
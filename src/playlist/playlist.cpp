@@ -68,6 +68,7 @@
 #include "core/tagreaderclient.h"
 #include "core/song.h"
 #include "core/timeconstants.h"
+#include "core/tracing.h"
 #include "collection/collection.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionplaylistitem.h"
@@ -137,6 +138,9 @@ Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, Collecti
       undo_stack_(new QUndoStack(this)),
       special_type_(special_type),
       cancel_restore_(false),
+      restore_state_(Restore_Deferred),
+      stub_song_count_(0),
+      stub_length_nanosec_(0),
       scrobbled_(false),
       nowplaying_(false),
       scrobble_point_(-1) {
@@ -146,8 +150,6 @@ Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, Collecti
   connect(this, SIGNAL(rowsInserted(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
   connect(this, SIGNAL(rowsRemoved(const QModelIndex&, int, int)), SIGNAL(PlaylistChanged()));
 
-  Restore();
-
   proxy_->setSourceModel(this);
   queue_->setSourceModel(this);
 
@@ -614,6 +616,7 @@ void Playlist::set_current_row(int i, bool is_stopping) {
 
   if (current_item_index_.isValid() && !is_stopping) {
     InformOfCurrentSongChange();
+    shuffler_.AddToHistory(current_item());
   }
 
   if (current_item_index_.isValid()) {
@@ -859,6 +862,9 @@ void Playlist::InsertItems(const PlaylistItemList &itemsIn, int pos, bool play_n
   if (itemsIn.isEmpty())
     return;
 
+  // Edits have to apply to the restored items, otherwise the next save would replace the stored playlist with just these.
+  EnsureRestored(true);
+
   PlaylistItemList items = itemsIn;
 
   // exercise vetoes
@@ -924,7 +930,6 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, int pos, bo
   for (int i = start; i <= end; ++i) {
     PlaylistItemPtr item = items[i - start];
     items_.insert(i, item);
-    virtual_items_ << virtual_items_.count();
 
     if (item->source() == Song::Source_Collection) {
       int id = item->Metadata().id();
@@ -941,6 +946,10 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, int pos, bo
   }
   endInsertRows();
 
+  // Merge the new items into the play order instead of reshuffling the whole playlist.
+  shuffler_.Insert(playlist_sequence_ ? playlist_sequence_->shuffle_mode() : PlaylistSequence::Shuffle_Off, items_, &virtual_items_, current_virtual_index_ + 1, start, items.count());
+  if (current_row() != -1) current_virtual_index_ = virtual_items_.indexOf(current_row());
+
   if (enqueue) {
     QModelIndexList indexes;
     for (int i = start; i <= end; ++i) {
@@ -958,7 +967,6 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, int pos, bo
   }
 
   Save();
-  ReshuffleIndices();
 
 }
 
@@ -1279,7 +1287,8 @@ void Playlist::SetCurrentIsPaused(bool paused) {
 }
 
 void Playlist::Save() const {
-  if (!backend_ || is_loading_) return;
+  // A stub or a playlist that is still being restored doesn't have all its songs, saving it would remove them from the database.
+  if (!backend_ || is_loading_ || restore_state_ != Restore_Finished) return;
 
   backend_->SavePlaylistAsync(id_, items_, last_played_row());
 
@@ -1287,23 +1296,95 @@ void Playlist::Save() const {
 
 void Playlist::Restore() {
 
-  if (!backend_) return;
+  if (!backend_) {
+    restore_state_ = Restore_Finished;
+    return;
+  }
 
   items_.clear();
   virtual_items_.clear();
   collection_items_by_id_.clear();
+  shuffler_.Clear();
 
   cancel_restore_ = false;
-  QFuture<QList<PlaylistItemPtr>> future = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
-  NewClosure(future, this, SLOT(ItemsLoaded(QFuture<PlaylistItemList>)), future);
+  restore_state_ = Restore_Loading;
+  restore_future_ = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
+  NewClosure(restore_future_, this, SLOT(ItemsLoaded(QFuture<PlaylistItemList>)), restore_future_);
+
+}
+
+void Playlist::EnsureRestored(const bool wait) {
+
+  switch (restore_state_) {
+    case Restore_Finished:
+      break;
+
+    case Restore_Deferred:
+      if (!backend_ || !wait) {
+        Restore();
+      }
+      else {
+        items_.clear();
+        virtual_items_.clear();
+        collection_items_by_id_.clear();
+        shuffler_.Clear();
+        RestoreItems(backend_->GetPlaylistItems(id_));
+      }
+      break;
+
+    case Restore_Loading:
+      if (wait) {
+        // Take over from the pending ItemsLoaded call.
+        cancel_restore_ = true;
+        restore_future_.waitForFinished();
+        RestoreItems(restore_future_.result());
+      }
+      break;
+  }
+
+}
+
+void Playlist::Unload() {
+
+  if (restore_state_ != Restore_Finished || !queue_->is_empty()) return;
+
+  SetStubSummary(items_.count(), GetTotalLength());
+
+  beginResetModel();
+  items_.clear();
+  virtual_items_.clear();
+  collection_items_by_id_.clear();
+  shuffler_.Clear();
+  current_virtual_index_ = -1;
+  endResetModel();
+
+  undo_stack_->clear();
+  restore_state_ = Restore_Deferred;
+
+}
+
+void Playlist::SetStubSummary(const int song_count, const quint64 length_nanosec) {
+
+  stub_song_count_ = song_count;
+  stub_length_nanosec_ = length_nanosec;
 
 }
 
 void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
 
-  if (cancel_restore_) return;
+  // The future is stale if the playlist was unloaded and restored again in the meantime.
+  if (cancel_restore_ || future != restore_future_) return;
+
+  RestoreItems(future.result());
+
+}
+
+void Playlist::RestoreItems(PlaylistItemList items) {
 
-  PlaylistItemList items = future.result();
+  tracing::ScopedSpan span("Playlist::RestoreItems", QString::number(id_));
+
+  restore_state_ = Restore_Finished;
+  restore_future_ = QFuture<PlaylistItemList>();
 
   // Backend returns empty elements for collection items which it couldn't match (because they got deleted); we don't need those
   QMutableListIterator<PlaylistItemPtr> it(items);
@@ -1365,6 +1446,8 @@ void Playlist::RemoveItemsWithoutUndo(const QList<int> &indicesIn) {
 
 bool Playlist::removeRows(int row, int count, const QModelIndex &parent) {
 
+  EnsureRestored(true);
+
   if (row < 0 || row >= items_.size() || row + count > items_.size()) {
     return false;
   }
@@ -1437,6 +1520,8 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(int row, int count) {
 
   endRemoveRows();
 
+  shuffler_.Remove(ret);
+
   QList<int>::iterator it = virtual_items_.begin();
   while (it != virtual_items_.end()) {
     if (*it >= items_.count())
@@ -1550,6 +1635,7 @@ void Playlist::Clear() {
 
   // If loading songs from session restore async, don't insert them
   cancel_restore_ = true;
+  restore_state_ = Restore_Finished;
 
   const int count = items_.count();
 
@@ -1646,18 +1732,6 @@ void Playlist::Shuffle() {
 
 }
 
-namespace {
-bool AlbumShuffleComparator(const QMap<QString, int> &album_key_positions, const QMap<int, QString> &album_keys, int left, int right) {
-
-  const int left_pos = album_key_positions[album_keys[left]];
-  const int right_pos = album_key_positions[album_keys[right]];
-
-  if (left_pos == right_pos) return left < right;
-  return left_pos < right_pos;
-
-}
-}
-
 void Playlist::ReshuffleIndices() {
 
   if (!playlist_sequence_) {
@@ -1672,60 +1746,8 @@ void Playlist::ReshuffleIndices() {
     return;
   }
 
-  // If the user is already playing a song, advance the begin iterator to only shuffle items that haven't been played yet.
-  QList<int>::iterator begin = virtual_items_.begin();
-  QList<int>::iterator end = virtual_items_.end();
-  if (current_virtual_index_ != -1)
-    std::advance(begin, current_virtual_index_ + 1);
-
-  switch (playlist_sequence_->shuffle_mode()) {
-    case PlaylistSequence::Shuffle_Off:
-      // Handled above.
-      break;
-
-    case PlaylistSequence::Shuffle_All:
-    case PlaylistSequence::Shuffle_InsideAlbum:
-      std::random_shuffle(begin, end);
-      break;
-
-    case PlaylistSequence::Shuffle_Albums: {
-      QMap<int, QString> album_keys;  // real index -> key
-      QSet<QString> album_key_set;    // unique keys
-
-      // Find all the unique albums in the playlist
-      for (QList<int>::iterator it = begin; it != end; ++it) {
-        const int index = *it;
-        const QString key = items_[index]->Metadata().AlbumKey();
-        album_keys[index] = key;
-        album_key_set << key;
-      }
-
-      // Shuffle them
-      QStringList shuffled_album_keys = album_key_set.toList();
-      std::random_shuffle(shuffled_album_keys.begin(), shuffled_album_keys.end());
-
-      // If the user is currently playing a song, force its album to be first
-      // Or if the song was not playing but it was selected, force its album to be first.
-      if (current_virtual_index_ != -1 || current_row() != -1) {
-        const QString key = items_[current_row()]->Metadata().AlbumKey();
-        const int pos = shuffled_album_keys.indexOf(key);
-        if (pos >= 1) {
-          std::swap(shuffled_album_keys[0], shuffled_album_keys[pos]);
-        }
-      }
-
-      // Create album key -> position mapping for fast lookup
-      QMap<QString, int> album_key_positions;
-      for (int i = 0; i < shuffled_album_keys.count(); ++i) {
-        album_key_positions[shuffled_album_keys[i]] = i;
-      }
-
-      // Sort the virtual items
-      std::stable_sort(begin, end, std::bind(AlbumShuffleComparator, album_key_positions, album_keys, _1, _2));
-
-      break;
-    }
-  }
+  // If the user is already playing a song, only shuffle items that haven't been played yet.
+  shuffler_.Shuffle(playlist_sequence_->shuffle_mode(), items_, &virtual_items_, current_virtual_index_ + 1, current_row());
 
 }
 
@@ -1750,7 +1772,12 @@ SongList Playlist::GetAllSongs() const {
 
 PlaylistItemList Playlist::GetAllItems() const { return items_; }
 
+int Playlist::song_count() const {
+  return restore_state_ == Restore_Finished ? items_.count() : stub_song_count_;
+}
+
 quint64 Playlist::GetTotalLength() const {
+  if (restore_state_ != Restore_Finished) return stub_length_nanosec_;
   quint64 ret = 0;
   for (const PlaylistItemPtr item : items_) {
     quint64 length = item->Metadata().length_nanosec();
@@ -47,6 +47,7 @@
 #include "core/tagreaderclient.h"
 #include "playlistitem.h"
 #include "playlistsequence.h"
+#include "playlistshuffler.h"
 
 class CollectionBackend;
 class PlaylistBackend;
@@ -142,6 +143,13 @@ class Playlist : public QAbstractListModel {
     Path_Ask_User,       // Only used in preferences: to ask user which of the previous values he wants to use.
   };
 
+  // Playlists that aren't visible are kept as stubs, and only restored from the database when they're first needed.
+  enum RestoreState {
+    Restore_Deferred,
+    Restore_Loading,
+    Restore_Finished
+  };
+
   static const char *kCddaMimeType;
   static const char *kRowsMimetype;
   static const char *kPlayNowMimetype;
@@ -174,6 +182,13 @@ class Playlist : public QAbstractListModel {
   // Persistence
   void Save() const;
   void Restore();
+  // Restores the songs if this is still a stub, wait blocks until they're inserted.
+  void EnsureRestored(const bool wait = false);
+  // Drops the songs and goes back to being a stub, they're already saved in the database.
+  void Unload();
+  void SetStubSummary(const int song_count, const quint64 length_nanosec);
+  RestoreState restore_state() const { return restore_state_; }
+  bool is_restored() const { return restore_state_ == Restore_Finished; }
 
   // Accessors
   QSortFilterProxyModel *proxy() const;
@@ -210,6 +225,8 @@ class Playlist : public QAbstractListModel {
   SongList GetAllSongs() const;
   PlaylistItemList GetAllItems() const;
   quint64 GetTotalLength() const;  // in seconds
+  // Also known for stubs.
+  int song_count() const;
 
   void set_sequence(PlaylistSequence *v);
   PlaylistSequence *sequence() const { return playlist_sequence_; }
@@ -347,6 +364,8 @@ private:
   void SongInsertVetoListenerDestroyed();
 
 private:
+  void RestoreItems(PlaylistItemList items);
+
   bool is_loading_;
   PlaylistFilter *proxy_;
   Queue *queue_;
@@ -373,6 +392,7 @@ private:
   int current_virtual_index_;
 
   bool is_shuffled_;
+  PlaylistShuffler shuffler_;
 
   PlaylistSequence *playlist_sequence_;
 
@@ -389,6 +409,10 @@ private:
 
   // Cancel async restore if songs are already replaced
   bool cancel_restore_;
+  RestoreState restore_state_;
+  QFuture<PlaylistItemList> restore_future_;
+  int stub_song_count_;
+  quint64 stub_length_nanosec_;
 
   bool scrobbled_;
   bool nowplaying_;
@@ -43,8 +43,9 @@
 #include "core/logging.h"
 #include "core/scopedtransaction.h"
 #include "core/song.h"
+#include "core/sqlitequery.h"
+#include "core/tracing.h"
 #include "collection/collectionbackend.h"
-#include "collection/sqlrow.h"
 #include "playlistitem.h"
 #include "songplaylistitem.h"
 #include "playlistbackend.h"
@@ -135,11 +136,36 @@ PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
 
 }
 
-QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist) {
+PlaylistBackend::Summary PlaylistBackend::GetPlaylistSummary(int playlist) {
 
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
+  Summary ret;
+
+  QSqlQuery q(db);
+  q.prepare("SELECT COUNT(*), SUM(MAX(COALESCE(songs.length, p.length), 0))"
+            " FROM playlist_items AS p"
+            " LEFT JOIN songs"
+            "    ON p.collection_id = songs.ROWID"
+            " WHERE p.playlist = :playlist");
+  q.bindValue(":playlist", playlist);
+  q.exec();
+  if (db_->CheckErrors(q)) return ret;
+
+  if (q.next()) {
+    ret.song_count = q.value(0).toInt();
+    ret.length_nanosec = q.value(1).toULongLong();
+  }
+
+  return ret;
+
+}
+
+bool PlaylistBackend::GetPlaylistRows(int playlist, SqliteQuery *q) {
+
+  QMutexLocker l(db_->Mutex());
+
   QString query = "SELECT songs.ROWID, " + Song::JoinSpec("songs") +
                   ","
                   "       p.ROWID, " +
@@ -150,57 +176,57 @@ QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist) {
                   " LEFT JOIN songs"
                   "    ON p.collection_id = songs.ROWID"
                   " WHERE p.playlist = :playlist";
-  QSqlQuery q(db);
-  // Forward iterations only may be faster
-  q.setForwardOnly(true);
-  q.prepare(query);
-  q.bindValue(":playlist", playlist);
-  q.exec();
+  q->Prepare(query);
+  q->BindValue(":playlist", playlist);
+  q->Exec();
 
-  return q;
+  return !db_->CheckErrors(*q);
 
 }
 
 QList<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
 
-  QSqlQuery q = GetPlaylistRows(playlist);
-  // Note that as this only accesses the query, not the db, we don't need the mutex.
-  if (db_->CheckErrors(q)) return QList<PlaylistItemPtr>();
+  tracing::ScopedSpan span("PlaylistBackend::GetPlaylistItems", QString::number(playlist));
+
+  SqliteQuery q(db_->Connect());
+  // Note that stepping through the rows only accesses the query, so we don't need the mutex after this.
+  if (!GetPlaylistRows(playlist, &q)) return QList<PlaylistItemPtr>();
 
   // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
   std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
   QList<PlaylistItemPtr> playlistitems;
-  while (q.next()) {
-    playlistitems << NewPlaylistItemFromQuery(SqlRow(q), state_ptr);
+  while (q.Next()) {
+    playlistitems << NewPlaylistItemFromQuery(q, state_ptr);
   }
+
   return playlistitems;
 
 }
 
 QList<Song> PlaylistBackend::GetPlaylistSongs(int playlist) {
 
-  QSqlQuery q = GetPlaylistRows(playlist);
-  // Note that as this only accesses the query, not the db, we don't need the mutex.
-  if (db_->CheckErrors(q)) return QList<Song>();
+  SqliteQuery q(db_->Connect());
+  // Note that stepping through the rows only accesses the query, so we don't need the mutex after this.
+  if (!GetPlaylistRows(playlist, &q)) return QList<Song>();
 
   // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
   std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
   QList<Song> songs;
-  while (q.next()) {
-    songs << NewSongFromQuery(SqlRow(q), state_ptr);
+  while (q.Next()) {
+    songs << NewSongFromQuery(q, state_ptr);
   }
   return songs;
 
 }
 
-PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
+PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqliteQuery &q, std::shared_ptr<NewSongFromQueryState> state) {
 
   // The song tables get joined first, plus one each for the song ROWIDs
   const int playlist_row = (Song::kColumns.count() + 1) * kSongTableJoins;
 
-  PlaylistItemPtr item(PlaylistItem::NewFromSource(Song::Source(row.value(playlist_row).toInt())));
+  PlaylistItemPtr item(PlaylistItem::NewFromSource(Song::Source(q.Int(playlist_row))));
   if (item) {
-    item->InitFromQuery(row);
+    item->InitFromQuery(q);
     return RestoreCueData(item, state);
   }
   else {
@@ -209,9 +235,9 @@ PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, std
 
 }
 
-Song PlaylistBackend::NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
+Song PlaylistBackend::NewSongFromQuery(const SqliteQuery &q, std::shared_ptr<NewSongFromQueryState> state) {
 
-  return NewPlaylistItemFromQuery(row, state)->Metadata();
+  return NewPlaylistItemFromQuery(q, state)->Metadata();
 
 }
 
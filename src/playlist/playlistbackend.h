@@ -36,11 +36,11 @@
 #include <QSqlQuery>
 
 #include "core/song.h"
-#include "collection/sqlrow.h"
 #include "playlistitem.h"
 
 class Application;
 class Database;
+class SqliteQuery;
 
 class PlaylistBackend : public QObject {
   Q_OBJECT
@@ -60,6 +60,14 @@ class PlaylistBackend : public QObject {
   };
   typedef QList<Playlist> PlaylistList;
 
+  // What's shown for a playlist that isn't restored yet.
+  struct Summary {
+    Summary() : song_count(0), length_nanosec(0) {}
+
+    int song_count;
+    quint64 length_nanosec;
+  };
+
   static const int kSongTableJoins;
 
   PlaylistList GetAllPlaylists();
@@ -69,6 +77,7 @@ class PlaylistBackend : public QObject {
 
   QList<PlaylistItemPtr> GetPlaylistItems(int playlist);
   QList<Song> GetPlaylistSongs(int playlist);
+  Summary GetPlaylistSummary(int playlist);
 
   void SetPlaylistOrder(const QList<int> &ids);
   void SetPlaylistUiPath(int id, const QString &path);
@@ -90,10 +99,10 @@ class PlaylistBackend : public QObject {
     QMutex mutex_;
   };
 
-  QSqlQuery GetPlaylistRows(int playlist);
+  bool GetPlaylistRows(int playlist, SqliteQuery *q);
 
-  Song NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
-  PlaylistItemPtr NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
+  Song NewSongFromQuery(const SqliteQuery &q, std::shared_ptr<NewSongFromQueryState> state);
+  PlaylistItemPtr NewPlaylistItemFromQuery(const SqliteQuery &q, std::shared_ptr<NewSongFromQueryState> state);
   PlaylistItemPtr RestoreCueData(PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state);
 
   enum GetPlaylistsFlags {
@@ -43,7 +43,7 @@
 
 #include "core/song.h"
 
-class SqlRow;
+class SqliteQuery;
 
 class PlaylistItem : public std::enable_shared_from_this<PlaylistItem> {
  public:
@@ -70,7 +70,7 @@ class PlaylistItem : public std::enable_shared_from_this<PlaylistItem> {
 
   virtual QList<QAction*> actions() { return QList<QAction*>(); }
 
-  virtual bool InitFromQuery(const SqlRow &query) = 0;
+  virtual bool InitFromQuery(const SqliteQuery &query) = 0;
   void BindToQuery(QSqlQuery* query) const;
   virtual void Reload() {}
   QFuture<void> BackgroundReload();
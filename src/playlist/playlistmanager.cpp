@@ -45,6 +45,8 @@
 #include "core/closure.h"
 #include "core/logging.h"
 #include "core/player.h"
+#include "core/stringinterner.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "collection/collectionbackend.h"
 #include "collection/collectionplaylistitem.h"
@@ -59,6 +61,9 @@
 
 class ParserBase;
 
+const int PlaylistManager::kUnloadCheckIntervalMsec = 5 * 60 * 1000;
+const int PlaylistManager::kUnloadAfterSecs = 30 * 60;
+
 PlaylistManager::PlaylistManager(Application *app, QObject *parent)
     : PlaylistManagerInterface(app, parent),
       app_(app),
@@ -69,11 +74,16 @@ PlaylistManager::PlaylistManager(Application *app, QObject *parent)
       playlist_container_(nullptr),
       current_(-1),
       active_(-1),
-      playlists_loading_(0)
+      playlists_loading_(0),
+      initialising_(false),
+      unload_timer_(new QTimer(this))
 {
   connect(app_->player(), SIGNAL(Paused()), SLOT(SetActivePaused()));
   connect(app_->player(), SIGNAL(Playing()), SLOT(SetActivePlaying()));
   connect(app_->player(), SIGNAL(Stopped()), SLOT(SetActiveStopped()));
+
+  unload_timer_->setInterval(kUnloadCheckIntervalMsec);
+  connect(unload_timer_, SIGNAL(timeout()), SLOT(UnloadUnusedPlaylists()));
 }
 
 PlaylistManager::~PlaylistManager() {
@@ -84,6 +94,8 @@ PlaylistManager::~PlaylistManager() {
 
 void PlaylistManager::Init(CollectionBackend *collection_backend, PlaylistBackend *playlist_backend, PlaylistSequence *sequence, PlaylistContainer *playlist_container) {
 
+  tracing::ScopedSpan span("PlaylistManager::Init");
+
   collection_backend_ = collection_backend;
   playlist_backend_ = playlist_backend;
   sequence_ = sequence;
@@ -93,14 +105,28 @@ void PlaylistManager::Init(CollectionBackend *collection_backend, PlaylistBacken
   connect(collection_backend_, SIGNAL(SongsDiscovered(SongList)), SLOT(SongsDiscovered(SongList)));
   connect(collection_backend_, SIGNAL(SongsStatisticsChanged(SongList)), SLOT(SongsDiscovered(SongList)));
 
+  initialising_ = true;
   for (const PlaylistBackend::Playlist &p : playlist_backend->GetAllOpenPlaylists()) {
-    playlists_loading_++;
-    Playlist *ret = AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
-    connect(ret, SIGNAL(PlaylistLoaded()), SLOT(PlaylistLoaded()));
+    AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
   }
+  initialising_ = false;
 
-  // If no playlist exists then make a new one
-  if (playlists_.isEmpty()) New(tr("Playlist"));
+  if (playlists_.isEmpty()) {
+    // If no playlist exists then make a new one
+    New(tr("Playlist"));
+  }
+  else {
+    // Only the playlist that's shown is restored now, the others stay stubs until they're needed.
+    // It's restored in the background, so don't wait for it when making it the active one.
+    initialising_ = true;
+    SetActiveToCurrent();
+    initialising_ = false;
+    playlists_loading_ = 1;
+    connect(current(), SIGNAL(PlaylistLoaded()), SLOT(PlaylistLoaded()));
+    current()->EnsureRestored();
+  }
+
+  unload_timer_->start();
 
   emit PlaylistManagerInitialized();
 
@@ -112,7 +138,10 @@ void PlaylistManager::PlaylistLoaded() {
   if (!playlist) return;
   disconnect(playlist, SIGNAL(PlaylistLoaded()), this, SLOT(PlaylistLoaded()));
   playlists_loading_--;
-  if (playlists_loading_ == 0) emit AllPlaylistsLoaded();
+  if (playlists_loading_ == 0) {
+    tracing::Instant("AllPlaylistsLoaded");
+    emit AllPlaylistsLoaded();
+  }
 
 }
 
@@ -147,6 +176,9 @@ Playlist *PlaylistManager::AddPlaylist(int id, const QString &name, const QStrin
   connect(ret, SIGNAL(PlayRequested(QModelIndex)), SIGNAL(PlayRequested(QModelIndex)));
   connect(playlist_container_->view(), SIGNAL(ColumnAlignmentChanged(ColumnAlignmentMap)), ret, SLOT(SetColumnAlignment(ColumnAlignmentMap)));
 
+  const PlaylistBackend::Summary summary = playlist_backend_->GetPlaylistSummary(id);
+  ret->SetStubSummary(summary.song_count, summary.length_nanosec);
+
   playlists_[id] = Data(ret, name);
 
   emit PlaylistAdded(id, name, favorite);
@@ -171,6 +203,7 @@ void PlaylistManager::New(const QString &name, const SongList &songs, const QStr
   if (id == -1) qFatal("Couldn't create playlist");
 
   Playlist *playlist = AddPlaylist(id, name, special_type, QString(), false);
+  playlist->EnsureRestored(true);
   playlist->InsertSongsOrCollectionItems(songs);
 
   SetCurrentPlaylist(id);
@@ -194,6 +227,7 @@ void PlaylistManager::Load(const QString &filename) {
   }
 
   Playlist *playlist = AddPlaylist(id, info.baseName(), QString(), QString(), false);
+  playlist->EnsureRestored(true);
 
   QList<QUrl> urls;
   playlist->InsertUrls(urls << QUrl::fromLocalFile(filename));
@@ -202,11 +236,11 @@ void PlaylistManager::Load(const QString &filename) {
 
 void PlaylistManager::Save(int id, const QString &filename, Playlist::Path path_type) {
 
-  if (playlists_.contains(id)) {
+  if (playlists_.contains(id) && playlist(id)->is_restored()) {
     parser_->Save(playlist(id)->GetAllSongs(), filename, path_type);
   }
   else {
-    // Playlist is not in the playlist manager: probably save action was triggered from the left side bar and the playlist isn't loaded.
+    // Playlist is not in the playlist manager or not restored yet: probably save action was triggered from the left side bar and the playlist isn't loaded.
     QFuture<QList<Song>> future = QtConcurrent::run(playlist_backend_, &PlaylistBackend::GetPlaylistSongs, id);
 
     NewClosure(future, this, SLOT(ItemsLoadedForSavePlaylist(QFuture<SongList>, QString, Playlist::Path)), future, filename, path_type);
@@ -362,7 +396,14 @@ void PlaylistManager::OneOfPlaylistsChanged() {
 void PlaylistManager::SetCurrentPlaylist(int id) {
 
   Q_ASSERT(playlists_.contains(id));
+
+  // The playlist switched away from was in use until now.
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  if (playlists_.contains(current_)) playlists_[current_].last_used = now;
+  playlists_[id].last_used = now;
+
   current_ = id;
+  if (!initialising_) current()->EnsureRestored();
   emit CurrentChanged(current());
   UpdateSummaryText();
 
@@ -375,7 +416,13 @@ void PlaylistManager::SetActivePlaylist(int id) {
   // Kinda a hack: unset the current item from the old active playlist before setting the new one
   if (active_ != -1 && active_ != id) active()->set_current_row(-1);
 
+  const uint now = QDateTime::currentDateTime().toTime_t();
+  if (playlists_.contains(active_)) playlists_[active_].last_used = now;
+  playlists_[id].last_used = now;
+
   active_ = id;
+  // The active playlist is the one that plays, callers go on to play from it straight away.
+  if (!initialising_) active()->EnsureRestored(true);
 
   emit ActiveChanged(active());
 
@@ -420,7 +467,7 @@ void PlaylistManager::ChangePlaylistOrder(const QList<int> &ids) {
 
 void PlaylistManager::UpdateSummaryText() {
 
-  int tracks = current()->rowCount();
+  int tracks = current()->song_count();
   quint64 nanoseconds = 0;
   int selected = 0;
 
@@ -490,6 +537,7 @@ void PlaylistManager::InsertUrls(int id, const QList<QUrl> &urls, int pos, bool
 
   Q_ASSERT(playlists_.contains(id));
 
+  playlists_[id].p->EnsureRestored(true);
   playlists_[id].p->InsertUrls(urls, pos, play_now, enqueue);
 
 }
@@ -498,6 +546,7 @@ void PlaylistManager::InsertSongs(int id, const SongList &songs, int pos, bool p
 
   Q_ASSERT(playlists_.contains(id));
 
+  playlists_[id].p->EnsureRestored(true);
   playlists_[id].p->InsertSongs(songs, pos, play_now, enqueue);
 
 }
@@ -506,6 +555,7 @@ void PlaylistManager::RemoveItemsWithoutUndo(int id, const QList<int> &indices)
 
   Q_ASSERT(playlists_.contains(id));
 
+  playlists_[id].p->EnsureRestored(true);
   playlists_[id].p->RemoveItemsWithoutUndo(indices);
 
 }
@@ -514,6 +564,27 @@ void PlaylistManager::RemoveCurrentSong() {
   active()->removeRows(active()->current_index().row(), 1);
 }
 
+void PlaylistManager::UnloadUnusedPlaylists() {
+
+  const uint now = QDateTime::currentDateTime().toTime_t();
+
+  for (QMap<int, Data>::iterator it = playlists_.begin() ; it != playlists_.end() ; ++it) {
+    if (it.key() == current_ || it.key() == active_) {
+      it->last_used = now;
+      continue;
+    }
+    if (it->p->is_restored() && now - it->last_used > static_cast<uint>(kUnloadAfterSecs)) {
+      qLog(Debug) << "Unloading playlist" << it->name;
+      it->selection = QItemSelection();
+      it->p->Unload();
+    }
+  }
+
+  // Also drops the strings of songs that were removed from playlists or replaced by a collection scan since the last check.
+  if (StringInterner::Prune() > 0) StringInterner::LogStats();
+
+}
+
 void PlaylistManager::InvalidateDeletedSongs() {
   for (Playlist *playlist : GetAllPlaylists()) {
     playlist->InvalidateDeletedSongs();
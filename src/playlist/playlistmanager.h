@@ -32,6 +32,8 @@
 #include <QMap>
 #include <QString>
 #include <QUrl>
+#include <QDateTime>
+#include <QTimer>
 
 #include "core/song.h"
 #include "playlist.h"
@@ -133,6 +135,10 @@ class PlaylistManager : public PlaylistManagerInterface {
   PlaylistManager(Application *app, QObject *parent = nullptr);
   ~PlaylistManager();
 
+  // Playlists that haven't been current or active for this long are unloaded back to stubs.
+  static const int kUnloadCheckIntervalMsec;
+  static const int kUnloadAfterSecs;
+
   int current_id() const { return current_; }
   int active_id() const { return active_; }
 
@@ -215,16 +221,18 @@ class PlaylistManager : public PlaylistManagerInterface {
   void SongsDiscovered(const SongList& songs);
   void ItemsLoadedForSavePlaylist(QFuture<SongList> future, const QString& filename, Playlist::Path path_type);
   void PlaylistLoaded();
+  void UnloadUnusedPlaylists();
 
  private:
   Playlist *AddPlaylist(int id, const QString& name, const QString &special_type, const QString& ui_path, bool favorite);
 
  private:
   struct Data {
-    Data(Playlist *_p = nullptr, const QString& _name = QString()) : p(_p), name(_name) {}
+    Data(Playlist *_p = nullptr, const QString& _name = QString()) : p(_p), name(_name), last_used(QDateTime::currentDateTime().toTime_t()) {}
     Playlist *p;
     QString name;
     QItemSelection selection;
+    uint last_used;
   };
 
   Application *app_;
@@ -240,6 +248,9 @@ class PlaylistManager : public PlaylistManagerInterface {
   int current_;
   int active_;
   int playlists_loading_;
+  // Set while the open playlists are added in Init, so only the one shown is restored.
+  bool initialising_;
+  QTimer *unload_timer_;
 };
 
 #endif  // PLAYLISTMANAGER_H
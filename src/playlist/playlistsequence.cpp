@@ -76,6 +76,7 @@ PlaylistSequence::PlaylistSequence(QWidget *parent, SettingsProvider *settings)
   shuffle_group->addAction(ui_->action_shuffle_all);
   shuffle_group->addAction(ui_->action_shuffle_inside_album);
   shuffle_group->addAction(ui_->action_shuffle_albums);
+  shuffle_group->addAction(ui_->action_shuffle_weighted);
   shuffle_menu_->addActions(shuffle_group->actions());
   ui_->shuffle->setMenu(shuffle_menu_);
 
@@ -155,6 +156,7 @@ void PlaylistSequence::ShuffleActionTriggered(QAction *action) {
   if (action == ui_->action_shuffle_all) mode = Shuffle_All;
   if (action == ui_->action_shuffle_inside_album) mode = Shuffle_InsideAlbum;
   if (action == ui_->action_shuffle_albums) mode = Shuffle_Albums;
+  if (action == ui_->action_shuffle_weighted) mode = Shuffle_Weighted;
 
   SetShuffleMode(mode);
 
@@ -192,6 +194,7 @@ void PlaylistSequence::SetShuffleMode(ShuffleMode mode) {
     case Shuffle_All:         ui_->action_shuffle_all->setChecked(true);          break;
     case Shuffle_InsideAlbum: ui_->action_shuffle_inside_album->setChecked(true); break;
     case Shuffle_Albums:      ui_->action_shuffle_albums->setChecked(true);       break;
+    case Shuffle_Weighted:    ui_->action_shuffle_weighted->setChecked(true);     break;
   }
 
   if (mode != shuffle_mode_) {
@@ -220,7 +223,8 @@ void PlaylistSequence::CycleShuffleMode() {
     case Shuffle_Off:         mode = Shuffle_All;           break;
     case Shuffle_All:         mode = Shuffle_InsideAlbum;   break;
     case Shuffle_InsideAlbum: mode = Shuffle_Albums;        break;
-    case Shuffle_Albums: break;
+    case Shuffle_Albums:      mode = Shuffle_Weighted;      break;
+    case Shuffle_Weighted: break;
   }
 
   SetShuffleMode(mode);
@@ -57,6 +57,7 @@ class PlaylistSequence : public QWidget {
     Shuffle_All = 1,
     Shuffle_InsideAlbum = 2,
     Shuffle_Albums = 3,
+    Shuffle_Weighted = 4,
   };
 
   static const char *kSettingsGroup;
@@ -0,0 +1,292 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <stdbool.h>
+
+#include <QtGlobal>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QDateTime>
+
+#include "core/song.h"
+#include "playlistitem.h"
+#include "playlistsequence.h"
+#include "playlistshuffler.h"
+
+const int PlaylistShuffler::kHistorySize = 100;
+const int PlaylistShuffler::kRecentlyPlayedSecs = 4 * 60 * 60;
+const double PlaylistShuffler::kRecentlyPlayedWeight = 0.05;
+
+PlaylistShuffler::PlaylistShuffler() : generator_(std::random_device()()) {}
+
+void PlaylistShuffler::Shuffle(const PlaylistSequence::ShuffleMode mode, const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int current_row) {
+
+  if (begin >= virtual_items->count()) return;
+
+  QList<int>::iterator it_begin = virtual_items->begin() + qMax(0, begin);
+  QList<int>::iterator it_end = virtual_items->end();
+  const uint now = QDateTime::currentDateTime().toTime_t();
+
+  switch (mode) {
+    case PlaylistSequence::Shuffle_Off:
+      break;
+
+    case PlaylistSequence::Shuffle_All:
+    case PlaylistSequence::Shuffle_InsideAlbum:
+      ShuffleAll(items, it_begin, it_end, now);
+      break;
+
+    case PlaylistSequence::Shuffle_Weighted:
+      ShuffleWeighted(items, it_begin, it_end, now);
+      break;
+
+    case PlaylistSequence::Shuffle_Albums:
+      ShuffleAlbums(items, virtual_items, qMax(0, begin), current_row, QList<int>(), true);
+      break;
+  }
+
+}
+
+void PlaylistShuffler::Insert(const PlaylistSequence::ShuffleMode mode, const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int start, const int count) {
+
+  if (count <= 0) return;
+
+  // Rows at or after start moved down in the playlist.
+  for (QList<int>::iterator it = virtual_items->begin() ; it != virtual_items->end() ; ++it) {
+    if (*it >= start) *it += count;
+  }
+
+  QList<int> rows;
+  for (int row = start ; row < start + count ; ++row) rows << row;
+
+  const int first = qBound(0, begin, virtual_items->count());
+  const uint now = QDateTime::currentDateTime().toTime_t();
+
+  switch (mode) {
+    case PlaylistSequence::Shuffle_Off: {
+      // The play order follows the playlist order.
+      QList<int>::iterator it = std::lower_bound(virtual_items->begin(), virtual_items->end(), start);
+      const int pos = it - virtual_items->begin();
+      for (int i = 0 ; i < rows.count() ; ++i) virtual_items->insert(pos + i, rows[i]);
+      break;
+    }
+
+    case PlaylistSequence::Shuffle_All:
+    case PlaylistSequence::Shuffle_InsideAlbum:
+      // Inserting each row at a uniformly random position keeps the unplayed part a uniformly random permutation.
+      for (int row : rows) {
+        if (row < items.count() && IsRecentlyPlayed(items[row].get(), now)) {
+          virtual_items->append(row);
+          continue;
+        }
+        std::uniform_int_distribution<int> dist(first, virtual_items->count());
+        virtual_items->insert(dist(generator_), row);
+      }
+      break;
+
+    case PlaylistSequence::Shuffle_Weighted:
+      // The unplayed part is sorted by descending key, so new rows are placed with a binary search.
+      for (int row : rows) {
+        if (row < items.count()) keys_.insert(items[row].get(), NewKey(items[row].get(), now));
+        const double key = Key(items, row);
+        QList<int>::iterator it = std::upper_bound(virtual_items->begin() + first, virtual_items->end(), key, [this, &items](const double k, const int r) { return k > Key(items, r); });
+        virtual_items->insert(it, row);
+      }
+      break;
+
+    case PlaylistSequence::Shuffle_Albums:
+      ShuffleAlbums(items, virtual_items, first, -1, rows, false);
+      break;
+  }
+
+}
+
+void PlaylistShuffler::Remove(const PlaylistItemList &items) {
+
+  for (const PlaylistItemPtr &item : items) {
+    keys_.remove(item.get());
+    if (history_set_.remove(item.get())) {
+      history_.removeAll(item.get());
+    }
+  }
+
+}
+
+void PlaylistShuffler::AddToHistory(const PlaylistItemPtr &item) {
+
+  if (!item) return;
+
+  if (history_set_.contains(item.get())) {
+    history_.removeAll(item.get());
+  }
+  else {
+    history_set_.insert(item.get());
+  }
+  history_.append(item.get());
+
+  while (history_.count() > kHistorySize) {
+    history_set_.remove(history_.takeFirst());
+  }
+
+}
+
+void PlaylistShuffler::Clear() {
+
+  keys_.clear();
+  history_.clear();
+  history_set_.clear();
+
+}
+
+bool PlaylistShuffler::IsRecentlyPlayed(const PlaylistItem *item, const uint now) const {
+
+  if (history_set_.contains(item)) return true;
+
+  const int lastplayed = item->Metadata().lastplayed();
+  return lastplayed > 0 && now - lastplayed < static_cast<uint>(kRecentlyPlayedSecs);
+
+}
+
+double PlaylistShuffler::Weight(const PlaylistItem *item, const uint now) const {
+
+  const Song song = item->Metadata();
+
+  // Songs that are played often are favoured, songs that are often skipped are played less.
+  double weight = (1.0 + qMax(0, song.playcount())) / (1.0 + qMax(0, song.skipcount()));
+  if (IsRecentlyPlayed(item, now)) weight *= kRecentlyPlayedWeight;
+
+  return weight;
+
+}
+
+double PlaylistShuffler::NewKey(const PlaylistItem *item, const uint now) {
+
+  // Weighted random sampling (Efraimidis-Spirakis): sorting by log(u) / weight gives a weighted random permutation.
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  const double u = 1.0 - dist(generator_);
+  return std::log(u) / Weight(item, now);
+
+}
+
+double PlaylistShuffler::Key(const PlaylistItemList &items, const int row) const {
+
+  if (row < 0 || row >= items.count()) return -std::numeric_limits<double>::infinity();
+  return keys_.value(items[row].get(), -std::numeric_limits<double>::infinity());
+
+}
+
+void PlaylistShuffler::ShuffleAll(const PlaylistItemList &items, QList<int>::iterator begin, QList<int>::iterator end, const uint now) {
+
+  std::shuffle(begin, end, generator_);
+
+  // Move recently played songs to the back so they aren't repeated straight away.
+  std::stable_partition(begin, end, [this, &items, now](const int row) { return row >= items.count() || !IsRecentlyPlayed(items[row].get(), now); });
+
+}
+
+void PlaylistShuffler::ShuffleWeighted(const PlaylistItemList &items, QList<int>::iterator begin, QList<int>::iterator end, const uint now) {
+
+  for (QList<int>::iterator it = begin; it != end; ++it) {
+    if (*it < items.count()) keys_.insert(items[*it].get(), NewKey(items[*it].get(), now));
+  }
+
+  std::sort(begin, end, [this, &items](const int left, const int right) { return Key(items, left) > Key(items, right); });
+
+}
+
+void PlaylistShuffler::ShuffleAlbums(const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int current_row, const QList<int> &rows, const bool reshuffle) {
+
+  // Group the unplayed rows into album blocks, keeping the existing album order.
+  QList<QList<int>> blocks;
+  QList<QString> block_keys;
+  QHash<QString, int> block_by_key;
+  QSet<int> touched_blocks;
+
+  auto add_row = [&](const int row, const bool new_row) {
+    const QString key = row < items.count() ? items[row]->Metadata().AlbumKey() : QString();
+    int block = block_by_key.value(key, -1);
+    if (block == -1) {
+      block = blocks.count();
+      if (new_row && !blocks.isEmpty()) {
+        // A new album goes in a random position between the existing ones.
+        std::uniform_int_distribution<int> dist(0, blocks.count());
+        const int pos = dist(generator_);
+        blocks.insert(pos, QList<int>());
+        block_keys.insert(pos, key);
+        for (int i = pos ; i < block_keys.count() ; ++i) block_by_key[block_keys[i]] = i;
+        QSet<int> shifted_blocks;
+        for (int i : touched_blocks) shifted_blocks.insert(i >= pos ? i + 1 : i);
+        touched_blocks = shifted_blocks;
+        block = pos;
+      }
+      else {
+        blocks.append(QList<int>());
+        block_keys.append(key);
+        block_by_key.insert(key, block);
+      }
+    }
+    blocks[block].append(row);
+    if (new_row) touched_blocks.insert(block);
+  };
+
+  for (int i = begin ; i < virtual_items->count() ; ++i) {
+    add_row(virtual_items->at(i), false);
+  }
+  for (int row : rows) {
+    add_row(row, true);
+  }
+
+  if (reshuffle) {
+    std::shuffle(blocks.begin(), blocks.end(), generator_);
+
+    // If the user is currently playing a song, or one is selected, force its album to be first.
+    if (current_row != -1 && current_row < items.count()) {
+      const QString key = items[current_row]->Metadata().AlbumKey();
+      for (int i = 1 ; i < blocks.count() ; ++i) {
+        const int row = blocks[i].first();
+        if (row < items.count() && items[row]->Metadata().AlbumKey() == key) {
+          std::swap(blocks[0], blocks[i]);
+          break;
+        }
+      }
+    }
+
+    for (QList<int> &block : blocks) {
+      std::sort(block.begin(), block.end());
+    }
+  }
+  else {
+    for (int i : touched_blocks) {
+      std::sort(blocks[i].begin(), blocks[i].end());
+    }
+  }
+
+  virtual_items->erase(virtual_items->begin() + begin, virtual_items->end());
+  for (const QList<int> &block : blocks) {
+    virtual_items->append(block);
+  }
+
+}
@@ -0,0 +1,82 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLAYLISTSHUFFLER_H
+#define PLAYLISTSHUFFLER_H
+
+#include "config.h"
+
+#include <random>
+#include <stdbool.h>
+
+#include <QList>
+#include <QHash>
+#include <QSet>
+
+#include "playlistitem.h"
+#include "playlistsequence.h"
+
+// Maintains the play order (the "virtual items") of a shuffled playlist.
+// Only the part of the order that hasn't been played yet is ever touched, and inserted or removed rows are merged into the existing order instead of shuffling everything again.
+class PlaylistShuffler {
+ public:
+  PlaylistShuffler();
+
+  // Number of played items remembered for history-aware shuffling.
+  static const int kHistorySize;
+  // Songs played less than this many seconds ago count as recently played.
+  static const int kRecentlyPlayedSecs;
+  // Weight multiplier applied to recently played songs in weighted mode.
+  static const double kRecentlyPlayedWeight;
+
+  // Shuffles virtual_items from the index begin onwards.
+  void Shuffle(const PlaylistSequence::ShuffleMode mode, const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int current_row);
+
+  // Places count rows inserted into items at row start into virtual_items after the index begin, without changing the relative order of what is already there.
+  // Existing entries at or after start are shifted to keep pointing at the same items.
+  void Insert(const PlaylistSequence::ShuffleMode mode, const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int start, const int count);
+
+  // Forgets everything known about items that were removed from the playlist.
+  void Remove(const PlaylistItemList &items);
+
+  void AddToHistory(const PlaylistItemPtr &item);
+  void Clear();
+
+ private:
+  // now is the current time in seconds since the epoch, it's read once for each shuffle.
+  bool IsRecentlyPlayed(const PlaylistItem *item, const uint now) const;
+  double Weight(const PlaylistItem *item, const uint now) const;
+  double NewKey(const PlaylistItem *item, const uint now);
+  double Key(const PlaylistItemList &items, const int row) const;
+
+  void ShuffleAll(const PlaylistItemList &items, QList<int>::iterator begin, QList<int>::iterator end, const uint now);
+  void ShuffleWeighted(const PlaylistItemList &items, QList<int>::iterator begin, QList<int>::iterator end, const uint now);
+  void ShuffleAlbums(const PlaylistItemList &items, QList<int> *virtual_items, const int begin, const int current_row, const QList<int> &rows, const bool reshuffle);
+
+ private:
+  std::mt19937 generator_;
+
+  // Sort keys for weighted shuffle, higher keys are played first.
+  QHash<const PlaylistItem*, double> keys_;
+
+  QList<const PlaylistItem*> history_;
+  QSet<const PlaylistItem*> history_set_;
+
+};
+
+#endif  // PLAYLISTSHUFFLER_H
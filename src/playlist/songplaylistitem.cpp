@@ -25,14 +25,14 @@
 #include <QUrl>
 
 #include "core/tagreaderclient.h"
-#include "collection/sqlrow.h"
+#include "core/sqlitequery.h"
 #include "playlistitem.h"
 #include "songplaylistitem.h"
 
 SongPlaylistItem::SongPlaylistItem(const Song::Source &source) : PlaylistItem(source) {}
 SongPlaylistItem::SongPlaylistItem(const Song &song) : PlaylistItem(song.source()), song_(song) {}
 
-bool SongPlaylistItem::InitFromQuery(const SqlRow &query) {
+bool SongPlaylistItem::InitFromQuery(const SqliteQuery &query) {
   song_.InitFromQuery(query, false, (Song::kColumns.count()+1));
   return true;
 }
@@ -28,7 +28,7 @@
 #include <QUrl>
 
 #include "core/song.h"
-#include "collection/sqlrow.h"
+#include "core/sqlitequery.h"
 #include "playlistitem.h"
 
 class SongPlaylistItem : public PlaylistItem {
@@ -38,7 +38,7 @@ class SongPlaylistItem : public PlaylistItem {
 
   // Restores a stream- or file-related playlist item using query row.
   // If it's a file related playlist item, this will restore it's CUE attributes (if any) but won't parse the CUE!
-  bool InitFromQuery(const SqlRow& query);
+  bool InitFromQuery(const SqliteQuery &query);
   void Reload();
 
   Song Metadata() const;
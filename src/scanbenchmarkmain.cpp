@@ -0,0 +1,200 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QString>
+#include <QUrl>
+#include <QSettings>
+
+#include "core/logging.h"
+#include "core/metatypes.h"
+#include "core/database.h"
+#include "core/song.h"
+#include "core/taskmanager.h"
+#include "collection/directory.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionwatcher.h"
+#include "collection/benchmarksongs.h"
+#include "settings/collectionsettingspage.h"
+
+namespace {
+
+const int kBatchSize = 10000;
+
+}  // namespace
+
+// Times how long the collection watcher takes to compare directories with many files with the songs the collection already has for them.
+int main(int argc, char *argv[]) {
+
+  // Keep the collection settings of the benchmark apart from the player's.
+  QCoreApplication::setApplicationName("strawberry-scanbenchmark");
+  QCoreApplication::setOrganizationName("strawberry");
+  QCoreApplication a(argc, argv);
+
+  Q_INIT_RESOURCE(data);
+
+  RegisterMetaTypes();
+
+  logging::Init();
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Creates directories of empty files in a temporary directory, adds a song for each file to an in-memory collection, and times the scans that compare the directories with the collection.");
+  parser.addHelpOption();
+  QCommandLineOption files_option("files", "Number of files in each directory.", "count", "10000");
+  QCommandLineOption subdirs_option("subdirs", "Number of directories.", "count", "1");
+  QCommandLineOption runs_option("runs", "Number of scans to time.", "count", "10");
+  parser.addOption(files_option);
+  parser.addOption(subdirs_option);
+  parser.addOption(runs_option);
+  parser.process(a);
+
+  const int file_count = parser.value(files_option).toInt();
+  const int subdir_count = parser.value(subdirs_option).toInt();
+  const int runs = parser.value(runs_option).toInt();
+  if (file_count <= 0 || subdir_count <= 0 || runs <= 0) {
+    qLog(Error) << "The number of files, directories and scans have to be positive";
+    return 1;
+  }
+
+  QTemporaryDir temp_dir;
+  if (!temp_dir.isValid()) {
+    qLog(Error) << "Couldn't create a temporary directory";
+    return 1;
+  }
+
+  // The watcher reads these when it's created, it shouldn't watch the files and should scan the known directories.
+  QSettings s;
+  s.beginGroup(CollectionSettingsPage::kSettingsGroup);
+  s.setValue("monitor", false);
+  s.setValue("startup_scan", true);
+  s.endGroup();
+
+  MemoryDatabase db(nullptr);
+  TaskManager task_manager;
+  CollectionBackend backend;
+  backend.Init(&db, "songs", "directories", "subdirectories", "songs_fts", "duplicated_songs");
+
+  backend.AddDirectory(temp_dir.path());
+  const DirectoryList dirs = backend.GetAllDirectories();
+  if (dirs.isEmpty()) {
+    qLog(Error) << "Couldn't add" << temp_dir.path() << "to the collection";
+    return 1;
+  }
+  const Directory dir = dirs.first();
+
+  // The collection knows every file already, with the mtime it has on disk, so the scans only compare them.
+  QElapsedTimer timer;
+  timer.start();
+  SubdirectoryList stale_subdirs;
+  Subdirectory root;
+  root.directory_id = dir.id;
+  root.path = dir.path;
+  root.mtime = 1;
+  stale_subdirs << root;
+  int index = 0;
+  for (int i = 0 ; i < subdir_count ; ++i) {
+    const QString path = QString("%1/%2").arg(dir.path).arg(i, 4, 10, QChar('0'));
+    if (!QDir().mkpath(path)) {
+      qLog(Error) << "Couldn't create" << path;
+      return 1;
+    }
+
+    SongList songs;
+    for (int j = 0 ; j < file_count ; ++j) {
+      const QString filename = QString("%1/%2.flac").arg(path).arg(j, 5, 10, QChar('0'));
+      QFile file(filename);
+      if (!file.open(QIODevice::WriteOnly)) {
+        qLog(Error) << "Couldn't create" << filename;
+        return 1;
+      }
+      file.close();
+
+      Song song = BenchmarkSongs::Generate(index++);
+      song.set_directory_id(dir.id);
+      song.set_url(QUrl::fromLocalFile(filename));
+      song.set_basefilename(QFileInfo(filename).fileName());
+      song.set_filesize(0);
+      song.set_mtime(QFileInfo(filename).lastModified().toTime_t());
+      songs << song;
+      if (songs.count() >= kBatchSize) {
+        backend.AddOrUpdateSongs(songs);
+        songs.clear();
+      }
+    }
+    backend.AddOrUpdateSongs(songs);
+
+    // An mtime that doesn't match makes the scan go into the directory.
+    Subdirectory subdir;
+    subdir.directory_id = dir.id;
+    subdir.path = path;
+    subdir.mtime = 1;
+    stale_subdirs << subdir;
+  }
+  qLog(Info) << "Created" << index << "files and songs in" << timer.elapsed() << "ms";
+
+  CollectionWatcher watcher(Song::Source_Collection);
+  watcher.set_backend(&backend);
+  watcher.set_task_manager(&task_manager);
+
+  QObject::connect(&watcher, SIGNAL(NewOrUpdatedSongs(SongList)), &backend, SLOT(AddOrUpdateSongs(SongList)));
+  QObject::connect(&watcher, SIGNAL(SongsMTimeUpdated(SongList)), &backend, SLOT(UpdateMTimesOnly(SongList)));
+  QObject::connect(&watcher, SIGNAL(SongsDeleted(SongList)), &backend, SLOT(MarkSongsUnavailable(SongList)));
+  QObject::connect(&watcher, SIGNAL(SongsReadded(SongList, bool)), &backend, SLOT(MarkSongsUnavailable(SongList, bool)));
+  QObject::connect(&watcher, SIGNAL(SubdirsDiscovered(SubdirectoryList)), &backend, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
+  QObject::connect(&watcher, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)), &backend, SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
+
+  QList<qint64> nsecs;
+  for (int run = 0 ; run < runs ; ++run) {
+    backend.AddOrUpdateSubdirs(stale_subdirs);
+    const SubdirectoryList subdirs = backend.SubdirsInDirectory(dir.id);
+
+    timer.restart();
+    watcher.AddDirectory(dir, subdirs);
+    nsecs << timer.nsecsElapsed();
+  }
+
+  // Nothing changed on disk, so the scans shouldn't have found anything to add or remove.
+  int available = 0;
+  for (const Song &song : backend.FindSongsInDirectory(dir.id)) {
+    if (!song.is_unavailable()) ++available;
+  }
+  if (available != index) {
+    qLog(Error) << "The scans changed the songs in the collection";
+    return 1;
+  }
+
+  std::sort(nsecs.begin(), nsecs.end());
+  const qint64 median = nsecs[nsecs.count() / 2];
+  qLog(Info) << "Scanned" << index << "files in" << subdir_count << "directories:" << QString::number(median / 1e6, 'f', 1) << "ms median," << QString::number(nsecs.first() / 1e6, 'f', 1) << "ms fastest," << qint64(index * 1e9 / median) << "files/s";
+
+  return 0;
+
+}
@@ -0,0 +1,181 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <random>
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "core/logging.h"
+#include "core/database.h"
+#include "core/scopedtransaction.h"
+#include "core/song.h"
+#include "core/sqlitequery.h"
+#include "collection/collectionquery.h"
+#include "collection/benchmarksongs.h"
+
+namespace {
+
+const int kBatchSize = 10000;
+
+// The match expression the collection filter used for the FTS3 tables: a bare prefix query for each word.
+QString Fts3Match(const QString &filter) {
+
+  QString match;
+  for (const QString &token : filter.split(' ', QString::SkipEmptyParts)) match += token + "* ";
+  return match;
+
+}
+
+// Runs the search and reads all the rows, returns the number of rows or -1 on errors.
+int Search(Database *db, const QString &fts_table, const QString &filter) {
+
+  QMutexLocker l(db->Mutex());
+  QSqlDatabase database(db->Connect());
+  SqliteQuery query(database);
+
+  const QString column_spec = "songs.ROWID, " + Song::kColumnSpec;
+  if (fts_table == "songs_fts") {
+    QueryOptions options;
+    options.set_filter(filter);
+    CollectionQuery collection_query(options);
+    collection_query.SetColumnSpec(column_spec);
+    collection_query.Exec(&query, "songs", fts_table);
+  }
+  else {
+    if (!query.Prepare(QString("SELECT %1 FROM songs INNER JOIN %2 AS fts ON songs.ROWID = fts.ROWID WHERE fts.%2 MATCH ? AND unavailable = 0").arg(column_spec, fts_table))) return -1;
+    query.AddBindValue(Fts3Match(filter));
+    query.Exec();
+  }
+  if (db->CheckErrors(query)) return -1;
+
+  int rows = 0;
+  while (query.Next()) {
+    Song song;
+    song.InitFromQuery(query, true);
+    ++rows;
+  }
+  return rows;
+
+}
+
+}  // namespace
+
+// Times the collection filter searches on FTS5 search tables against the FTS3 tables they replaced, built from the same songs.
+int main(int argc, char *argv[]) {
+
+  QCoreApplication::setApplicationName("strawberry-searchbenchmark");
+  QCoreApplication::setOrganizationName("strawberry");
+  QCoreApplication a(argc, argv);
+
+  Q_INIT_RESOURCE(data);
+
+  logging::Init();
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Fills an in-memory collection with made up songs and times prefix searches like the ones the collection filter runs, on an FTS5 and an FTS3 search table.");
+  parser.addHelpOption();
+  QCommandLineOption songs_option("songs", "Number of songs in the collection.", "count", "100000");
+  QCommandLineOption queries_option("queries", "Number of searches for each prefix length.", "count", "100");
+  parser.addOption(songs_option);
+  parser.addOption(queries_option);
+  parser.process(a);
+
+  const int song_count = parser.value(songs_option).toInt();
+  const int query_count = parser.value(queries_option).toInt();
+  if (song_count <= 0 || query_count <= 0) {
+    qLog(Error) << "The number of songs and searches have to be positive";
+    return 1;
+  }
+
+  MemoryDatabase db(nullptr);
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int first = 0 ; first < song_count ; first += kBatchSize) {
+    SongList songs;
+    for (int i = first ; i < qMin(song_count, first + kBatchSize) ; ++i) songs << BenchmarkSongs::Generate(i);
+    BenchmarkSongs::AddToDatabase(&db, songs);
+  }
+  qLog(Info) << "Added" << song_count << "songs in" << timer.elapsed() << "ms";
+
+  QStringList fts_tables = QStringList() << "songs_fts";
+  {
+    QMutexLocker l(db.Mutex());
+    QSqlDatabase database(db.Connect());
+    ScopedTransaction transaction(&database);
+    QSqlQuery query(database);
+    if (query.exec("CREATE VIRTUAL TABLE songs_fts3 USING fts3(" + Song::kFtsColumnSpec + ", tokenize=unicode)") &&
+        query.exec("INSERT INTO songs_fts3 (ROWID, " + Song::kFtsColumnSpec + ") SELECT ROWID, title, album, artist, albumartist, composer, performer, grouping, genre, comment FROM songs")) {
+      transaction.Commit();
+      fts_tables << "songs_fts3";
+    }
+    else {
+      db.CheckErrors(query);
+      qLog(Error) << "Couldn't create the FTS3 table, only FTS5 is timed";
+    }
+  }
+
+  // Prefixes of one to four characters of the words in the tags, and two word searches.
+  const QStringList words = BenchmarkSongs::Words();
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> word(0, words.count() - 1);
+  QMap<QString, QStringList> searches;
+  for (int i = 0 ; i < query_count ; ++i) {
+    for (int length = 1 ; length <= 4 ; ++length) {
+      searches[QString("%1 character prefix").arg(length)] << words[word(generator)].left(length);
+    }
+    searches["two words"] << words[word(generator)] + " " + words[word(generator)].left(2);
+  }
+
+  bool success = true;
+  for (const QString &fts_table : fts_tables) {
+    for (QMap<QString, QStringList>::const_iterator it = searches.constBegin() ; it != searches.constEnd() ; ++it) {
+      QList<qint64> nsecs;
+      qint64 rows = 0;
+      for (const QString &filter : it.value()) {
+        timer.restart();
+        const int result = Search(&db, fts_table, filter);
+        nsecs << timer.nsecsElapsed();
+        if (result == -1) success = false;
+        else rows += result;
+      }
+      std::sort(nsecs.begin(), nsecs.end());
+      qint64 total = 0;
+      for (const qint64 nsec : nsecs) total += nsec;
+
+      qLog(Info) << fts_table << it.key() << "searches:" << QString::number(nsecs[nsecs.count() / 2] / 1e6, 'f', 2) << "ms median," << QString::number(total / 1e6 / nsecs.count(), 'f', 2) << "ms mean," << rows / nsecs.count() << "rows on average";
+    }
+  }
+
+  return success ? 0 : 1;
+
+}
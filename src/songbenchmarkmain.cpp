@@ -0,0 +1,149 @@
+/*
+ * Strawberry Music Player
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QString>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "core/logging.h"
+#include "core/metatypes.h"
+#include "core/database.h"
+#include "core/song.h"
+#include "core/sqlitequery.h"
+#include "collection/sqlrow.h"
+#include "collection/benchmarksongs.h"
+
+namespace {
+
+const int kBatchSize = 10000;
+
+// Reads every song with QSqlQuery, copying each row into a SqlRow first like the collection model does.
+int ReadSqlRows(Database *db) {
+
+  QMutexLocker l(db->Mutex());
+  QSqlDatabase database(db->Connect());
+
+  QSqlQuery query(database);
+  query.setForwardOnly(true);
+  query.prepare("SELECT ROWID, " + Song::kColumnSpec + " FROM songs");
+  query.exec();
+  if (db->CheckErrors(query)) return -1;
+
+  int rows = 0;
+  while (query.next()) {
+    Song song;
+    song.InitFromQuery(SqlRow(query), true);
+    ++rows;
+  }
+  return rows;
+
+}
+
+// Reads every song straight from the SQLite statement.
+int ReadSqliteQuery(Database *db) {
+
+  QMutexLocker l(db->Mutex());
+  QSqlDatabase database(db->Connect());
+
+  SqliteQuery query(database);
+  if (!query.Prepare("SELECT ROWID, " + Song::kColumnSpec + " FROM songs")) return -1;
+  query.Exec();
+  if (db->CheckErrors(query)) return -1;
+
+  int rows = 0;
+  while (query.Next()) {
+    Song song;
+    song.InitFromQuery(query, true);
+    ++rows;
+  }
+  return rows;
+
+}
+
+}  // namespace
+
+// Times reading songs from the database with Song::InitFromQuery, through QSqlQuery and through SqliteQuery.
+int main(int argc, char *argv[]) {
+
+  QCoreApplication::setApplicationName("strawberry-songbenchmark");
+  QCoreApplication::setOrganizationName("strawberry");
+  QCoreApplication a(argc, argv);
+
+  Q_INIT_RESOURCE(data);
+
+  RegisterMetaTypes();
+
+  logging::Init();
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Fills an in-memory songs table with made up songs and times how many rows per second Song::InitFromQuery reads from it, through QSqlQuery and SqlRow and through SqliteQuery.");
+  parser.addHelpOption();
+  QCommandLineOption songs_option("songs", "Number of rows in the songs table.", "count", "1000000");
+  QCommandLineOption runs_option("runs", "Number of times all rows are read with each query type.", "count", "3");
+  parser.addOption(songs_option);
+  parser.addOption(runs_option);
+  parser.process(a);
+
+  const int song_count = parser.value(songs_option).toInt();
+  const int runs = parser.value(runs_option).toInt();
+  if (song_count <= 0 || runs <= 0) {
+    qLog(Error) << "The number of songs and runs have to be positive";
+    return 1;
+  }
+
+  MemoryDatabase db(nullptr);
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int first = 0 ; first < song_count ; first += kBatchSize) {
+    SongList songs;
+    for (int i = first ; i < qMin(song_count, first + kBatchSize) ; ++i) songs << BenchmarkSongs::Generate(i);
+    BenchmarkSongs::AddToDatabase(&db, songs);
+  }
+  qLog(Info) << "Added" << song_count << "songs in" << timer.elapsed() << "ms";
+
+  bool success = true;
+  for (int run = 0 ; run < runs ; ++run) {
+    timer.restart();
+    const int sql_rows = ReadSqlRows(&db);
+    const qint64 sql_nsec = timer.nsecsElapsed();
+
+    timer.restart();
+    const int sqlite_rows = ReadSqliteQuery(&db);
+    const qint64 sqlite_nsec = timer.nsecsElapsed();
+
+    if (sql_rows != song_count || sqlite_rows != song_count) {
+      qLog(Error) << "Read" << sql_rows << "and" << sqlite_rows << "rows instead of" << song_count;
+      success = false;
+      break;
+    }
+
+    qLog(Info) << "Run" << run + 1 << "- SqlRow:" << qint64(sql_rows * 1e9 / sql_nsec) << "rows/s, SqliteQuery:" << qint64(sqlite_rows * 1e9 / sqlite_nsec) << "rows/s";
+  }
+
+  return success ? 0 : 1;
+
+}
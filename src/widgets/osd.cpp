@@ -259,6 +259,7 @@ void OSD::ShuffleModeChanged(PlaylistSequence::ShuffleMode mode) {
       case PlaylistSequence::Shuffle_All:         current_mode = tr("Shuffle all");     break;
       case PlaylistSequence::Shuffle_InsideAlbum: current_mode = tr("Shuffle tracks in this album"); break;
       case PlaylistSequence::Shuffle_Albums:      current_mode = tr("Shuffle albums");  break;
+      case PlaylistSequence::Shuffle_Weighted:    current_mode = tr("Shuffle weighted by play count");  break;
     }
     ShowMessage(app_name_, current_mode);
   }
@@ -0,0 +1,230 @@
+#include "testplaylistshuffler.h"
+#include "core/song.h"
+#include "playlist/playlistitem.h"
+#include "playlist/playlistsequence.h"
+#include "playlist/playlistshuffler.h"
+#include "playlist/songplaylistitem.h"
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QDateTime>
+#include <algorithm>
+
+namespace {
+
+// Every row of a playlist with count items must be in the play order exactly once.
+bool IsPermutation(QList<int> virtual_items, const int count)
+{
+    if (virtual_items.count() != count) return false;
+    std::sort(virtual_items.begin(), virtual_items.end());
+    for (int i = 0; i < count; ++i) {
+        if (virtual_items[i] != i) return false;
+    }
+    return true;
+}
+
+PlaylistItemPtr MakeItem(const QString &album, const int track, const int lastplayed = -1, const int playcount = 0)
+{
+    Song song;
+    song.set_artist("Artist");
+    song.set_album(album);
+    song.set_title(QString("%1 %2").arg(album).arg(track));
+    song.set_track(track);
+    song.set_lastplayed(lastplayed);
+    song.set_playcount(playcount);
+    return PlaylistItemPtr(new SongPlaylistItem(song));
+}
+
+// Each album is played as one block, with its songs in playlist order.
+bool AlbumsContiguous(const PlaylistItemList &items, const QList<int> &virtual_items)
+{
+    QSet<QString> finished_albums;
+    QString album;
+    int previous_row = -1;
+    for (const int row : virtual_items) {
+        const QString key = items[row]->Metadata().AlbumKey();
+        if (key != album) {
+            if (finished_albums.contains(key)) return false;
+            if (!album.isNull()) finished_albums.insert(album);
+            album = key;
+        }
+        else if (row < previous_row) {
+            return false;
+        }
+        previous_row = row;
+    }
+    return true;
+}
+
+}  // namespace
+
+void TestPlaylistShuffler::TestInsertAppend()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    for (int i = 0; i < 5; ++i) virtual_items << i;
+    shuffler.Shuffle(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, -1);
+
+    shuffler.Insert(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, 5, 3);
+    QVERIFY(IsPermutation(virtual_items, 8));
+}
+
+void TestPlaylistShuffler::TestInsertMiddleUnshuffled()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    for (int i = 0; i < 5; ++i) virtual_items << i;
+
+    // Rows 2 and 3 are new, the old rows 2, 3 and 4 are now 4, 5 and 6.
+    shuffler.Insert(PlaylistSequence::Shuffle_Off, items, &virtual_items, 0, 2, 2);
+    QCOMPARE(virtual_items, QList<int>() << 0 << 1 << 2 << 3 << 4 << 5 << 6);
+}
+
+void TestPlaylistShuffler::TestInsertMiddleShuffled()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    for (int i = 0; i < 10; ++i) virtual_items << i;
+    shuffler.Shuffle(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, -1);
+
+    // Pretend the first three songs of the play order have been played.
+    const int begin = 3;
+    const QList<int> played = virtual_items.mid(0, begin);
+    QList<int> unplayed = virtual_items.mid(begin);
+
+    shuffler.Insert(PlaylistSequence::Shuffle_All, items, &virtual_items, begin, 4, 3);
+    QVERIFY(IsPermutation(virtual_items, 13));
+
+    // The played part stays where it was, with rows at or after 4 moved down by three.
+    for (int i = 0; i < begin; ++i) {
+        QCOMPARE(virtual_items[i], played[i] >= 4 ? played[i] + 3 : played[i]);
+    }
+
+    // The new rows are only placed in the unplayed part, and the old unplayed rows keep their relative order.
+    QList<int> old_rows;
+    for (int i = begin; i < virtual_items.count(); ++i) {
+        if (virtual_items[i] < 4 || virtual_items[i] >= 7) old_rows << virtual_items[i];
+    }
+    for (int &row : unplayed) {
+        if (row >= 4) row += 3;
+    }
+    QCOMPARE(old_rows, unplayed);
+}
+
+void TestPlaylistShuffler::TestAlbumsContiguous()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    // The albums are mixed up in the playlist.
+    for (int i = 0; i < 12; ++i) {
+        items << MakeItem(QString("Album %1").arg(i % 3), i / 3 + 1);
+        virtual_items << i;
+    }
+
+    shuffler.Shuffle(PlaylistSequence::Shuffle_Albums, items, &virtual_items, 0, -1);
+    QVERIFY(IsPermutation(virtual_items, 12));
+    QVERIFY(AlbumsContiguous(items, virtual_items));
+
+    // The album of the current song is played first.
+    shuffler.Shuffle(PlaylistSequence::Shuffle_Albums, items, &virtual_items, 0, 5);
+    QVERIFY(AlbumsContiguous(items, virtual_items));
+    QCOMPARE(items[virtual_items.first()]->Metadata().album(), items[5]->Metadata().album());
+}
+
+void TestPlaylistShuffler::TestInsertAlbumsContiguous()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    for (int i = 0; i < 8; ++i) {
+        items << MakeItem(QString("Album %1").arg(i / 4), i % 4 + 1);
+        virtual_items << i;
+    }
+    shuffler.Shuffle(PlaylistSequence::Shuffle_Albums, items, &virtual_items, 0, -1);
+
+    // A song of an album that is already there and a new album are inserted in the middle.
+    items.insert(4, MakeItem("Album 0", 5));
+    items.insert(5, MakeItem("Album 2", 1));
+    items.insert(6, MakeItem("Album 2", 2));
+    shuffler.Insert(PlaylistSequence::Shuffle_Albums, items, &virtual_items, 0, 4, 3);
+
+    QVERIFY(IsPermutation(virtual_items, 11));
+    QVERIFY(AlbumsContiguous(items, virtual_items));
+}
+
+void TestPlaylistShuffler::TestRecentlyPlayedLast()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    const int now = QDateTime::currentDateTime().toTime_t();
+    for (int i = 0; i < 10; ++i) {
+        // Song 2 was played a minute ago, song 7 was played a week ago.
+        const int lastplayed = i == 2 ? now - 60 : i == 7 ? now - 7 * 24 * 60 * 60 : -1;
+        items << MakeItem("Album", i + 1, lastplayed);
+        virtual_items << i;
+    }
+    // Song 5 was played in this session.
+    shuffler.AddToHistory(items[5]);
+
+    shuffler.Shuffle(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, -1);
+    QVERIFY(IsPermutation(virtual_items, 10));
+
+    const QSet<int> last = QSet<int>() << virtual_items[8] << virtual_items[9];
+    QCOMPARE(last, QSet<int>() << 2 << 5);
+}
+
+void TestPlaylistShuffler::TestInsertRecentlyPlayedLast()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+    QList<int> virtual_items;
+
+    for (int i = 0; i < 5; ++i) {
+        items << MakeItem("Album", i + 1);
+        virtual_items << i;
+    }
+    shuffler.Shuffle(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, -1);
+
+    items << MakeItem("Album", 6, QDateTime::currentDateTime().toTime_t() - 60);
+    shuffler.Insert(PlaylistSequence::Shuffle_All, items, &virtual_items, 0, 5, 1);
+
+    QVERIFY(IsPermutation(virtual_items, 6));
+    QCOMPARE(virtual_items.last(), 5);
+}
+
+void TestPlaylistShuffler::TestWeightedPlaycount()
+{
+    PlaylistShuffler shuffler;
+    PlaylistItemList items;
+
+    // Song 3 has a thousand times the weight of each of the others.
+    for (int i = 0; i < 10; ++i) {
+        items << MakeItem("Album", i + 1, -1, i == 3 ? 999 : 0);
+    }
+
+    int first_count = 0;
+    for (int n = 0; n < 200; ++n) {
+        QList<int> virtual_items;
+        for (int i = 0; i < 10; ++i) virtual_items << i;
+        shuffler.Shuffle(PlaylistSequence::Shuffle_Weighted, items, &virtual_items, 0, -1);
+        QVERIFY(IsPermutation(virtual_items, 10));
+        if (virtual_items.first() == 3) ++first_count;
+    }
+
+    // It's played first in about 99% of the shuffles.
+    QVERIFY(first_count > 150);
+}
+
+QTEST_APPLESS_MAIN(TestPlaylistShuffler)
@@ -0,0 +1,20 @@
+#include "playlist/playlistshuffler.h"
+
+#include <QtTest>
+
+class TestPlaylistShuffler: public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void TestInsertAppend();
+    void TestInsertMiddleUnshuffled();
+    void TestInsertMiddleShuffled();
+    void TestAlbumsContiguous();
+    void TestInsertAlbumsContiguous();
+    void TestRecentlyPlayedLast();
+    void TestInsertRecentlyPlayedLast();
+    void TestWeightedPlaycount();
+
+};